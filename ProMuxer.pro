@@ -20,16 +20,14 @@ SOURCES += \
     src/main.cpp \
     src/ui/MainWindow.cpp \
     src/ui/FFmpegSetupDialog.cpp \
-    src/core/FileProcessor.cpp \
-    src/core/MuxingTask.cpp \
-    src/core/MediaAnalyzer.cpp
+    src/ui/StatsPanel.cpp
 
 HEADERS += \
     src/ui/MainWindow.h \
     src/ui/FFmpegSetupDialog.h \
-    src/core/FileProcessor.h \
-    src/core/MuxingTask.h \
-    src/core/MediaAnalyzer.h
+    src/ui/StatsPanel.h
+
+include(src/core/core.pri)
 
 FORMS += \
     src/ui/MainWindow.ui
@@ -0,0 +1,22 @@
+# Microbenchmarks for the per-file and per-chunk parsers.
+#
+#   qmake bench/parsers/parsers.pro && make
+#   ./promuxer-parsers-bench                 # ns/op and allocs/op summary
+#   ./promuxer-parsers-bench -csv            # QBENCHMARK results for tracking
+
+QT += core testlib
+QT -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = promuxer-parsers-bench
+TEMPLATE = app
+
+include(../../src/core/core.pri)
+
+SOURCES += \
+    tst_parsers.cpp
+
+RESOURCES += \
+    fixtures.qrc
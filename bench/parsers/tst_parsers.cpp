@@ -0,0 +1,374 @@
+// Microbenchmarks for the parsers that run once per file (ffprobe JSON, file-name
+// heuristics) or once per output chunk (ffmpeg stderr progress).
+//
+// Each benchmark runs under QBENCHMARK, so the usual QTest options apply
+// (-csv / -xml for tracking, -iterations, -tickcounter). In addition every
+// benchmark prints a "PERF" line with ns/op and heap allocations/op measured
+// over a fixed calibration loop, which is what parser changes should be
+// compared on.
+
+#include <QtTest>
+#include <QFile>
+#include <QElapsedTimer>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "MediaAnalyzer.h"
+#include "MediaInfo.h"
+#include "MuxingTask.h"
+#include "StartCodeScanner.h"
+#include "NalIndex.h"
+#include "SpsParser.h"
+
+// Counts every heap allocation in the process. The benchmark is single-threaded
+// while measuring, so the counter delta around a loop is that loop's allocations.
+static std::atomic<quint64> g_allocations{0};
+
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+class ParserBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void parseFFprobeOutput_data();
+    void parseFFprobeOutput();
+    void normalizeFpsFromText_data();
+    void normalizeFpsFromText();
+    void extractFpsFromName_data();
+    void extractFpsFromName();
+    void createDefaultMediaInfo_data();
+    void createDefaultMediaInfo();
+    void parseFFmpegOutput_data();
+    void parseFFmpegOutput();
+    void findStartCodes_data();
+    void findStartCodes();
+    void buildNalIndex();
+    void parseSps_data();
+    void parseSps();
+
+private:
+    static QString fixture(const QString &name);
+    // Synthetic H.265 stream: VPS/SPS/PPS + IDR every 32 pictures, 4-byte start
+    // codes, slice payloads free of zero runs
+    static QByteArray syntheticStream(int pictures, int sliceBytes);
+
+    // Runs fn for at least 200 ms and prints ns/op and allocs/op
+    template <typename Fn>
+    static void report(Fn fn);
+
+    MediaAnalyzer m_analyzer;
+    MuxingTask m_task;
+};
+
+QString ParserBench::fixture(const QString &name)
+{
+    QFile file(":/fixtures/" + name);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qFatal("missing fixture %s", qPrintable(name));
+    }
+    return QString::fromUtf8(file.readAll());
+}
+
+template <typename Fn>
+void ParserBench::report(Fn fn)
+{
+    fn(); // warm up lazily-initialized state (regex caches, QLocale)
+
+    quint64 iterations = 0;
+    const quint64 allocationsBefore = g_allocations.load(std::memory_order_relaxed);
+    QElapsedTimer timer;
+    timer.start();
+    do {
+        for (int i = 0; i < 16; ++i) {
+            fn();
+        }
+        iterations += 16;
+    } while (timer.elapsed() < 200);
+    const qint64 elapsedNs = timer.nsecsElapsed();
+    const quint64 allocations = g_allocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+    qInfo("PERF %s:%s ns/op=%.0f allocs/op=%.1f",
+          QTest::currentTestFunction(), QTest::currentDataTag(),
+          double(elapsedNs) / iterations, double(allocations) / iterations);
+}
+
+void ParserBench::initTestCase()
+{
+    // Keep the task quiet; parseFFmpegOutput logs the input duration once per job
+    m_task.blockSignals(true);
+}
+
+void ParserBench::parseFFprobeOutput_data()
+{
+    // ffprobe's stdout as read from the process, and the streams it lists
+    QTest::addColumn<QByteArray>("json");
+    QTest::addColumn<int>("streams");
+    QTest::newRow("mkv-hdr10-11-streams") << fixture("hdr10_hevc_4k.mkv.json").toUtf8() << 11;
+    QTest::newRow("mp4-h264-2-streams") << fixture("h264_1080p.mp4.json").toUtf8() << 2;
+    QTest::newRow("raw-hevc") << fixture("raw_hevc_10bit.h265.json").toUtf8() << 1;
+}
+
+void ParserBench::parseFFprobeOutput()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(int, streams);
+    const MediaInfo parsed = m_analyzer.parseFFprobeOutput(json);
+    QVERIFY(parsed.analyzed);
+    QCOMPARE(parsed.streams.size(), streams);
+
+    QBENCHMARK {
+        MediaInfo info = m_analyzer.parseFFprobeOutput(json);
+        Q_UNUSED(info);
+    }
+    report([&] { MediaInfo info = m_analyzer.parseFFprobeOutput(json); Q_UNUSED(info); });
+}
+
+void ParserBench::normalizeFpsFromText_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::newRow("rational-ntsc") << QString("24000/1001");
+    QTest::newRow("rational-int") << QString("25/1");
+    QTest::newRow("rational-zero") << QString("0/0");
+    QTest::newRow("decimal") << QString("29.97 fps");
+}
+
+void ParserBench::normalizeFpsFromText()
+{
+    QFETCH(QString, text);
+    QBENCHMARK {
+        QString fps = m_analyzer.normalizeFpsFromText(text);
+        Q_UNUSED(fps);
+    }
+    report([&] { QString fps = m_analyzer.normalizeFpsFromText(text); Q_UNUSED(fps); });
+}
+
+void ParserBench::extractFpsFromName_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::newRow("fps-tag") << QString("seq_3840x2160_59.94fps_10bit.h265");
+    QTest::newRow("p-tag") << QString("trailer_1080p60_final.mp4");
+    QTest::newRow("decimal-only") << QString("capture_29.97_take3.h264");
+    QTest::newRow("no-match") << QString("Feature.UHD.BluRay.HDR10.TrueHD.Atmos.mkv");
+}
+
+void ParserBench::extractFpsFromName()
+{
+    QFETCH(QString, name);
+    QBENCHMARK {
+        QString fps = m_analyzer.extractFpsFromName(name);
+        Q_UNUSED(fps);
+    }
+    report([&] { QString fps = m_analyzer.extractFpsFromName(name); Q_UNUSED(fps); });
+}
+
+void ParserBench::createDefaultMediaInfo_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::newRow("raw-annotated") << QString("/data/streams/seq_3840x2160_25fps_10bit_hdr.h265");
+    QTest::newRow("raw-bare") << QString("/data/streams/stream0001.bin");
+    QTest::newRow("keywords") << QString("/data/capture/demo_4k_hevc_23.976.265");
+}
+
+void ParserBench::createDefaultMediaInfo()
+{
+    QFETCH(QString, path);
+    QBENCHMARK {
+        MediaInfo info = m_analyzer.createDefaultMediaInfo(path);
+        Q_UNUSED(info);
+    }
+    report([&] { MediaInfo info = m_analyzer.createDefaultMediaInfo(path); Q_UNUSED(info); });
+}
+
+void ParserBench::parseFFmpegOutput_data()
+{
+    // One op is a whole job's stderr replayed in readyRead-sized chunks
+    QTest::addColumn<QStringList>("chunks");
+    const QString log = fixture("ffmpeg_mux_hevc_4k.txt");
+    for (int chunkSize : {512, 4096}) {
+        QStringList chunks;
+        for (int pos = 0; pos < log.size(); pos += chunkSize) {
+            chunks << log.mid(pos, chunkSize);
+        }
+        QTest::newRow(qPrintable(QString("mux-4k-%1B-chunks").arg(chunkSize))) << chunks;
+    }
+}
+
+void ParserBench::parseFFmpegOutput()
+{
+    QFETCH(QStringList, chunks);
+    auto replay = [&] {
+        m_task.m_durationParsed = false;
+        m_task.m_currentTime = 0;
+        for (const QString &chunk : chunks) {
+            m_task.parseFFmpegOutput(chunk);
+        }
+    };
+
+    replay();
+    QVERIFY(m_task.m_durationParsed);
+    QVERIFY(m_task.m_currentTime > 0);
+
+    QBENCHMARK {
+        replay();
+    }
+    report(replay);
+}
+
+QByteArray ParserBench::syntheticStream(int pictures, int sliceBytes)
+{
+    QByteArray stream;
+    stream.reserve(pictures * (sliceBytes + 32));
+    const QByteArray startCode("\x00\x00\x00\x01", 4);
+    QByteArray payload(sliceBytes, Qt::Uninitialized);
+    quint32 state = 1;
+    for (char &c : payload) {
+        state = state * 1664525u + 1013904223u;
+        c = char((state >> 24) | 0x02);     // never 0 or 1, so no emulated start codes
+    }
+    for (int i = 0; i < pictures; ++i) {
+        if (i % 32 == 0) {
+            stream += startCode + QByteArray("\x40\x01\x0c", 3);     // VPS
+            stream += startCode + QByteArray("\x42\x01\x01", 3);     // SPS
+            stream += startCode + QByteArray("\x44\x01\xc1", 3);     // PPS
+            stream += startCode + QByteArray("\x26\x01\xaf", 3);     // IDR_W_RADL, first slice
+        } else {
+            stream += startCode + QByteArray("\x02\x01\xd0", 3);     // TRAIL_R, first slice
+        }
+        stream += payload;
+    }
+    return stream;
+}
+
+void ParserBench::findStartCodes_data()
+{
+    QTest::addColumn<int>("implementation");
+    for (auto implementation : {StartCodeScanner::Implementation::Scalar, StartCodeScanner::Implementation::Sse2,
+                                StartCodeScanner::Implementation::Avx2, StartCodeScanner::Implementation::Neon}) {
+        QTest::newRow(StartCodeScanner::name(implementation)) << int(implementation);
+    }
+}
+
+void ParserBench::findStartCodes()
+{
+    // One op is a full pass over 64 MB of ~40 KB slices
+    QFETCH(int, implementation);
+    const auto impl = StartCodeScanner::Implementation(implementation);
+    const QByteArray stream = syntheticStream(1600, 40 * 1024);
+    const uchar *begin = reinterpret_cast<const uchar *>(stream.constData());
+    const uchar *end = begin + stream.size();
+    if (!StartCodeScanner::findNextWith(impl, begin, end)) {
+        QSKIP("not available on this CPU/build");
+    }
+
+    auto scan = [&]() {
+        int found = 0;
+        for (const uchar *p = StartCodeScanner::findNextWith(impl, begin, end); p != end;
+             p = StartCodeScanner::findNextWith(impl, p + 3, end)) {
+            found++;
+        }
+        return found;
+    };
+    QCOMPARE(scan(), 1600 + 3 * 50);
+
+    QBENCHMARK {
+        scan();
+    }
+    QElapsedTimer timer;
+    timer.start();
+    int passes = 0;
+    do {
+        scan();
+        passes++;
+    } while (timer.elapsed() < 200);
+    qInfo("PERF %s:%s GB/s=%.2f", QTest::currentTestFunction(), QTest::currentDataTag(),
+          double(stream.size()) * passes / timer.nsecsElapsed());
+}
+
+void ParserBench::buildNalIndex()
+{
+    const QByteArray stream = syntheticStream(1600, 40 * 1024);
+    const uchar *data = reinterpret_cast<const uchar *>(stream.constData());
+    NalIndex index;
+    QVERIFY(index.build(data, stream.size(), NalIndex::Codec::Unknown));
+    QCOMPARE(index.codec(), NalIndex::Codec::H265);
+    QCOMPARE(index.frameCount(), qint64(1600));
+    QCOMPARE(index.keyframeCount(), 50);
+    QCOMPARE(index.unitOffset(0), qint64(0));       // the unit opens at the VPS
+    QCOMPARE(index.keyframeAtOrBefore(40), qint64(32));
+    const NalIndex::ByteRange range = index.rangeForFrames(40, 70, stream.size());
+    QCOMPARE(range.firstFrame, qint64(32));
+    QCOMPARE(range.frames(), qint64(38));
+    QCOMPARE(range.end, index.unitOffset(70));
+    QVERIFY(!range.needsHeader);
+
+    QBENCHMARK {
+        index.build(data, stream.size(), NalIndex::Codec::H265);
+    }
+    report([&] { index.build(data, stream.size(), NalIndex::Codec::H265); });
+}
+
+void ParserBench::parseSps_data()
+{
+    QTest::addColumn<QByteArray>("nal");
+    QTest::addColumn<int>("codec");
+    QTest::addColumn<QString>("expected");
+    // High 10 with scaling lists, POC type 1 and 8 lines cropped
+    QTest::newRow("h264") << QByteArray("\x67\x6e\x00\x33\xa6\xdb\x4d\x34\xd3\x4d\x34\xd0\x2d\x34\xd3\x4d\x34\xd3\x4d\x34\xd3\x4d\x34"
+                                        "\xd3\x4d\x34\xd3\x4d\x34\xd3\x4d\x34\xd3\x4d\x34\xd3\x4a\x14\xcd\x32\x80\xf0\x04\x4f\xca\x80", 46)
+                          << int(NalIndex::Codec::H264) << QString("H.264 High 10, 1920x1080, 4:2:0 10-bit, level 5.1");
+    // Main 10 with two sub-layers, emulation prevention bytes and a conformance window
+    QTest::newRow("h265") << QByteArray("\x42\x01\x03\x02\x20\x00\x00\x03\x00\x00\x03\x00\x00\x03\x00\x00\x03\x00\x99\xc0\x00\x00\x03"
+                                        "\x00\x00\x03\x00\x00\x03\x00\x00\x03\x00\x00\x03\x00\x00\x96\xa0\x01\xe0\x20\x02\x20\x7c\x4b\x70", 47)
+                          << int(NalIndex::Codec::H265) << QString("H.265 Main 10, 3840x2160, 4:2:0 10-bit, level 5.1");
+}
+
+void ParserBench::parseSps()
+{
+    QFETCH(QByteArray, nal);
+    QFETCH(int, codec);
+    QFETCH(QString, expected);
+    const uchar *data = reinterpret_cast<const uchar *>(nal.constData());
+    SpsInfo info;
+    QVERIFY(SpsParser::parse(data, nal.size(), NalIndex::Codec(codec), &info));
+    QCOMPARE(info.describe(), expected);
+    QVERIFY(!SpsParser::parse(data, nal.size() / 2, NalIndex::Codec(codec), &info));
+
+    QBENCHMARK {
+        SpsParser::parse(data, nal.size(), NalIndex::Codec(codec), &info);
+    }
+    report([&] { SpsParser::parse(data, nal.size(), NalIndex::Codec(codec), &info); });
+}
+
+QTEST_GUILESS_MAIN(ParserBench)
+#include "tst_parsers.moc"
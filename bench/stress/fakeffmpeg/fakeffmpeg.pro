@@ -0,0 +1,12 @@
+# Stand-in for ffmpeg/ffprobe used by the scheduler stress harness.
+# Plain C++ with no Qt dependency so each simulated job starts in well under a millisecond.
+
+TEMPLATE = app
+TARGET = fakeffmpeg
+CONFIG += c++17 console
+CONFIG -= qt app_bundle
+
+DESTDIR = ..
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,219 @@
+// fakeffmpeg: behaves enough like ffmpeg and ffprobe for FileProcessor and
+// MediaAnalyzer to drive it, without touching real media.
+//
+// The behaviour of each job is taken from tokens in the input file name, so the
+// harness can mix outcomes in one batch:
+//
+//   lat<ms>     run for this long (default FAKEFFMPEG_LATENCY_MS, else 20)
+//   exit<code>  exit with this code after the run
+//   crash       abort() halfway through the run
+//   hang        print progress, then never exit
+//
+// e.g. "job00042_lat150_exit1.h264". Progress lines are printed every
+// FAKEFFMPEG_PROGRESS_MS (default 50) in ffmpeg's stderr format.
+//
+// The tool runs as ffprobe when its name contains "ffprobe" or when it is given
+// -show_streams, and as ffmpeg otherwise. Like ffmpeg it refuses to replace an
+// existing output without -y; it fails at once where ffmpeg would ask on stdin.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Behaviour {
+    int latencyMs = 20;
+    int exitCode = 0;
+    bool crash = false;
+    bool hang = false;
+};
+
+int envInt(const char *name, int fallback)
+{
+    const char *value = std::getenv(name);
+    return value && *value ? std::atoi(value) : fallback;
+}
+
+std::string baseName(const std::string &path)
+{
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+Behaviour parseBehaviour(const std::string &inputPath)
+{
+    Behaviour behaviour;
+    behaviour.latencyMs = envInt("FAKEFFMPEG_LATENCY_MS", 20);
+
+    const std::string name = baseName(inputPath);
+    size_t start = 0;
+    while (start < name.size()) {
+        size_t end = name.find_first_of("_.-", start);
+        if (end == std::string::npos) {
+            end = name.size();
+        }
+        const std::string token = name.substr(start, end - start);
+        if (token.compare(0, 3, "lat") == 0 && token.size() > 3) {
+            behaviour.latencyMs = std::atoi(token.c_str() + 3);
+        } else if (token.compare(0, 4, "exit") == 0 && token.size() > 4) {
+            behaviour.exitCode = std::atoi(token.c_str() + 4);
+        } else if (token == "crash") {
+            behaviour.crash = true;
+        } else if (token == "hang") {
+            behaviour.hang = true;
+        }
+        start = end + 1;
+    }
+    return behaviour;
+}
+
+void sleepMs(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void printVersion(bool probe)
+{
+    std::printf("%s version 7.1-fake Copyright (c) 2000-2024 the FFmpeg developers\n"
+                "built with fakeffmpeg (ProMuxer stress harness)\n",
+                probe ? "ffprobe" : "ffmpeg");
+}
+
+int runProbe(const std::string &input)
+{
+    const Behaviour behaviour = parseBehaviour(input);
+    sleepMs(behaviour.latencyMs);
+    if (behaviour.crash) {
+        std::abort();
+    }
+    while (behaviour.hang) {
+        sleepMs(1000);
+    }
+    if (behaviour.exitCode != 0) {
+        std::fprintf(stderr, "%s: Invalid data found when processing input\n", input.c_str());
+        return behaviour.exitCode;
+    }
+
+    std::printf("{\n"
+                "    \"streams\": [\n"
+                "        {\n"
+                "            \"index\": 0,\n"
+                "            \"codec_name\": \"hevc\",\n"
+                "            \"codec_type\": \"video\",\n"
+                "            \"width\": 1920,\n"
+                "            \"height\": 1080,\n"
+                "            \"pix_fmt\": \"yuv420p10le\",\n"
+                "            \"color_space\": \"bt709\",\n"
+                "            \"r_frame_rate\": \"25/1\",\n"
+                "            \"avg_frame_rate\": \"25/1\"\n"
+                "        }\n"
+                "    ],\n"
+                "    \"format\": {\n"
+                "        \"filename\": \"%s\",\n"
+                "        \"format_name\": \"hevc\",\n"
+                "        \"duration\": \"10.000000\",\n"
+                "        \"size\": \"1048576\",\n"
+                "        \"bit_rate\": \"838860\"\n"
+                "    }\n"
+                "}\n", input.c_str());
+    return 0;
+}
+
+int runFFmpeg(const std::string &input, const std::string &output, bool overwrite)
+{
+    const Behaviour behaviour = parseBehaviour(input);
+    const int progressMs = std::max(1, envInt("FAKEFFMPEG_PROGRESS_MS", 50));
+
+    if (!overwrite) {
+        if (FILE *existing = std::fopen(output.c_str(), "rb")) {
+            std::fclose(existing);
+            std::fprintf(stderr, "File '%s' already exists. Overwrite? [y/N] Not overwriting - exiting\n",
+                         output.c_str());
+            return 1;
+        }
+    }
+
+    std::fprintf(stderr,
+                 "ffmpeg version 7.1-fake Copyright (c) 2000-2024 the FFmpeg developers\n"
+                 "Input #0, hevc, from '%s':\n"
+                 "  Duration: 00:00:10.00, start: 0.000000, bitrate: 838 kb/s\n"
+                 "  Stream #0:0: Video: hevc (Main 10), yuv420p10le(tv), 1920x1080, 25 fps, 25 tbr, 1200k tbn\n"
+                 "Output #0, mp4, to '%s':\n"
+                 "Press [q] to stop, [?] for help\n",
+                 input.c_str(), output.c_str());
+    std::fflush(stderr);
+
+    // Progress lines walk media time from 0 to 10 s over the configured latency
+    const int steps = std::max(1, behaviour.latencyMs / progressMs);
+    for (int step = 1; step <= steps; ++step) {
+        sleepMs(behaviour.latencyMs / steps);
+        if (behaviour.crash && step * 2 >= steps) {
+            std::abort();
+        }
+        const int centis = 1000 * step / steps;
+        std::fprintf(stderr, "frame=%5d fps=250 q=-1.0 size=%8dKiB time=00:00:%02d.%02d bitrate= 838.9kbits/s speed=10.0x    \r",
+                     centis / 4, centis * 10, centis / 100, centis % 100);
+        std::fflush(stderr);
+    }
+    if (behaviour.crash) {
+        std::abort();
+    }
+    while (behaviour.hang) {
+        std::fprintf(stderr, "frame=  250 fps=0.0 q=-1.0 size=   10240KiB time=00:00:10.00 bitrate= 838.9kbits/s speed=0x    \r");
+        std::fflush(stderr);
+        sleepMs(progressMs);
+    }
+
+    if (behaviour.exitCode != 0) {
+        std::fprintf(stderr, "\n[out#0/mp4] Error muxing a packet\nConversion failed!\n");
+        return behaviour.exitCode;
+    }
+
+    if (FILE *file = std::fopen(output.c_str(), "wb")) {
+        std::fputs("fakeffmpeg output\n", file);
+        std::fclose(file);
+    }
+    std::fprintf(stderr, "\n[out#0/mp4] video:10240KiB audio:0KiB subtitle:0KiB other streams:0KiB global headers:0KiB muxing overhead: 0.010000%%\n");
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    bool probe = baseName(argv[0]).find("ffprobe") != std::string::npos;
+    std::string input;
+    bool overwrite = false;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "-version") {
+            printVersion(probe);
+            return 0;
+        }
+        if (args[i] == "-show_streams") {
+            probe = true;
+        }
+        if (args[i] == "-y") {
+            overwrite = true;
+        }
+        if (args[i] == "-i" && i + 1 < args.size()) {
+            input = args[i + 1];
+        }
+    }
+
+    if (args.empty()) {
+        std::fprintf(stderr, "usage: %s [ffmpeg or ffprobe arguments]\n", argv[0]);
+        return 1;
+    }
+
+    if (probe) {
+        return runProbe(args.back());
+    }
+    return runFFmpeg(input, args.back(), overwrite);
+}
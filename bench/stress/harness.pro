@@ -0,0 +1,13 @@
+QT += core
+QT -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = promuxer-stress
+TEMPLATE = app
+
+include(../../src/core/core.pri)
+
+SOURCES += \
+    main.cpp
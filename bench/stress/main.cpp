@@ -0,0 +1,466 @@
+// promuxer-stress: scheduler stress harness for FileProcessor and MediaAnalyzer.
+//
+// Points both at fakeffmpeg and runs thousands of simulated jobs with mixed
+// outcomes (success, non-zero exit, crash, hang), then checks that every job
+// reached exactly one final state. Alongside the checks it measures scheduler
+// overhead per job, event-loop latency (what the UI thread would feel) and
+// resident memory growth. Exits non-zero when a check fails.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include "FileProcessor.h"
+#include "IoPolicy.h"
+#include "MediaAnalyzer.h"
+#include "MediaInfo.h"
+
+namespace {
+
+enum class Outcome {
+    Success,
+    Failure,       // non-zero exit
+    Crash,
+    Hang
+};
+
+struct SimulatedJob {
+    QString path;
+    Outcome outcome = Outcome::Success;
+    int latencyMs = 0;
+};
+
+struct Mix {
+    int maxLatencyMs = 20;
+    double failureRate = 0.05;
+    double crashRate = 0.02;
+    double hangRate = 0.0;
+};
+
+QTextStream &err()
+{
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+QList<SimulatedJob> createJobs(const QString &directory, const QString &prefix, int count,
+                               const Mix &mix, QRandomGenerator &random)
+{
+    QList<SimulatedJob> jobs;
+    jobs.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        SimulatedJob job;
+        job.latencyMs = mix.maxLatencyMs > 0 ? random.bounded(mix.maxLatencyMs + 1) : 0;
+
+        const double roll = random.generateDouble();
+        QString tags = QString("lat%1").arg(job.latencyMs);
+        if (roll < mix.hangRate) {
+            job.outcome = Outcome::Hang;
+            tags += "_hang";
+        } else if (roll < mix.hangRate + mix.crashRate) {
+            job.outcome = Outcome::Crash;
+            tags += "_crash";
+        } else if (roll < mix.hangRate + mix.crashRate + mix.failureRate) {
+            job.outcome = Outcome::Failure;
+            tags += QString("_exit%1").arg(1 + random.bounded(254));
+        }
+
+        job.path = QDir(directory).absoluteFilePath(QString("%1%2_%3.h264").arg(prefix).arg(i, 6, 10, QChar('0')).arg(tags));
+        QFile file(job.path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            err() << "Cannot create " << job.path << "\n";
+        }
+        jobs << job;
+    }
+    return jobs;
+}
+
+double percentile(QVector<double> values, double fraction)
+{
+    if (values.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    int rank = qBound(0, int(fraction * values.size() + 0.999999) - 1, values.size() - 1);
+    return values.at(rank);
+}
+
+// Samples how late a 10 ms timer fires (event-loop latency) and the peak RSS
+class LoopProbe
+{
+public:
+    LoopProbe()
+    {
+        m_timer.setTimerType(Qt::PreciseTimer);
+        m_timer.setInterval(10);
+        QObject::connect(&m_timer, &QTimer::timeout, [this]() {
+            const double elapsedMs = m_clock.nsecsElapsed() / 1e6;
+            m_lateness << qMax(0.0, elapsedMs - m_timer.interval());
+            m_clock.restart();
+            if (++m_ticks % 10 == 0) {
+                m_peakRss = qMax(m_peakRss, IoPolicy::memoryUsage().rssBytes);
+            }
+        });
+    }
+
+    void start()
+    {
+        m_lateness.clear();
+        m_startRss = IoPolicy::memoryUsage().rssBytes;
+        m_peakRss = m_startRss;
+        m_clock.start();
+        m_timer.start();
+    }
+
+    QJsonObject stop()
+    {
+        m_timer.stop();
+        const qint64 endRss = IoPolicy::memoryUsage().rssBytes;
+        QJsonObject loop;
+        loop["p50"] = percentile(m_lateness, 0.50);
+        loop["p99"] = percentile(m_lateness, 0.99);
+        loop["max"] = percentile(m_lateness, 1.0);
+
+        QJsonObject memory;
+        memory["start_rss_mb"] = m_startRss / (1024.0 * 1024.0);
+        memory["peak_rss_mb"] = qMax(m_peakRss, endRss) / (1024.0 * 1024.0);
+        memory["growth_mb"] = (endRss - m_startRss) / (1024.0 * 1024.0);
+
+        QJsonObject result;
+        result["event_loop_lateness_ms"] = loop;
+        result["memory"] = memory;
+        return result;
+    }
+
+private:
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    QVector<double> m_lateness;
+    qint64 m_startRss = 0;
+    qint64 m_peakRss = 0;
+    int m_ticks = 0;
+};
+
+class Checks
+{
+public:
+    void expect(bool condition, const QString &message)
+    {
+        if (!condition) {
+            m_failures << message;
+            err() << "CHECK FAILED: " << message << "\n";
+            err().flush();
+        }
+    }
+    QStringList failures() const { return m_failures; }
+
+private:
+    QStringList m_failures;
+};
+
+double overheadPerJobMs(qint64 wallMs, int parallel, const QList<SimulatedJob> &jobs)
+{
+    // Wall time the slots were busy beyond the simulated work itself:
+    // process spawn, pipe handling, signal delivery and bookkeeping.
+    qint64 workMs = 0;
+    for (const SimulatedJob &job : jobs) {
+        workMs += job.latencyMs;
+    }
+    return jobs.isEmpty() ? 0.0 : double(wallMs * parallel - workMs) / jobs.size();
+}
+
+QJsonObject runAnalysis(const QString &fake, const QList<SimulatedJob> &jobs, int parallel, Checks &checks)
+{
+    MediaAnalyzer analyzer;
+    analyzer.setFFprobePath(fake);
+    analyzer.setMaxParallelProbes(parallel);
+
+    QStringList files;
+    for (const SimulatedJob &job : jobs) {
+        files << job.path;
+    }
+
+    QVector<int> finals(jobs.size(), 0);
+    int completed = 0;
+    int outOfOrder = 0;
+    int lastIndex = -1;
+    int allFinishedSignals = 0;
+    QEventLoop loop;
+
+    auto onFinal = [&](int index, bool ok) {
+        if (index < 0 || index >= jobs.size()) {
+            checks.expect(false, QString("analysis: result for unknown index %1").arg(index));
+            return;
+        }
+        finals[index]++;
+        const bool expectedOk = jobs.at(index).outcome == Outcome::Success;
+        checks.expect(ok == expectedOk, QString("analysis: %1 reported %2").arg(jobs.at(index).path, ok ? "success" : "error"));
+        if (index < lastIndex) {
+            outOfOrder++;
+        }
+        lastIndex = index;
+        completed++;
+    };
+    QObject::connect(&analyzer, &MediaAnalyzer::analysisFinished, &loop,
+                     [&](int index, const MediaInfo &) { onFinal(index, true); });
+    QObject::connect(&analyzer, &MediaAnalyzer::analysisError, &loop,
+                     [&](int index, const QString &) { onFinal(index, false); });
+    QObject::connect(&analyzer, &MediaAnalyzer::allAnalysisFinished, &loop, [&]() {
+        allFinishedSignals++;
+        if (completed == jobs.size()) {
+            loop.quit();
+        }
+    });
+
+    LoopProbe probe;
+    probe.start();
+    QElapsedTimer wall;
+    wall.start();
+    analyzer.analyzeFiles(files);
+    if (completed < jobs.size()) {
+        loop.exec();
+    }
+    const qint64 wallMs = wall.elapsed();
+    QJsonObject result = probe.stop();
+
+    for (int i = 0; i < finals.size(); ++i) {
+        checks.expect(finals.at(i) == 1, QString("analysis: job %1 reached %2 final states").arg(i).arg(finals.at(i)));
+    }
+    checks.expect(allFinishedSignals >= 1, "analysis: allAnalysisFinished never emitted");
+    checks.expect(!analyzer.isAnalyzing(), "analysis: analyzer still busy after the last result");
+
+    result["scenario"] = "analyze";
+    result["jobs"] = jobs.size();
+    result["parallel"] = parallel;
+    result["seconds"] = wallMs / 1000.0;
+    result["jobs_per_s"] = jobs.size() / qMax(0.001, wallMs / 1000.0);
+    result["overhead_per_job_ms"] = overheadPerJobMs(wallMs, parallel, jobs);
+    result["out_of_order_completions"] = outOfOrder;
+    return result;
+}
+
+// Without overwrite, every tenth output exists before the batch and must survive it
+QJsonObject runProcessing(const QString &scenario, const QString &fake, const QList<SimulatedJob> &jobs,
+                          const QString &outputDir, int parallel, int cancelAfterMs, bool overwrite,
+                          Checks &checks)
+{
+    QDir(outputDir).removeRecursively();
+    QDir().mkpath(outputDir);
+
+    const QByteArray existingContent("existing\n");
+    QStringList existing;
+    if (!overwrite) {
+        for (int i = 0; i < jobs.size(); i += 10) {
+            const QString path = QDir(outputDir).absoluteFilePath(QFileInfo(jobs.at(i).path).completeBaseName()
+                                                                  + "_muxed.mp4");
+            QFile file(path);
+            if (file.open(QIODevice::WriteOnly)) {
+                file.write(existingContent);
+                existing << path;
+            }
+        }
+    }
+
+    FileProcessor processor;
+    processor.setFFmpegPath(fake);
+    processor.setMaxParallelJobs(parallel);
+
+    QStringList files;
+    QHash<QString, int> indexOf;
+    for (int i = 0; i < jobs.size(); ++i) {
+        files << jobs.at(i).path;
+        indexOf.insert(jobs.at(i).path, i);
+    }
+
+    QVector<int> finals(jobs.size(), 0);
+    int completed = 0;
+    int finishedSignals = 0;
+    int lateResults = 0;
+    bool stopped = false;
+    QEventLoop loop;
+
+    QObject::connect(&processor, &FileProcessor::fileProcessed, &loop, [&](const QString &file, bool success) {
+        const int index = indexOf.value(file, -1);
+        if (index < 0) {
+            checks.expect(false, QString("%1: result for unknown file %2").arg(scenario, file));
+            return;
+        }
+        if (stopped) {
+            lateResults++;
+        }
+        finals[index]++;
+        completed++;
+        const Outcome outcome = jobs.at(index).outcome;
+        checks.expect(outcome != Outcome::Hang, QString("%1: hanging job %2 reported a result").arg(scenario, file));
+        checks.expect(success == (outcome == Outcome::Success),
+                      QString("%1: %2 reported %3").arg(scenario, file, success ? "success" : "failure"));
+    });
+    QObject::connect(&processor, &FileProcessor::finished, &loop, [&]() {
+        finishedSignals++;
+        if (!stopped) {
+            loop.quit();
+        }
+    });
+
+    if (cancelAfterMs > 0) {
+        QTimer::singleShot(cancelAfterMs, &loop, [&]() {
+            stopped = true;
+            processor.stop();
+            // Give any stray completions time to arrive before checking
+            QTimer::singleShot(500, &loop, &QEventLoop::quit);
+        });
+    }
+
+    LoopProbe probe;
+    probe.start();
+    QElapsedTimer wall;
+    wall.start();
+    processor.processFiles(files, outputDir, "mp4", QVector<MediaInfo>(jobs.size()), overwrite, "muxing");
+    checks.expect(processor.isProcessing() || completed == jobs.size(),
+                  QString("%1: batch did not start").arg(scenario));
+    if (processor.isProcessing()) {
+        loop.exec();
+    }
+    const qint64 wallMs = wall.elapsed();
+    QJsonObject result = probe.stop();
+
+    int cancelled = 0;
+    for (int i = 0; i < finals.size(); ++i) {
+        checks.expect(finals.at(i) <= 1, QString("%1: job %2 reached %3 final states").arg(scenario).arg(i).arg(finals.at(i)));
+        if (finals.at(i) == 0) {
+            checks.expect(cancelAfterMs > 0, QString("%1: job %2 never finished").arg(scenario).arg(i));
+            cancelled++;
+        }
+    }
+    checks.expect(finishedSignals == 1, QString("%1: finished emitted %2 times").arg(scenario).arg(finishedSignals));
+    checks.expect(lateResults == 0, QString("%1: %2 results after stop()").arg(scenario).arg(lateResults));
+    checks.expect(!processor.isProcessing(), QString("%1: processor still busy").arg(scenario));
+    for (const QString &path : existing) {
+        QFile file(path);
+        checks.expect(file.open(QIODevice::ReadOnly) && file.readAll() == existingContent,
+                      QString("%1: existing %2 was overwritten").arg(scenario, path));
+    }
+
+    result["scenario"] = scenario;
+    result["jobs"] = jobs.size();
+    result["parallel"] = parallel;
+    result["overwrite"] = overwrite;
+    result["completed"] = completed;
+    result["cancelled"] = cancelled;
+    result["seconds"] = wallMs / 1000.0;
+    result["jobs_per_s"] = completed / qMax(0.001, wallMs / 1000.0);
+    if (cancelAfterMs <= 0) {
+        result["overhead_per_job_ms"] = overheadPerJobMs(wallMs, parallel, jobs);
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setOrganizationName("ProMuxer");
+    app.setApplicationName("ProMuxerStress");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ProMuxer scheduler stress harness");
+    parser.addHelpOption();
+#ifdef Q_OS_WIN
+    const QString defaultFake = QDir(app.applicationDirPath()).absoluteFilePath("fakeffmpeg.exe");
+#else
+    const QString defaultFake = QDir(app.applicationDirPath()).absoluteFilePath("fakeffmpeg");
+#endif
+    QCommandLineOption fakeOption("fake", "fakeffmpeg executable.", "path", defaultFake);
+    QCommandLineOption jobsOption("jobs", "Simulated jobs per scenario.", "n", "2000");
+    QCommandLineOption parallelOption("parallel", "Parallel ffmpeg jobs.", "n", "4");
+    QCommandLineOption probesOption("probes", "Parallel ffprobe processes.", "n", "4");
+    QCommandLineOption latencyOption("max-latency", "Maximum simulated job latency in ms.", "ms", "20");
+    QCommandLineOption seedOption("seed", "Random seed for the job mix.", "n", "1");
+    QCommandLineOption outputOption("output", "Write the JSON report to this file.", "file");
+    parser.addOptions({fakeOption, jobsOption, parallelOption, probesOption, latencyOption, seedOption, outputOption});
+    parser.process(app);
+
+    const QString fake = parser.value(fakeOption);
+    if (!QFileInfo(fake).isExecutable()) {
+        err() << "fakeffmpeg not found: " << fake << "\n";
+        return 1;
+    }
+
+    const int jobCount = qMax(1, parser.value(jobsOption).toInt());
+    const int parallel = qMax(1, parser.value(parallelOption).toInt());
+    const int probes = qMax(1, parser.value(probesOption).toInt());
+    QRandomGenerator random(parser.value(seedOption).toUInt());
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        err() << "Cannot create a scratch directory\n";
+        return 1;
+    }
+    const QString inputDir = workDir.filePath("in");
+    QDir().mkpath(inputDir);
+
+    Mix mix;
+    mix.maxLatencyMs = parser.value(latencyOption).toInt();
+
+    Checks checks;
+    QJsonArray results;
+
+    err() << "analyze: " << jobCount << " probes, " << probes << " in parallel\n";
+    err().flush();
+    const QList<SimulatedJob> probeJobs = createJobs(inputDir, "probe", jobCount, mix, random);
+    results.append(runAnalysis(fake, probeJobs, probes, checks));
+
+    err() << "process: " << jobCount << " jobs, " << parallel << " in parallel\n";
+    err().flush();
+    const QList<SimulatedJob> muxJobs = createJobs(inputDir, "mux", jobCount, mix, random);
+    results.append(runProcessing("process", fake, muxJobs, workDir.filePath("out"), parallel, 0, true, checks));
+
+    // Overwrite off, the default: outputs are claimed up front and existing ones kept
+    const int keepJobs = qMin(jobCount, 500);
+    err() << "no-overwrite: " << keepJobs << " jobs, every tenth output already exists\n";
+    err().flush();
+    const QList<SimulatedJob> keptJobs = createJobs(inputDir, "keep", keepJobs, mix, random);
+    results.append(runProcessing("no-overwrite", fake, keptJobs, workDir.filePath("out-keep"), parallel, 0, false,
+                                 checks));
+
+    // Cancellation: some jobs hang, stop() lands mid-batch
+    Mix cancelMix = mix;
+    cancelMix.hangRate = 0.05;
+    const int cancelJobs = qMin(jobCount, 500);
+    err() << "cancel: " << cancelJobs << " jobs with hangs, stop() after 1 s\n";
+    err().flush();
+    const QList<SimulatedJob> cancelledJobs = createJobs(inputDir, "cancel", cancelJobs, cancelMix, random);
+    results.append(runProcessing("cancel", fake, cancelledJobs, workDir.filePath("out-cancel"), parallel, 1000, true,
+                                 checks));
+
+    QJsonObject report;
+    report["tool"] = "promuxer-stress";
+    report["schema"] = 1;
+    report["results"] = results;
+    report["failed_checks"] = QJsonArray::fromStringList(checks.failures());
+    report["passed"] = checks.failures().isEmpty();
+
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            file.write(json);
+        }
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return checks.failures().isEmpty() ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+# Scheduler stress harness: drives FileProcessor and MediaAnalyzer through
+# thousands of simulated jobs served by fakeffmpeg.
+#
+#   qmake bench/stress/stress.pro && make
+#   ./promuxer-stress --jobs 5000 --parallel 8
+
+TEMPLATE = subdirs
+SUBDIRS = fakeffmpeg harness
+
+harness.file = harness.pro
+harness.depends = fakeffmpeg
@@ -0,0 +1,432 @@
+// promuxer-bench: end-to-end throughput benchmark for the processing core.
+//
+// Generates a reproducible corpus with ffmpeg lavfi (testsrc2 video, sine audio)
+// covering raw H.264/HEVC/AV1 streams and MP4/MKV/TS containers at several
+// sizes and bit depths, then measures MediaAnalyzer and FileProcessor on it.
+// Results are written as JSON so runs can be diffed for regressions.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include "FileProcessor.h"
+#include "MediaAnalyzer.h"
+#include "MediaInfo.h"
+
+namespace {
+
+struct SizeClass {
+    const char *name;
+    int width;
+    int height;
+    int seconds;
+};
+
+const SizeClass SizeClasses[] = {
+    {"small", 320, 240, 2},
+    {"medium", 1280, 720, 4},
+    {"large", 1920, 1080, 8},
+};
+
+struct CodecSpec {
+    const char *name;
+    QStringList encoders;        // first one available in this ffmpeg build wins
+    const char *rawMuxer;
+    const char *rawExtension;
+};
+
+struct CorpusEntry {
+    QString path;
+    QString codec;
+    QString container;           // "raw", "mp4", "mkv" or "ts"
+    QString muxer;               // ffmpeg -f value used to write it
+    QString sizeClass;
+    int bitDepth = 8;
+    bool raw = false;
+};
+
+QTextStream &err()
+{
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+QString ffmpegVersion(const QString &ffmpeg)
+{
+    QProcess process;
+    process.start(ffmpeg, QStringList() << "-hide_banner" << "-version");
+    if (!process.waitForFinished(10000)) {
+        return QString();
+    }
+    return QString::fromUtf8(process.readAllStandardOutput()).section('\n', 0, 0).trimmed();
+}
+
+QStringList availableEncoders(const QString &ffmpeg)
+{
+    QProcess process;
+    process.start(ffmpeg, QStringList() << "-hide_banner" << "-encoders");
+    process.waitForFinished(10000);
+    QStringList names;
+    const QStringList lines = QString::fromUtf8(process.readAllStandardOutput()).split('\n');
+    for (const QString &line : lines) {
+        const QStringList fields = line.simplified().split(' ');
+        if (fields.size() >= 2 && fields.at(0).size() == 6) {
+            names << fields.at(1);
+        }
+    }
+    return names;
+}
+
+QStringList encoderArgs(const QString &encoder)
+{
+    // Single-threaded, fixed-parameter encodes keep the corpus bit-identical across runs
+    if (encoder == "libx264") {
+        return {"-c:v", "libx264", "-preset", "ultrafast", "-crf", "23", "-threads", "1"};
+    }
+    if (encoder == "libx265") {
+        return {"-c:v", "libx265", "-preset", "ultrafast", "-crf", "28",
+                "-x265-params", "log-level=error:pools=1:frame-threads=1"};
+    }
+    if (encoder == "libsvtav1") {
+        return {"-c:v", "libsvtav1", "-preset", "12", "-crf", "40"};
+    }
+    if (encoder == "libaom-av1") {
+        return {"-c:v", "libaom-av1", "-cpu-used", "8", "-crf", "40", "-b:v", "0", "-threads", "1"};
+    }
+    return {"-c:v", encoder};
+}
+
+bool generateEntry(const QString &ffmpeg, const CorpusEntry &entry, const QString &encoder,
+                   const SizeClass &size)
+{
+    if (QFileInfo(entry.path).size() > 0) {
+        return true; // already generated with the same name, hence the same parameters
+    }
+
+    const QString duration = QString::number(size.seconds);
+    QStringList args;
+    args << "-hide_banner" << "-loglevel" << "error" << "-y"
+         << "-f" << "lavfi" << "-i"
+         << QString("testsrc2=size=%1x%2:rate=30:duration=%3").arg(size.width).arg(size.height).arg(duration);
+    if (!entry.raw) {
+        args << "-f" << "lavfi" << "-i"
+             << QString("sine=frequency=1000:sample_rate=48000:duration=%1").arg(duration);
+    }
+    args << encoderArgs(encoder);
+    args << "-pix_fmt" << (entry.bitDepth == 10 ? "yuv420p10le" : "yuv420p");
+    args << "-g" << "60";
+    if (entry.raw) {
+        args << "-an";
+    } else {
+        args << "-c:a" << "aac" << "-b:a" << "128k";
+    }
+    args << "-fflags" << "+bitexact" << "-flags" << "+bitexact" << "-map_metadata" << "-1";
+    args << "-f" << entry.muxer << entry.path;
+
+    QProcess process;
+    process.start(ffmpeg, args);
+    if (!process.waitForFinished(-1) || process.exitCode() != 0) {
+        err() << "  skipped " << QFileInfo(entry.path).fileName() << ": "
+              << QString::fromUtf8(process.readAllStandardError()).trimmed() << "\n";
+        err().flush();
+        QFile::remove(entry.path);
+        return false;
+    }
+    return true;
+}
+
+QList<CorpusEntry> buildCorpus(const QString &ffmpeg, const QString &directory,
+                               const QStringList &sizeFilter, const QStringList &codecFilter)
+{
+    const QList<CodecSpec> codecs = {
+        {"h264", {"libx264"}, "h264", "h264"},
+        {"hevc", {"libx265"}, "hevc", "h265"},
+        {"av1", {"libsvtav1", "libaom-av1"}, "ivf", "ivf"},
+    };
+    const QStringList containers = {"raw", "mp4", "mkv", "ts"};
+    const QStringList encoders = availableEncoders(ffmpeg);
+
+    QDir().mkpath(directory);
+    QList<CorpusEntry> corpus;
+
+    for (const CodecSpec &codec : codecs) {
+        if (!codecFilter.contains(codec.name)) {
+            continue;
+        }
+        QString encoder;
+        for (const QString &candidate : codec.encoders) {
+            if (encoders.contains(candidate)) {
+                encoder = candidate;
+                break;
+            }
+        }
+        if (encoder.isEmpty()) {
+            err() << "No encoder for " << codec.name << " in this ffmpeg build, skipping\n";
+            continue;
+        }
+
+        for (const SizeClass &size : SizeClasses) {
+            if (!sizeFilter.contains(size.name)) {
+                continue;
+            }
+            for (int bitDepth : {8, 10}) {
+                for (const QString &container : containers) {
+                    if (codec.name == QString("av1") && container == "ts") {
+                        continue; // no AV1 mapping for MPEG-TS in ffmpeg
+                    }
+                    CorpusEntry entry;
+                    entry.codec = codec.name;
+                    entry.container = container;
+                    entry.sizeClass = size.name;
+                    entry.bitDepth = bitDepth;
+                    entry.raw = (container == "raw");
+                    if (entry.raw) {
+                        entry.muxer = codec.rawMuxer;
+                    } else {
+                        entry.muxer = (container == "mkv") ? "matroska" : (container == "ts") ? "mpegts" : "mp4";
+                    }
+                    const QString extension = entry.raw ? QString(codec.rawExtension) : container;
+                    entry.path = QDir(directory).absoluteFilePath(
+                        QString("%1_%2_%3x%4_%5bit_%6.%7")
+                            .arg(codec.name, size.name).arg(size.width).arg(size.height)
+                            .arg(bitDepth).arg(container, extension));
+
+                    err() << "corpus: " << QFileInfo(entry.path).fileName() << "\n";
+                    err().flush();
+                    if (generateEntry(ffmpeg, entry, encoder, size)) {
+                        corpus << entry;
+                    }
+                }
+            }
+        }
+    }
+    return corpus;
+}
+
+double percentile(QVector<double> values, double fraction)
+{
+    if (values.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    int rank = qBound(0, int(fraction * values.size() + 0.999999) - 1, values.size() - 1);
+    return values.at(rank);
+}
+
+QJsonObject stageResult(const QString &stage, const QVector<double> &latenciesMs, qint64 bytes,
+                        qint64 wallMs, int failures)
+{
+    const double seconds = qMax<qint64>(1, wallMs) / 1000.0;
+    QJsonObject latency;
+    latency["p50"] = percentile(latenciesMs, 0.50);
+    latency["p99"] = percentile(latenciesMs, 0.99);
+    latency["max"] = percentile(latenciesMs, 1.0);
+
+    QJsonObject result;
+    result["stage"] = stage;
+    result["files"] = latenciesMs.size();
+    result["failures"] = failures;
+    result["bytes"] = double(bytes);
+    result["seconds"] = seconds;
+    result["files_per_s"] = latenciesMs.size() / seconds;
+    result["mb_per_s"] = bytes / (1024.0 * 1024.0) / seconds;
+    result["latency_ms"] = latency;
+    return result;
+}
+
+qint64 totalBytes(const QStringList &files)
+{
+    qint64 bytes = 0;
+    for (const QString &file : files) {
+        bytes += QFileInfo(file).size();
+    }
+    return bytes;
+}
+
+QJsonObject runAnalysis(const QStringList &files, QVector<MediaInfo> &infos)
+{
+    MediaAnalyzer analyzer;
+    infos = QVector<MediaInfo>(files.size());
+
+    // MediaAnalyzer probes one file at a time, so the gap between consecutive
+    // completions is the per-file latency.
+    QVector<double> latencies;
+    int failures = 0;
+    QElapsedTimer wall;
+    QElapsedTimer lap;
+    QEventLoop loop;
+
+    auto onDone = [&]() {
+        latencies << lap.nsecsElapsed() / 1e6;
+        lap.restart();
+        if (latencies.size() == files.size()) {
+            loop.quit();
+        }
+    };
+    QObject::connect(&analyzer, &MediaAnalyzer::analysisFinished, &loop,
+                     [&](int index, const MediaInfo &info) { infos[index] = info; onDone(); });
+    QObject::connect(&analyzer, &MediaAnalyzer::analysisError, &loop,
+                     [&](int, const QString &) { ++failures; onDone(); });
+
+    wall.start();
+    lap.start();
+    analyzer.analyzeFiles(files);
+    if (latencies.size() < files.size()) {
+        loop.exec();
+    }
+    return stageResult("analyze", latencies, totalBytes(files), wall.elapsed(), failures);
+}
+
+QJsonObject runProcessing(const QString &stage, const QStringList &files, const QVector<MediaInfo> &infos,
+                          const QString &outputDir, const QString &format, const QString &mode)
+{
+    QDir(outputDir).removeRecursively();
+    QDir().mkpath(outputDir);
+
+    FileProcessor processor;
+    QHash<QString, qint64> started;
+    QVector<double> latencies;
+    int failures = 0;
+    QElapsedTimer wall;
+    QEventLoop loop;
+
+    QObject::connect(&processor, &FileProcessor::progress, &loop,
+                     [&](int, int, const QString &file) { started[file] = wall.nsecsElapsed(); });
+    QObject::connect(&processor, &FileProcessor::fileProcessed, &loop,
+                     [&](const QString &file, bool success) {
+        latencies << (wall.nsecsElapsed() - started.value(file)) / 1e6;
+        if (!success) {
+            ++failures;
+        }
+    });
+    QObject::connect(&processor, &FileProcessor::finished, &loop, &QEventLoop::quit);
+
+    wall.start();
+    processor.processFiles(files, outputDir, format, infos, true, mode);
+    if (processor.isProcessing()) {
+        loop.exec();
+    }
+    return stageResult(stage, latencies, totalBytes(files), wall.elapsed(), failures);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Separate settings scope so user preferences (film grain etc.) do not skew results
+    app.setOrganizationName("ProMuxer");
+    app.setApplicationName("ProMuxerBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ProMuxer end-to-end throughput benchmark");
+    parser.addHelpOption();
+    QCommandLineOption corpusOption("corpus", "Corpus directory (reused between runs).", "dir",
+                                    QDir::temp().absoluteFilePath("promuxer-corpus"));
+    QCommandLineOption workOption("work", "Scratch directory for outputs.", "dir",
+                                  QDir::temp().absoluteFilePath("promuxer-bench-work"));
+    QCommandLineOption sizesOption("sizes", "Size classes: small,medium,large.", "list", "small,medium");
+    QCommandLineOption codecsOption("codecs", "Codecs: h264,hevc,av1.", "list", "h264,hevc,av1");
+    QCommandLineOption formatOption("format", "Output container for the muxing stage.", "format", "mp4");
+    QCommandLineOption outputOption("output", "Write JSON results to this file instead of stdout.", "file");
+    QCommandLineOption ffmpegOption("ffmpeg", "ffmpeg used to generate the corpus.", "path", "ffmpeg");
+    parser.addOptions({corpusOption, workOption, sizesOption, codecsOption, formatOption, outputOption, ffmpegOption});
+    parser.process(app);
+
+    const QString ffmpeg = parser.value(ffmpegOption);
+    const QString version = ffmpegVersion(ffmpeg);
+    if (version.isEmpty()) {
+        err() << "ffmpeg not found: " << ffmpeg << "\n";
+        return 1;
+    }
+
+    const QList<CorpusEntry> corpus = buildCorpus(ffmpeg, parser.value(corpusOption),
+                                                  parser.value(sizesOption).split(',', Qt::SkipEmptyParts),
+                                                  parser.value(codecsOption).split(',', Qt::SkipEmptyParts));
+    if (corpus.isEmpty()) {
+        err() << "Empty corpus, nothing to benchmark\n";
+        return 1;
+    }
+
+    QStringList allFiles;
+    QStringList rawFiles;
+    QJsonArray corpusJson;
+    for (const CorpusEntry &entry : corpus) {
+        allFiles << entry.path;
+        if (entry.raw) {
+            rawFiles << entry.path;
+        }
+        QJsonObject item;
+        item["file"] = QFileInfo(entry.path).fileName();
+        item["codec"] = entry.codec;
+        item["container"] = entry.container;
+        item["size_class"] = entry.sizeClass;
+        item["bit_depth"] = entry.bitDepth;
+        item["bytes"] = double(QFileInfo(entry.path).size());
+        corpusJson.append(item);
+    }
+
+    const QString workDir = parser.value(workOption);
+    QJsonArray results;
+
+    err() << "Running analysis over " << allFiles.size() << " files\n";
+    err().flush();
+    QVector<MediaInfo> infos;
+    results.append(runAnalysis(allFiles, infos));
+
+    err() << "Running muxing stage\n";
+    err().flush();
+    results.append(runProcessing("mux_" + parser.value(formatOption), allFiles, infos,
+                                 QDir(workDir).absoluteFilePath("mux"), parser.value(formatOption), "muxing"));
+
+    if (!rawFiles.isEmpty()) {
+        QVector<MediaInfo> rawInfos;
+        for (int i = 0; i < allFiles.size(); ++i) {
+            if (rawFiles.contains(allFiles.at(i))) {
+                rawInfos << infos.at(i);
+            }
+        }
+        err() << "Running binToYuv stage\n";
+        err().flush();
+        results.append(runProcessing("binToYuv", rawFiles, rawInfos,
+                                     QDir(workDir).absoluteFilePath("yuv"), "yuv", "binToYuv"));
+    }
+    QDir(workDir).removeRecursively();
+
+    QJsonObject environment;
+    environment["ffmpeg"] = version;
+    environment["os"] = QSysInfo::prettyProductName();
+    environment["cpu"] = QSysInfo::currentCpuArchitecture();
+    environment["threads"] = QThread::idealThreadCount();
+
+    QJsonObject report;
+    report["tool"] = "promuxer-bench";
+    report["schema"] = 1;
+    report["environment"] = environment;
+    report["corpus"] = corpusJson;
+    report["results"] = results;
+
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err() << "Cannot write " << parser.value(outputOption) << "\n";
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
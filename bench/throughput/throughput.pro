@@ -0,0 +1,19 @@
+# End-to-end throughput benchmark: generates a synthetic corpus with ffmpeg
+# lavfi and runs it through MediaAnalyzer and FileProcessor.
+#
+#   qmake bench/throughput/throughput.pro && make
+#   ./promuxer-bench --corpus /tmp/promuxer-corpus --output results.json
+
+QT += core
+QT -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = promuxer-bench
+TEMPLATE = app
+
+include(../../src/core/core.pri)
+
+SOURCES += \
+    main.cpp
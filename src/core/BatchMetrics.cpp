@@ -0,0 +1,306 @@
+#include "BatchMetrics.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QPair>
+#include <QSaveFile>
+#include <algorithm>
+
+namespace {
+
+BatchMetrics::Percentiles percentiles(QVector<double> values)
+{
+    BatchMetrics::Percentiles result;
+    result.samples = values.size();
+    if (values.isEmpty()) {
+        return result;
+    }
+    std::sort(values.begin(), values.end());
+    auto at = [&values](double fraction) {
+        int rank = qBound(0, int(fraction * values.size() + 0.999999) - 1, values.size() - 1);
+        return values.at(rank);
+    };
+    result.p50 = at(0.50);
+    result.p90 = at(0.90);
+    result.p99 = at(0.99);
+    result.max = values.last();
+    return result;
+}
+
+QJsonObject percentilesToJson(const BatchMetrics::Percentiles &p)
+{
+    QJsonObject object;
+    object["samples"] = p.samples;
+    object["p50"] = p.p50;
+    object["p90"] = p.p90;
+    object["p99"] = p.p99;
+    object["max"] = p.max;
+    return object;
+}
+
+bool saveAtomically(const QString &filePath, const QByteArray &data, QString *error)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+BatchMetrics::BatchMetrics()
+    : m_startMs(0)
+    , m_endMs(0)
+    , m_startEpochMs(0)
+    , m_running(false)
+{
+}
+
+qint64 BatchMetrics::clockMs()
+{
+    static QElapsedTimer clock = [] {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return clock.elapsed();
+}
+
+QString BatchMetrics::phaseName(Phase phase)
+{
+    switch (phase) {
+    case QueueWait:   return "queue_wait";
+    case Probe:       return "probe";
+    case Spawn:       return "spawn";
+    case Mux:         return "mux";
+    case PostProcess: return "post_process";
+    case Total:       return "total";
+    default:          return "unknown";
+    }
+}
+
+void BatchMetrics::begin()
+{
+    m_jobs.clear();
+    m_startMs = clockMs();
+    m_endMs = 0;
+    m_startEpochMs = QDateTime::currentMSecsSinceEpoch();
+    m_running = true;
+    m_ioAtStart = BlockIo::stats();
+    m_ioAtEnd = m_ioAtStart;
+}
+
+void BatchMetrics::addJob(const JobTiming &timing)
+{
+    m_jobs.append(timing);
+}
+
+void BatchMetrics::finish()
+{
+    m_endMs = clockMs();
+    m_running = false;
+    m_ioAtEnd = BlockIo::stats();
+}
+
+BlockIo::Stats BatchMetrics::blockIoStats() const
+{
+    return BlockIo::difference(m_running ? BlockIo::stats() : m_ioAtEnd, m_ioAtStart);
+}
+
+qint64 BatchMetrics::phaseDuration(const JobTiming &t, Phase phase)
+{
+    auto span = [](qint64 from, qint64 to) -> qint64 {
+        return (from >= 0 && to >= from) ? to - from : -1;
+    };
+    switch (phase) {
+    case QueueWait:   return span(t.queuedMs, t.spawnMs);
+    case Probe:       return span(t.probeStartMs, t.probeEndMs);
+    case Spawn:       return span(t.spawnMs, t.firstProgressMs);
+    case Mux:         return span(t.firstProgressMs >= 0 ? t.firstProgressMs : t.spawnMs, t.muxEndMs);
+    case PostProcess: return span(t.muxEndMs, t.postEndMs);
+    case Total:       return span(t.queuedMs, t.postEndMs);
+    default:          return -1;
+    }
+}
+
+BatchMetrics::Summary BatchMetrics::summary() const
+{
+    Summary s;
+    s.jobs = m_jobs.size();
+    QVector<double> durations[PhaseCount];
+    for (const JobTiming &timing : m_jobs) {
+        if (!timing.success) {
+            s.failed++;
+        }
+        s.bytesRead += timing.bytesRead;
+        s.bytesWritten += timing.bytesWritten;
+        for (int phase = 0; phase < PhaseCount; ++phase) {
+            const qint64 duration = phaseDuration(timing, Phase(phase));
+            if (duration >= 0) {
+                durations[phase].append(double(duration));
+            }
+        }
+    }
+
+    const qint64 endMs = m_running ? clockMs() : m_endMs;
+    s.seconds = qMax<qint64>(0, endMs - m_startMs) / 1000.0;
+    if (s.seconds > 0.0) {
+        s.jobsPerSecond = s.jobs / s.seconds;
+        s.readMBps = s.bytesRead / (1024.0 * 1024.0) / s.seconds;
+        s.writeMBps = s.bytesWritten / (1024.0 * 1024.0) / s.seconds;
+    }
+    s.blockIo = blockIoStats();
+    if (s.seconds > 0.0) {
+        s.ioReadsPerSecond = s.blockIo.reads / s.seconds;
+        s.ioWritesPerSecond = s.blockIo.writes / s.seconds;
+    }
+    s.ioLatencyP50Us = BlockIo::latencyPercentileUs(s.blockIo, 0.50);
+    s.ioLatencyP99Us = BlockIo::latencyPercentileUs(s.blockIo, 0.99);
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        s.phases[phase] = percentiles(durations[phase]);
+    }
+    return s;
+}
+
+QJsonObject BatchMetrics::toJson() const
+{
+    const Summary s = summary();
+
+    QJsonObject phases;
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        phases[phaseName(Phase(phase))] = percentilesToJson(s.phases[phase]);
+    }
+
+    QJsonObject summaryObject;
+    summaryObject["jobs"] = s.jobs;
+    summaryObject["failed"] = s.failed;
+    summaryObject["bytes_read"] = double(s.bytesRead);
+    summaryObject["bytes_written"] = double(s.bytesWritten);
+    summaryObject["seconds"] = s.seconds;
+    summaryObject["jobs_per_s"] = s.jobsPerSecond;
+    summaryObject["read_mb_per_s"] = s.readMBps;
+    summaryObject["write_mb_per_s"] = s.writeMBps;
+    summaryObject["phase_ms"] = phases;
+
+    // Histogram bucket i holds requests that took [2^i, 2^(i+1)) us
+    QJsonArray histogram;
+    for (quint64 count : s.blockIo.latencyHistogram) {
+        histogram.append(double(count));
+    }
+    QJsonObject blockIo;
+    blockIo["reads"] = double(s.blockIo.reads);
+    blockIo["writes"] = double(s.blockIo.writes);
+    blockIo["bytes_read"] = double(s.blockIo.bytesRead);
+    blockIo["bytes_written"] = double(s.blockIo.bytesWritten);
+    blockIo["uring_requests"] = double(s.blockIo.uringRequests);
+    blockIo["reads_per_s"] = s.ioReadsPerSecond;
+    blockIo["writes_per_s"] = s.ioWritesPerSecond;
+    blockIo["latency_p50_us"] = double(s.ioLatencyP50Us);
+    blockIo["latency_p99_us"] = double(s.ioLatencyP99Us);
+    blockIo["latency_histogram_log2_us"] = histogram;
+    summaryObject["block_io"] = blockIo;
+
+    // Per-job timestamps are relative to the batch start
+    auto relative = [this](qint64 ms) -> QJsonValue {
+        return ms >= 0 ? QJsonValue(double(ms - m_startMs)) : QJsonValue();
+    };
+    QJsonArray jobs;
+    for (const JobTiming &t : m_jobs) {
+        QJsonObject job;
+        job["input"] = t.inputFile;
+        job["output"] = t.outputFile;
+        job["success"] = t.success;
+        job["bytes_read"] = double(t.bytesRead);
+        job["bytes_written"] = double(t.bytesWritten);
+        job["queued_ms"] = relative(t.queuedMs);
+        job["probe_start_ms"] = relative(t.probeStartMs);
+        job["probe_end_ms"] = relative(t.probeEndMs);
+        job["spawn_ms"] = relative(t.spawnMs);
+        job["first_progress_ms"] = relative(t.firstProgressMs);
+        job["mux_end_ms"] = relative(t.muxEndMs);
+        job["post_end_ms"] = relative(t.postEndMs);
+        jobs.append(job);
+    }
+
+    QJsonObject root;
+    root["started_at"] = QDateTime::fromMSecsSinceEpoch(m_startEpochMs).toUTC().toString(Qt::ISODateWithMs);
+    root["summary"] = summaryObject;
+    root["jobs"] = jobs;
+    return root;
+}
+
+QString BatchMetrics::toPrometheus() const
+{
+    const Summary s = summary();
+    QString out;
+
+    auto metric = [&out](const QString &name, const QString &type, const QString &help) {
+        out += QString("# HELP %1 %2\n# TYPE %1 %3\n").arg(name, help, type);
+    };
+
+    metric("promuxer_batch_jobs", "gauge", "Jobs completed in the last batch.");
+    out += QString("promuxer_batch_jobs{result=\"success\"} %1\n").arg(s.jobs - s.failed);
+    out += QString("promuxer_batch_jobs{result=\"failed\"} %1\n").arg(s.failed);
+
+    metric("promuxer_batch_duration_seconds", "gauge", "Wall time of the last batch.");
+    out += QString("promuxer_batch_duration_seconds %1\n").arg(s.seconds, 0, 'f', 3);
+
+    metric("promuxer_batch_bytes", "gauge", "Bytes moved by the last batch.");
+    out += QString("promuxer_batch_bytes{direction=\"read\"} %1\n").arg(s.bytesRead);
+    out += QString("promuxer_batch_bytes{direction=\"written\"} %1\n").arg(s.bytesWritten);
+
+    metric("promuxer_batch_throughput_jobs_per_second", "gauge", "Job throughput of the last batch.");
+    out += QString("promuxer_batch_throughput_jobs_per_second %1\n").arg(s.jobsPerSecond, 0, 'f', 4);
+
+    metric("promuxer_batch_phase_seconds", "gauge", "Per-job phase latency quantiles of the last batch.");
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        const Percentiles &p = s.phases[phase];
+        if (p.samples == 0) {
+            continue;
+        }
+        const QString name = phaseName(Phase(phase));
+        const QPair<const char *, double> quantiles[] = {
+            {"0.5", p.p50}, {"0.9", p.p90}, {"0.99", p.p99}, {"1", p.max}};
+        for (const auto &q : quantiles) {
+            out += QString("promuxer_batch_phase_seconds{phase=\"%1\",quantile=\"%2\"} %3\n")
+                       .arg(name, q.first).arg(q.second / 1000.0, 0, 'f', 3);
+        }
+    }
+
+    const quint64 ioRequests = s.blockIo.reads + s.blockIo.writes;
+    if (ioRequests > 0) {
+        metric("promuxer_batch_block_io_requests", "gauge", "In-process I/O requests of the last batch.");
+        out += QString("promuxer_batch_block_io_requests{op=\"read\"} %1\n").arg(s.blockIo.reads);
+        out += QString("promuxer_batch_block_io_requests{op=\"write\"} %1\n").arg(s.blockIo.writes);
+
+        metric("promuxer_batch_block_io_requests_per_second", "gauge", "In-process I/O request rate of the last batch.");
+        out += QString("promuxer_batch_block_io_requests_per_second{op=\"read\"} %1\n").arg(s.ioReadsPerSecond, 0, 'f', 2);
+        out += QString("promuxer_batch_block_io_requests_per_second{op=\"write\"} %1\n").arg(s.ioWritesPerSecond, 0, 'f', 2);
+
+        // Upper edges of the log2 histogram buckets; the full histogram is in the JSON export
+        metric("promuxer_batch_block_io_latency_seconds", "gauge", "In-process I/O request latency quantiles of the last batch.");
+        out += QString("promuxer_batch_block_io_latency_seconds{quantile=\"0.5\"} %1\n").arg(s.ioLatencyP50Us / 1e6, 0, 'f', 6);
+        out += QString("promuxer_batch_block_io_latency_seconds{quantile=\"0.99\"} %1\n").arg(s.ioLatencyP99Us / 1e6, 0, 'f', 6);
+    }
+
+    metric("promuxer_batch_last_completion_timestamp_seconds", "gauge", "Unix time the last batch ended.");
+    out += QString("promuxer_batch_last_completion_timestamp_seconds %1\n")
+               .arg(QDateTime::currentSecsSinceEpoch());
+    return out;
+}
+
+bool BatchMetrics::writeJson(const QString &filePath, QString *error) const
+{
+    return saveAtomically(filePath, QJsonDocument(toJson()).toJson(QJsonDocument::Indented), error);
+}
+
+bool BatchMetrics::writePrometheusTextfile(const QString &filePath, QString *error) const
+{
+    // The textfile collector only reads *.prom; QSaveFile renames into place atomically
+    return saveAtomically(filePath, toPrometheus().toUtf8(), error);
+}
@@ -0,0 +1,105 @@
+#ifndef BATCHMETRICS_H
+#define BATCHMETRICS_H
+
+#include <QString>
+#include <QVector>
+#include <QJsonObject>
+#include <QtGlobal>
+#include "BlockIo.h"
+
+// Phase timestamps of one job, in milliseconds on the monotonic clock
+// (BatchMetrics::clockMs). -1 means the phase was not reached.
+struct JobTiming {
+    QString inputFile;
+    QString outputFile;
+    qint64 queuedMs = -1;          // batch submitted
+    qint64 probeStartMs = -1;      // ffprobe started (usually well before the batch)
+    qint64 probeEndMs = -1;
+    qint64 spawnMs = -1;           // ffmpeg start requested
+    qint64 firstProgressMs = -1;   // first "time=" progress line
+    qint64 muxEndMs = -1;          // packets written; faststart rewrite (if any) starts here
+    qint64 postEndMs = -1;         // process exited, output complete
+    qint64 bytesRead = 0;
+    qint64 bytesWritten = 0;
+    bool success = false;
+};
+
+// Collects JobTimings for one batch and turns them into throughput figures and
+// per-phase latency percentiles. Exports JSON for offline analysis and a
+// Prometheus textfile for the node exporter's textfile collector.
+//
+// In-process I/O (BlockIo) is process-wide, so begin() and finish() snapshot
+// BlockIo::stats() and the batch reports the requests made in between.
+class BatchMetrics
+{
+public:
+    enum Phase {
+        QueueWait,          // queued -> spawn
+        Probe,              // probe start -> probe end
+        Spawn,              // spawn -> first progress (process start + demuxer open)
+        Mux,                // first progress -> mux end
+        PostProcess,        // mux end -> exit (faststart moov rewrite)
+        Total,              // queued -> exit
+        PhaseCount
+    };
+
+    struct Percentiles {
+        int samples = 0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    struct Summary {
+        int jobs = 0;
+        int failed = 0;
+        qint64 bytesRead = 0;
+        qint64 bytesWritten = 0;
+        double seconds = 0.0;          // batch wall time so far
+        double jobsPerSecond = 0.0;
+        double readMBps = 0.0;
+        double writeMBps = 0.0;
+        Percentiles phases[PhaseCount];
+
+        BlockIo::Stats blockIo;        // in-process requests during the batch
+        double ioReadsPerSecond = 0.0;
+        double ioWritesPerSecond = 0.0;
+        quint64 ioLatencyP50Us = 0;
+        quint64 ioLatencyP99Us = 0;
+    };
+
+    BatchMetrics();
+
+    static qint64 clockMs();            // monotonic, shared by every component
+    static QString phaseName(Phase phase);
+
+    void begin();
+    void addJob(const JobTiming &timing);
+    void finish();
+
+    bool isRunning() const { return m_running; }
+    const QVector<JobTiming> &jobs() const { return m_jobs; }
+    Summary summary() const;
+    BlockIo::Stats blockIoStats() const;  // live while running
+
+    QJsonObject toJson() const;
+    QString toPrometheus() const;
+
+    // Both writes go through QSaveFile, so readers never see a partial file
+    bool writeJson(const QString &filePath, QString *error = nullptr) const;
+    bool writePrometheusTextfile(const QString &filePath, QString *error = nullptr) const;
+
+private:
+    static qint64 phaseDuration(const JobTiming &timing, Phase phase);
+
+    QVector<JobTiming> m_jobs;
+    qint64 m_startMs;
+    qint64 m_endMs;
+    qint64 m_startEpochMs;
+    bool m_running;
+    BlockIo::Stats m_ioAtStart;
+    BlockIo::Stats m_ioAtEnd;
+};
+
+#endif // BATCHMETRICS_H
@@ -0,0 +1,412 @@
+#include "BatchPlan.h"
+#include "ProgressEstimator.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+namespace {
+
+constexpr int kSchema = 1;
+
+JobCost::Kind kindFromName(const QString &name)
+{
+    if (name == CostModel::kindName(JobCost::DecodeToYuv)) {
+        return JobCost::DecodeToYuv;
+    }
+    if (name == CostModel::kindName(JobCost::Reencode)) {
+        return JobCost::Reencode;
+    }
+    return JobCost::StreamCopy;
+}
+
+QJsonArray rowsToJson(const QList<int> &rows)
+{
+    QJsonArray array;
+    for (int row : rows) {
+        array.append(row);
+    }
+    return array;
+}
+
+QJsonObject costToJson(const JobCost &cost)
+{
+    QJsonObject json;
+    json["kind"] = CostModel::kindName(cost.kind);
+    json["codec_key"] = cost.codecKey;
+    json["input_bytes"] = double(cost.inputBytes);
+    json["pixels"] = cost.pixels;
+    json["estimated_s"] = cost.estimatedSeconds;
+    json["cpu_cores"] = cost.cpuCores;
+    json["memory_bytes"] = double(cost.memoryBytes);
+    return json;
+}
+
+JobCost costFromJson(const QJsonObject &json)
+{
+    JobCost cost;
+    cost.kind = kindFromName(json["kind"].toString());
+    cost.codecKey = json["codec_key"].toString();
+    cost.inputBytes = qint64(json["input_bytes"].toDouble());
+    cost.pixels = json["pixels"].toDouble();
+    cost.estimatedSeconds = json["estimated_s"].toDouble();
+    cost.cpuCores = json["cpu_cores"].toDouble(1.0);
+    cost.memoryBytes = qint64(json["memory_bytes"].toDouble());
+    return cost;
+}
+
+QJsonObject jobToJson(const PlannedJob &job)
+{
+    QJsonObject json;
+    json["row"] = job.row;
+    if (job.isLinked()) {
+        json["linked_to"] = job.linkedTo;
+    }
+    json["input"] = job.inputFile;
+    json["output"] = job.outputFile;
+    json["extra_outputs"] = QJsonArray::fromStringList(job.extraOutputs);
+    if (!job.joinedRows.isEmpty()) {
+        json["joined_rows"] = rowsToJson(job.joinedRows);
+    }
+    json["arguments"] = QJsonArray::fromStringList(job.arguments);
+    json["expected_frames"] = double(job.expectedFrames);
+    json["expected_duration_ms"] = double(job.expectedDurationMs);
+    json["cost"] = costToJson(job.cost);
+    if (!job.readRanges.isEmpty()) {
+        QJsonArray ranges;
+        for (const IoPolicy::FileRange &range : job.readRanges) {
+            QJsonObject entry;
+            entry["file"] = range.file;
+            entry["begin"] = double(range.begin);
+            entry["end"] = double(range.end);
+            ranges.append(entry);
+        }
+        json["read_ranges"] = ranges;
+    }
+    if (job.seeksInput) {
+        json["seeks_input"] = true;
+    }
+    if (job.injectsHdr()) {
+        QJsonArray segments;
+        for (const SeiInjector::Segment &segment : job.injectSegments) {
+            QJsonObject entry;
+            entry["file"] = segment.file;
+            entry["begin"] = double(segment.begin);
+            entry["end"] = double(segment.end);
+            segments.append(entry);
+        }
+        QJsonObject hdr;
+        hdr["codec"] = NalIndex::codecName(job.injectCodec);
+        hdr["master_display"] = job.injectMetadata.masterDisplayString();
+        hdr["max_cll"] = job.injectMetadata.maxCllString();
+        hdr["segments"] = segments;
+        json["hdr_injection"] = hdr;
+    }
+    return json;
+}
+
+bool jobFromJson(const QJsonObject &json, int rows, PlannedJob *job, QString *error)
+{
+    job->row = json["row"].toInt(-1);
+    job->linkedTo = json["linked_to"].toInt(-1);
+    job->inputFile = json["input"].toString();
+    job->outputFile = json["output"].toString();
+    for (const QJsonValue &value : json["extra_outputs"].toArray()) {
+        job->extraOutputs << value.toString();
+    }
+    for (const QJsonValue &value : json["joined_rows"].toArray()) {
+        job->joinedRows << value.toInt(-1);
+    }
+    for (const QJsonValue &value : json["arguments"].toArray()) {
+        job->arguments << value.toString();
+    }
+    job->expectedFrames = qint64(json["expected_frames"].toDouble(-1));
+    job->expectedDurationMs = qint64(json["expected_duration_ms"].toDouble(-1));
+    job->cost = costFromJson(json["cost"].toObject());
+    for (const QJsonValue &value : json["read_ranges"].toArray()) {
+        const QJsonObject range = value.toObject();
+        job->readRanges << IoPolicy::FileRange{range["file"].toString(), qint64(range["begin"].toDouble()),
+                                               qint64(range["end"].toDouble(-1))};
+    }
+    job->seeksInput = json["seeks_input"].toBool();
+
+    const QJsonObject hdr = json["hdr_injection"].toObject();
+    if (!hdr.isEmpty()) {
+        job->injectCodec = NalIndex::codecFromName(hdr["codec"].toString());
+        const QString masterDisplay = hdr["master_display"].toString();
+        const QString maxCll = hdr["max_cll"].toString();
+        if ((!masterDisplay.isEmpty() && !job->injectMetadata.setMasterDisplay(masterDisplay))
+            || (!maxCll.isEmpty() && !job->injectMetadata.setMaxCll(maxCll))) {
+            *error = QString("job %1: invalid HDR metadata").arg(job->row);
+            return false;
+        }
+        for (const QJsonValue &value : hdr["segments"].toArray()) {
+            const QJsonObject segment = value.toObject();
+            job->injectSegments << SeiInjector::Segment{segment["file"].toString(),
+                                                        qint64(segment["begin"].toDouble()),
+                                                        qint64(segment["end"].toDouble())};
+        }
+        if (job->injectCodec == NalIndex::Codec::Unknown || job->injectMetadata.isEmpty()
+            || job->injectSegments.isEmpty()) {
+            *error = QString("job %1: incomplete HDR injection").arg(job->row);
+            return false;
+        }
+    }
+
+    // Rows index the file list; a bad one would address the wrong progress slot
+    bool rowsValid = job->row >= 0 && job->row < rows && job->linkedTo < rows;
+    for (int row : std::as_const(job->joinedRows)) {
+        rowsValid = rowsValid && row >= 0 && row < rows;
+    }
+    if (!rowsValid) {
+        *error = QString("job for %1: row out of range").arg(job->inputFile);
+        return false;
+    }
+    if (job->arguments.isEmpty() || job->outputFile.isEmpty()) {
+        *error = QString("job %1: no command or output").arg(job->row);
+        return false;
+    }
+    return true;
+}
+
+QString commandLine(const QString &program, const QStringList &arguments)
+{
+    QStringList words{program};
+    for (const QString &argument : arguments) {
+        words << BatchPlan::shellQuote(argument);
+    }
+    return words.join(' ');
+}
+
+} // namespace
+
+int BatchPlan::runCount() const
+{
+    int count = 0;
+    for (const PlannedJob &job : jobs) {
+        count += job.isLinked() ? 0 : 1;
+    }
+    return count;
+}
+
+double BatchPlan::estimatedSeconds() const
+{
+    double seconds = 0.0;
+    for (const PlannedJob &job : jobs) {
+        seconds += job.isLinked() ? 0.0 : job.cost.estimatedSeconds;
+    }
+    return seconds;
+}
+
+QString BatchPlan::describe() const
+{
+    QStringList lines;
+    lines << QString("%1 jobs for %2 inputs, about %3 of work (%4, %5)")
+                 .arg(runCount())
+                 .arg(files.size())
+                 .arg(ProgressEstimator::formatDuration(qint64(estimatedSeconds() * 1000.0)))
+                 .arg(processingMode, outputFormat);
+    for (const QString &note : notes) {
+        lines << "  " + note;
+    }
+
+    int number = 0;
+    for (const PlannedJob &job : jobs) {
+        if (job.isLinked()) {
+            continue;
+        }
+        lines << QString();
+        lines << QString("%1. %2 -> %3  [%4, ~%5 s, %6 cores, %7 MB]")
+                     .arg(++number)
+                     .arg(QFileInfo(job.inputFile).fileName(), job.outputs().join(", "))
+                     .arg(CostModel::kindName(job.cost.kind))
+                     .arg(job.cost.estimatedSeconds, 0, 'f', 1)
+                     .arg(job.cost.cpuCores, 0, 'g', 3)
+                     .arg(job.cost.memoryBytes / (1024 * 1024));
+        for (int row : job.joinedRows) {
+            lines << "   + " + QFileInfo(files.value(row)).fileName();
+        }
+        if (job.injectsHdr()) {
+            lines << QString("   HDR metadata through stdin: %1").arg(job.injectMetadata.describe());
+        }
+        lines << "   " + commandLine(program.isEmpty() ? QString("ffmpeg") : program, job.arguments);
+        for (const PlannedJob &linked : jobs) {
+            if (linked.linkedTo == job.row) {
+                lines << QString("   %1 of %2 -> %3").arg(dedupMode, QFileInfo(linked.inputFile).fileName(),
+                                                         linked.outputs().join(", "));
+            }
+        }
+    }
+    return lines.join('\n');
+}
+
+QJsonObject BatchPlan::toJson() const
+{
+    QJsonArray jobArray;
+    for (const PlannedJob &job : jobs) {
+        jobArray.append(jobToJson(job));
+    }
+    QJsonObject json;
+    json["tool"] = "promuxer";
+    json["schema"] = kSchema;
+    json["created"] = QDateTime::fromMSecsSinceEpoch(createdMs).toString(Qt::ISODate);
+    json["program"] = program;
+    json["processing_mode"] = processingMode;
+    json["output_format"] = outputFormat;
+    json["overwrite"] = overwrite;
+    json["dedup_mode"] = dedupMode;
+    json["estimated_s"] = estimatedSeconds();
+    json["files"] = QJsonArray::fromStringList(files);
+    json["notes"] = QJsonArray::fromStringList(notes);
+    json["jobs"] = jobArray;
+    return json;
+}
+
+bool BatchPlan::fromJson(const QJsonObject &json, BatchPlan *plan, QString *error)
+{
+    if (json["tool"].toString() != "promuxer" || json["schema"].toInt() != kSchema) {
+        *error = QString("not a ProMuxer plan (schema %1)").arg(kSchema);
+        return false;
+    }
+    BatchPlan parsed;
+    parsed.createdMs = QDateTime::fromString(json["created"].toString(), Qt::ISODate).toMSecsSinceEpoch();
+    parsed.program = json["program"].toString();
+    parsed.processingMode = json["processing_mode"].toString("muxing");
+    parsed.outputFormat = json["output_format"].toString();
+    parsed.overwrite = json["overwrite"].toBool();
+    parsed.dedupMode = json["dedup_mode"].toString("off");
+    for (const QJsonValue &value : json["files"].toArray()) {
+        parsed.files << value.toString();
+    }
+    for (const QJsonValue &value : json["notes"].toArray()) {
+        parsed.notes << value.toString();
+    }
+    for (const QJsonValue &value : json["jobs"].toArray()) {
+        PlannedJob job;
+        if (!jobFromJson(value.toObject(), parsed.files.size(), &job, error)) {
+            return false;
+        }
+        parsed.jobs << job;
+    }
+    *plan = parsed;
+    return true;
+}
+
+bool BatchPlan::save(const QString &filePath, QString *error) const
+{
+    const QByteArray data = QJsonDocument(toJson()).toJson(QJsonDocument::Indented);
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool BatchPlan::load(const QString &filePath, BatchPlan *plan, QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        *error = parseError.errorString();
+        return false;
+    }
+    return fromJson(document.object(), plan, error);
+}
+
+QString BatchPlan::shellQuote(const QString &text)
+{
+    static const QString safe("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789+-_=.,/:@%");
+    bool plain = !text.isEmpty();
+    for (const QChar c : text) {
+        plain = plain && safe.contains(c);
+    }
+    if (plain) {
+        return text;
+    }
+    QString quoted = text;
+    quoted.replace('\'', "'\\''");
+    return '\'' + quoted + '\'';
+}
+
+QString BatchPlan::toShellScript() const
+{
+    QStringList lines;
+    lines << "#!/bin/sh";
+    lines << QString("# ProMuxer batch plan: %1 jobs for %2 inputs, about %3 of work")
+                 .arg(runCount()).arg(files.size())
+                 .arg(ProgressEstimator::formatDuration(qint64(estimatedSeconds() * 1000.0)));
+    lines << QString("# compiled %1; FFMPEG overrides the ffmpeg used")
+                 .arg(QDateTime::fromMSecsSinceEpoch(createdMs).toString(Qt::ISODate));
+    for (const QString &note : notes) {
+        lines << "# " + note;
+    }
+    // Assigned separately so the compiled path is quoted like any other argument
+    lines << QString("[ -n \"${FFMPEG:-}\" ] || FFMPEG=%1")
+                 .arg(shellQuote(program.isEmpty() ? QString("ffmpeg") : program));
+    lines << "failed=0";
+
+    auto command = [](const PlannedJob &job) {
+        return commandLine("\"$FFMPEG\"", job.arguments);
+    };
+    auto link = [this](const QString &source, const QString &target) {
+        const QString copy = QString("cp %1 %2").arg(shellQuote(source), shellQuote(target));
+        if (dedupMode == "hardlink") {
+            return QString("ln %1 %2 || %3").arg(shellQuote(source), shellQuote(target), copy);
+        }
+        return QString("cp --reflink=auto %1 %2 || %3").arg(shellQuote(source), shellQuote(target), copy);
+    };
+
+    for (const PlannedJob &job : jobs) {
+        if (job.isLinked()) {
+            continue;
+        }
+        lines << QString();
+        lines << QString("# %1 -> %2").arg(QFileInfo(job.inputFile).fileName(), QFileInfo(job.outputFile).fileName());
+        if (job.injectsHdr()) {
+            // The SEI rewrite happens in ProMuxer between the file and ffmpeg's stdin
+            lines << "# needs the in-process HDR metadata rewrite: ProMuxer --run-plan";
+            lines << "failed=$((failed + 1))";
+            continue;
+        }
+
+        QList<const PlannedJob *> linked;
+        for (const PlannedJob &other : jobs) {
+            if (other.linkedTo == job.row) {
+                linked << &other;
+            }
+        }
+        if (linked.isEmpty()) {
+            lines << command(job) + " || failed=$((failed + 1))";
+            continue;
+        }
+        // Duplicates link to the outputs, or run on their own when the job fails
+        lines << "if " + command(job) + "; then";
+        for (const PlannedJob *duplicate : std::as_const(linked)) {
+            const QStringList sources = job.outputs();
+            const QStringList targets = duplicate->outputs();
+            for (int i = 0; i < sources.size() && i < targets.size(); ++i) {
+                lines << "    " + link(sources.at(i), targets.at(i)) + " || failed=$((failed + 1))";
+            }
+        }
+        lines << "else";
+        lines << "    failed=$((failed + 1))";
+        for (const PlannedJob *duplicate : std::as_const(linked)) {
+            lines << (duplicate->injectsHdr() ? "    # " + QFileInfo(duplicate->inputFile).fileName()
+                                                    + " needs the in-process HDR metadata rewrite"
+                                              : "    " + command(*duplicate) + " || failed=$((failed + 1))");
+        }
+        lines << "fi";
+    }
+    lines << QString();
+    lines << "[ \"$failed\" -eq 0 ] || echo \"$failed job(s) failed\" >&2";
+    lines << "[ \"$failed\" -eq 0 ]";
+    return lines.join('\n') + '\n';
+}
@@ -0,0 +1,81 @@
+#ifndef BATCHPLAN_H
+#define BATCHPLAN_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include "CostModel.h"
+#include "HdrMetadata.h"
+#include "IoPolicy.h"
+#include "NalIndex.h"
+#include "SeiInjector.h"
+
+// One ffmpeg run of a compiled batch
+struct PlannedJob {
+    int row = -1;                   // index of the input in BatchPlan::files
+    int linkedTo = -1;              // duplicate: row of the job whose outputs it links, -1 otherwise
+    QString inputFile;
+    QString outputFile;
+    QStringList extraOutputs;       // further containers of the same run (tee muxer)
+    QList<int> joinedRows;          // later chunks read by this job, in order
+    QStringList arguments;          // exact ffmpeg arguments; the thread budget is added at spawn
+    qint64 expectedFrames = -1;
+    qint64 expectedDurationMs = -1;
+    JobCost cost;
+
+    // Input bytes ffmpeg reads, in order, when not simply the whole input: a byte
+    // range or the chunks of a join. seeksInput: a time seek into a container,
+    // where the bytes read are not known in advance.
+    QList<IoPolicy::FileRange> readRanges;
+    bool seeksInput = false;
+
+    // In-process HDR SEI rewrite feeding ffmpeg's stdin; no segments when off
+    QList<SeiInjector::Segment> injectSegments;
+    NalIndex::Codec injectCodec = NalIndex::Codec::Unknown;
+    HdrMetadata injectMetadata;
+
+    // Probe phase of the row for the batch metrics; not exported
+    qint64 probeStartMs = -1;
+    qint64 probeEndMs = -1;
+
+    bool isLinked() const { return linkedTo >= 0; }
+    bool injectsHdr() const { return !injectSegments.isEmpty(); }
+    QStringList outputs() const { return QStringList{outputFile} + extraOutputs; }
+};
+
+// A batch resolved against the settings it was started with: every job, its exact
+// argument vector, outputs and cost estimate. FileProcessor compiles it on a worker
+// thread and runs it unchanged; it can also be shown as a dry run, exported as JSON
+// or a POSIX shell script, and the JSON replayed by `ProMuxer --run-plan` on this
+// or another machine.
+struct BatchPlan {
+    QString program;                // ffmpeg at compile time; a replay uses its own
+    QString processingMode;         // "muxing" or "binToYuv"
+    QString outputFormat;
+    bool overwrite = false;
+    QString dedupMode;              // how duplicates link: "hardlink", "reflink" or "off"
+    QStringList files;              // every input row, including linked and joined ones
+    QList<PlannedJob> jobs;         // run order first, linked duplicates after them
+    QStringList notes;              // warnings and decisions made while compiling
+    qint64 createdMs = 0;           // ms since the epoch
+
+    int runCount() const;           // jobs started up front, without linked duplicates
+    double estimatedSeconds() const;
+    QString describe() const;       // human-readable dry run
+
+    QJsonObject toJson() const;
+    static bool fromJson(const QJsonObject &json, BatchPlan *plan, QString *error);
+    bool save(const QString &filePath, QString *error) const;
+    static bool load(const QString &filePath, BatchPlan *plan, QString *error);
+
+    // A script that runs the same commands in order and links duplicates; jobs that
+    // need the in-process HDR rewrite are left to --run-plan
+    QString toShellScript() const;
+    static QString shellQuote(const QString &text);
+};
+
+using BatchPlanPtr = QSharedPointer<const BatchPlan>;
+
+#endif // BATCHPLAN_H
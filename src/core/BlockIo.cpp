@@ -0,0 +1,563 @@
+#include "BlockIo.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const int PageSize = 4096;
+
+// Process-wide counters shared by every BlockIo instance
+std::atomic<quint64> g_reads{0};
+std::atomic<quint64> g_writes{0};
+std::atomic<quint64> g_bytesRead{0};
+std::atomic<quint64> g_bytesWritten{0};
+std::atomic<quint64> g_uringRequests{0};
+std::atomic<quint64> g_latency[BlockIo::LatencyBuckets];
+
+qint64 nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void recordCompletion(bool write, qint64 bytes, qint64 latencyNs, bool uring)
+{
+    if (write) {
+        g_writes.fetch_add(1, std::memory_order_relaxed);
+        g_bytesWritten.fetch_add(quint64(qMax<qint64>(0, bytes)), std::memory_order_relaxed);
+    } else {
+        g_reads.fetch_add(1, std::memory_order_relaxed);
+        g_bytesRead.fetch_add(quint64(qMax<qint64>(0, bytes)), std::memory_order_relaxed);
+    }
+    if (uring) {
+        g_uringRequests.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    quint64 us = quint64(qMax<qint64>(0, latencyNs)) / 1000;
+    int bucket = 0;
+    while (us > 1 && bucket < BlockIo::LatencyBuckets - 1) {
+        us >>= 1;
+        ++bucket;
+    }
+    g_latency[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+BlockIo::BlockIo()
+    : m_mode(Mode::Read)
+    , m_fd(-1)
+    , m_position(0)
+    , m_fileSize(0)
+    , m_failed(false)
+    , m_uringActive(false)
+    , m_head(0)
+    , m_inFlight(0)
+    , m_nextReadOffset(0)
+{
+}
+
+BlockIo::~BlockIo()
+{
+    close();
+}
+
+bool BlockIo::open(const QString &filePath, Mode mode, const Options &options)
+{
+    close();
+
+    m_mode = mode;
+    m_options = options;
+    m_options.queueDepth = qBound(1, m_options.queueDepth, 256);
+    m_options.blockSize = qMax(PageSize, (m_options.blockSize + PageSize - 1) / PageSize * PageSize);
+    m_position = 0;
+    m_fileSize = 0;
+    m_failed = false;
+    m_error.clear();
+
+#ifdef Q_OS_UNIX
+    int flags = (mode == Mode::Read) ? O_RDONLY : (O_WRONLY | O_CREAT | O_TRUNC);
+    m_fd = ::open(QFile::encodeName(filePath).constData(), flags | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        m_error = QString("Cannot open %1: %2").arg(filePath).arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    if (mode == Mode::Read) {
+        struct stat st;
+        if (::fstat(m_fd, &st) == 0) {
+            m_fileSize = st.st_size;
+        }
+    }
+#else
+    m_file.setFileName(filePath);
+    if (!m_file.open(mode == Mode::Read ? QIODevice::ReadOnly : (QIODevice::WriteOnly | QIODevice::Truncate))) {
+        m_error = QString("Cannot open %1: %2").arg(filePath).arg(m_file.errorString());
+        return false;
+    }
+    m_fileSize = (mode == Mode::Read) ? m_file.size() : 0;
+#endif
+
+#ifdef PROMUXER_HAVE_LIBURING
+    // io_uring_queue_init fails with ENOSYS on pre-5.1 kernels and EPERM under
+    // seccomp profiles that block it; both fall back to pread/pwrite.
+    m_uringActive = (io_uring_queue_init(unsigned(m_options.queueDepth), &m_ring, 0) == 0);
+#endif
+
+    if (m_uringActive) {
+        allocateBlocks();
+        if (mode == Mode::Read) {
+            primeReads(0);
+        }
+    }
+    return true;
+}
+
+void BlockIo::close()
+{
+    if (!isOpen()) {
+        return;
+    }
+
+    if (m_mode == Mode::Write) {
+        flush();
+    } else if (m_uringActive) {
+        waitAll();
+    }
+
+#ifdef PROMUXER_HAVE_LIBURING
+    if (m_uringActive) {
+        io_uring_queue_exit(&m_ring);
+    }
+#endif
+    m_uringActive = false;
+    freeBlocks();
+
+#ifdef Q_OS_UNIX
+    ::close(m_fd);
+#endif
+    m_fd = -1;
+    m_file.close();
+}
+
+qint64 BlockIo::size() const
+{
+    return qMax(m_fileSize, m_position);
+}
+
+qint64 BlockIo::read(uchar *dst, qint64 length)
+{
+    if (m_mode != Mode::Read || m_failed) {
+        return -1;
+    }
+
+    if (!m_uringActive) {
+        qint64 n = syncRead(m_position, dst, length);
+        if (n > 0) {
+            m_position += n;
+        }
+        return n;
+    }
+
+    qint64 copied = 0;
+    while (copied < length && m_position < m_fileSize) {
+        Block &block = m_blocks[m_head];
+        while (block.inFlight) {
+            if (!waitOne()) {
+                return -1;
+            }
+        }
+
+        if (block.ready && block.length == 0 && block.offset <= m_position) {
+            break; // file shrank underneath us
+        }
+
+        // The head block does not cover the read position after a seek, a short
+        // read, or when the pipeline ran dry: restart it from the position.
+        if (!block.ready || m_position < block.offset || m_position >= block.offset + block.length) {
+            if (!waitAll()) {
+                return -1;
+            }
+            primeReads(m_position);
+            continue;
+        }
+
+        qint64 n = qMin(length - copied, block.offset + block.length - m_position);
+        memcpy(dst + copied, block.data + (m_position - block.offset), size_t(n));
+        copied += n;
+        m_position += n;
+
+        if (m_position >= block.offset + block.length) {
+            // Recycle the consumed block for the next offset past the pipeline tail
+            block.ready = false;
+            if (m_nextReadOffset < m_fileSize) {
+                submitRead(m_head, m_nextReadOffset);
+                m_nextReadOffset += m_options.blockSize;
+#ifdef PROMUXER_HAVE_LIBURING
+                io_uring_submit(&m_ring);
+#endif
+            }
+            m_head = (m_head + 1) % m_blocks.size();
+        }
+    }
+    return copied;
+}
+
+qint64 BlockIo::write(const uchar *src, qint64 length)
+{
+    if (m_mode != Mode::Write || m_failed) {
+        return -1;
+    }
+
+    if (!m_uringActive) {
+        qint64 n = syncWrite(m_position, src, length);
+        if (n > 0) {
+            m_position += n;
+            m_fileSize = qMax(m_fileSize, m_position);
+        }
+        return n;
+    }
+
+    qint64 remaining = length;
+    while (remaining > 0) {
+        Block &block = m_blocks[m_head];
+        while (block.inFlight) {
+            if (!waitOne()) {
+                return -1;
+            }
+        }
+        if (block.length == 0) {
+            block.offset = m_position;
+        }
+
+        qint64 n = qMin(remaining, qint64(m_options.blockSize) - block.length);
+        memcpy(block.data + block.length, src, size_t(n));
+        block.length += n;
+        src += n;
+        remaining -= n;
+        m_position += n;
+        m_fileSize = qMax(m_fileSize, m_position);
+
+        if (block.length == m_options.blockSize) {
+            submitWrite(m_head);
+            m_head = (m_head + 1) % m_blocks.size();
+        }
+    }
+    return length;
+}
+
+qint64 BlockIo::seek(qint64 position)
+{
+    if (position < 0) {
+        return -1;
+    }
+    if (m_mode == Mode::Write && m_uringActive) {
+        // io_uring does not order requests, so a rewrite of an earlier range
+        // (e.g. the mp4 header fix-up) must not overtake queued blocks.
+        if (!flushFillBlock() || !waitAll()) {
+            return -1;
+        }
+    }
+    // Reads restart their pipeline lazily on the next read()
+    m_position = position;
+    return m_position;
+}
+
+bool BlockIo::flush()
+{
+    if (m_mode != Mode::Write) {
+        return true;
+    }
+    if (m_uringActive) {
+        flushFillBlock();
+        waitAll();
+    }
+    return !m_failed;
+}
+
+qint64 BlockIo::readAt(qint64 offset, uchar *dst, qint64 length)
+{
+    return syncRead(offset, dst, length);
+}
+
+qint64 BlockIo::syncRead(qint64 offset, uchar *dst, qint64 length)
+{
+    const qint64 start = nowNs();
+    qint64 done = 0;
+#ifdef Q_OS_UNIX
+    while (done < length) {
+        ssize_t n = ::pread(m_fd, dst + done, size_t(length - done), off_t(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            m_error = QString::fromLocal8Bit(strerror(errno));
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+#else
+    if (!m_file.seek(offset)) {
+        m_error = m_file.errorString();
+        return -1;
+    }
+    done = m_file.read(reinterpret_cast<char *>(dst), length);
+    if (done < 0) {
+        m_error = m_file.errorString();
+        return -1;
+    }
+#endif
+    if (m_options.countInStats) {
+        recordCompletion(false, done, nowNs() - start, false);
+    }
+    return done;
+}
+
+qint64 BlockIo::syncWrite(qint64 offset, const uchar *src, qint64 length)
+{
+    const qint64 start = nowNs();
+    qint64 done = 0;
+#ifdef Q_OS_UNIX
+    while (done < length) {
+        ssize_t n = ::pwrite(m_fd, src + done, size_t(length - done), off_t(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            m_error = QString::fromLocal8Bit(strerror(errno));
+            m_failed = true;
+            return -1;
+        }
+        done += n;
+    }
+#else
+    if (!m_file.seek(offset) || m_file.write(reinterpret_cast<const char *>(src), length) != length) {
+        m_error = m_file.errorString();
+        m_failed = true;
+        return -1;
+    }
+    done = length;
+#endif
+    if (m_options.countInStats) {
+        recordCompletion(true, done, nowNs() - start, false);
+    }
+    return done;
+}
+
+void BlockIo::allocateBlocks()
+{
+    m_blocks.resize(m_options.queueDepth);
+    for (Block &block : m_blocks) {
+        block.data = static_cast<uchar *>(qMallocAligned(size_t(m_options.blockSize), PageSize));
+    }
+    m_head = 0;
+    m_inFlight = 0;
+}
+
+void BlockIo::freeBlocks()
+{
+    for (Block &block : m_blocks) {
+        qFreeAligned(block.data);
+    }
+    m_blocks.clear();
+    m_head = 0;
+    m_inFlight = 0;
+}
+
+void BlockIo::submitRead(int index, qint64 offset)
+{
+#ifdef PROMUXER_HAVE_LIBURING
+    Block &block = m_blocks[index];
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&m_ring);
+    if (!sqe) {
+        // Queue depth equals the number of blocks, so this only happens on misuse
+        m_failed = true;
+        return;
+    }
+    block.offset = offset;
+    block.length = 0;
+    block.ready = false;
+    block.inFlight = true;
+    block.startNs = nowNs();
+    io_uring_prep_read(sqe, m_fd, block.data, unsigned(m_options.blockSize), quint64(offset));
+    io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(quintptr(index)));
+    ++m_inFlight;
+#else
+    Q_UNUSED(index); Q_UNUSED(offset);
+#endif
+}
+
+void BlockIo::submitWrite(int index)
+{
+#ifdef PROMUXER_HAVE_LIBURING
+    Block &block = m_blocks[index];
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&m_ring);
+    if (!sqe) {
+        m_failed = true;
+        return;
+    }
+    block.inFlight = true;
+    block.startNs = nowNs();
+    io_uring_prep_write(sqe, m_fd, block.data, unsigned(block.length), quint64(block.offset));
+    io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(quintptr(index)));
+    ++m_inFlight;
+    io_uring_submit(&m_ring);
+#else
+    Q_UNUSED(index);
+#endif
+}
+
+bool BlockIo::waitOne()
+{
+#ifdef PROMUXER_HAVE_LIBURING
+    if (m_inFlight == 0) {
+        return true;
+    }
+    struct io_uring_cqe *cqe = nullptr;
+    int ret = io_uring_wait_cqe(&m_ring, &cqe);
+    if (ret < 0) {
+        m_error = QString::fromLocal8Bit(strerror(-ret));
+        m_failed = true;
+        return false;
+    }
+
+    const int index = int(quintptr(io_uring_cqe_get_data(cqe)));
+    const int res = cqe->res;
+    io_uring_cqe_seen(&m_ring, cqe);
+    --m_inFlight;
+
+    Block &block = m_blocks[index];
+    block.inFlight = false;
+    if (m_options.countInStats) {
+        recordCompletion(m_mode == Mode::Write, res, nowNs() - block.startNs, true);
+    }
+
+    if (res < 0) {
+        m_error = QString::fromLocal8Bit(strerror(-res));
+        m_failed = true;
+        return false;
+    }
+
+    if (m_mode == Mode::Read) {
+        block.length = res;
+        block.ready = true;
+    } else {
+        // Finish a short write synchronously rather than requeueing it
+        if (res < block.length &&
+            syncWrite(block.offset + res, block.data + res, block.length - res) < 0) {
+            return false;
+        }
+        block.length = 0;
+    }
+    return true;
+#else
+    return true;
+#endif
+}
+
+bool BlockIo::waitAll()
+{
+    while (m_inFlight > 0) {
+        if (!waitOne()) {
+            return false;
+        }
+    }
+    return !m_failed;
+}
+
+void BlockIo::primeReads(qint64 offset)
+{
+    // Block offsets stay page aligned so the buffers could also serve O_DIRECT
+    m_nextReadOffset = offset / PageSize * PageSize;
+    for (int i = 0; i < m_blocks.size(); ++i) {
+        const int index = (m_head + i) % m_blocks.size();
+        Block &block = m_blocks[index];
+        block.ready = false;
+        block.length = 0;
+        if (m_nextReadOffset < m_fileSize) {
+            submitRead(index, m_nextReadOffset);
+            m_nextReadOffset += m_options.blockSize;
+        }
+    }
+#ifdef PROMUXER_HAVE_LIBURING
+    io_uring_submit(&m_ring);
+#endif
+}
+
+bool BlockIo::flushFillBlock()
+{
+    if (m_blocks.isEmpty()) {
+        return true;
+    }
+    Block &block = m_blocks[m_head];
+    if (!block.inFlight && block.length > 0) {
+        submitWrite(m_head);
+        m_head = (m_head + 1) % m_blocks.size();
+    }
+    return !m_failed;
+}
+
+BlockIo::Stats BlockIo::stats()
+{
+    Stats s;
+    s.reads = g_reads.load(std::memory_order_relaxed);
+    s.writes = g_writes.load(std::memory_order_relaxed);
+    s.bytesRead = g_bytesRead.load(std::memory_order_relaxed);
+    s.bytesWritten = g_bytesWritten.load(std::memory_order_relaxed);
+    s.uringRequests = g_uringRequests.load(std::memory_order_relaxed);
+    for (int i = 0; i < LatencyBuckets; ++i) {
+        s.latencyHistogram[i] = g_latency[i].load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+BlockIo::Stats BlockIo::difference(const Stats &later, const Stats &earlier)
+{
+    auto minus = [](quint64 a, quint64 b) { return a > b ? a - b : quint64(0); };
+    Stats d;
+    d.reads = minus(later.reads, earlier.reads);
+    d.writes = minus(later.writes, earlier.writes);
+    d.bytesRead = minus(later.bytesRead, earlier.bytesRead);
+    d.bytesWritten = minus(later.bytesWritten, earlier.bytesWritten);
+    d.uringRequests = minus(later.uringRequests, earlier.uringRequests);
+    for (int i = 0; i < LatencyBuckets; ++i) {
+        d.latencyHistogram[i] = minus(later.latencyHistogram[i], earlier.latencyHistogram[i]);
+    }
+    return d;
+}
+
+quint64 BlockIo::latencyPercentileUs(const Stats &stats, double fraction)
+{
+    quint64 total = 0;
+    for (quint64 count : stats.latencyHistogram) total += count;
+    if (total == 0) return 0;
+    quint64 target = quint64(fraction * total);
+    quint64 seen = 0;
+    for (int i = 0; i < LatencyBuckets; ++i) {
+        seen += stats.latencyHistogram[i];
+        if (seen > target) return quint64(1) << (i + 1);
+    }
+    return quint64(1) << LatencyBuckets;
+}
+
+QString BlockIo::describeStats(const Stats &stats)
+{
+    return QString("%1 reads (%2 MB), %3 writes (%4 MB), %5 via io_uring, latency p50 <%6 us, p99 <%7 us")
+        .arg(stats.reads)
+        .arg(stats.bytesRead / (1024 * 1024))
+        .arg(stats.writes)
+        .arg(stats.bytesWritten / (1024 * 1024))
+        .arg(stats.uringRequests)
+        .arg(latencyPercentileUs(stats, 0.50))
+        .arg(latencyPercentileUs(stats, 0.99));
+}
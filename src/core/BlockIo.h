@@ -0,0 +1,120 @@
+#ifndef BLOCKIO_H
+#define BLOCKIO_H
+
+#include <QString>
+#include <QFile>
+#include <QVector>
+#include <QtGlobal>
+
+#ifdef PROMUXER_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+// Large-block file I/O for the in-process read/write paths.
+//
+// On Linux builds with liburing, reads are pipelined through io_uring: up to
+// queueDepth aligned blocks are kept in flight ahead of the read position, and
+// writes are queued without waiting for the previous block. When the kernel
+// refuses io_uring (older kernels, seccomp) or liburing is not compiled in,
+// every call falls back to synchronous pread/pwrite (QFile on Windows).
+//
+// Every completed request is counted in a process-wide Stats block; batch
+// metrics snapshot it and report the difference, so only the requests made
+// while a batch ran show up in its rates and latency histogram.
+class BlockIo
+{
+public:
+    enum class Mode {
+        Read,
+        Write
+    };
+
+    struct Options {
+        int queueDepth = 8;
+        int blockSize = 1 << 20;          // rounded up to a multiple of 4 KiB
+        bool countInStats = true;         // false: background reads (fingerprinting) stay out of stats()
+    };
+
+    static constexpr int LatencyBuckets = 24;   // bucket i counts requests in [2^i, 2^(i+1)) us
+
+    struct Stats {
+        quint64 reads = 0;
+        quint64 writes = 0;
+        quint64 bytesRead = 0;
+        quint64 bytesWritten = 0;
+        quint64 uringRequests = 0;        // subset of reads + writes served by io_uring
+        quint64 latencyHistogram[LatencyBuckets] = {};
+    };
+
+    BlockIo();
+    ~BlockIo();
+
+    bool open(const QString &filePath, Mode mode, const Options &options);
+    void close();
+    bool isOpen() const { return m_fd >= 0 || m_file.isOpen(); }
+    bool usesUring() const { return m_uringActive; }
+    QString errorString() const { return m_error; }
+
+    // Sequential stream interface, used by the AVIOContext adapter
+    qint64 read(uchar *dst, qint64 length);
+    qint64 write(const uchar *src, qint64 length);
+    qint64 seek(qint64 position);
+    qint64 position() const { return m_position; }
+    qint64 size() const;
+    bool flush();
+
+    // Positional read that bypasses the pipeline (fingerprinting, index probes)
+    qint64 readAt(qint64 offset, uchar *dst, qint64 length);
+
+    int descriptor() const { return m_fd; }
+
+    static Stats stats();
+    static Stats difference(const Stats &later, const Stats &earlier);
+    // Approximate percentile from the log2 histogram (upper bucket edge), 0 without requests
+    static quint64 latencyPercentileUs(const Stats &stats, double fraction);
+    static QString describeStats(const Stats &stats);
+
+private:
+    struct Block {
+        uchar *data = nullptr;
+        qint64 offset = 0;
+        qint64 length = 0;                // valid bytes once complete (read) / filled bytes (write)
+        qint64 startNs = 0;
+        bool inFlight = false;
+        bool ready = false;               // read block holds data for [offset, offset + length)
+    };
+
+    qint64 syncRead(qint64 offset, uchar *dst, qint64 length);
+    qint64 syncWrite(qint64 offset, const uchar *src, qint64 length);
+
+    void allocateBlocks();
+    void freeBlocks();
+
+    // io_uring pipeline
+    void submitRead(int index, qint64 offset);
+    void submitWrite(int index);
+    bool waitOne();
+    bool waitAll();
+    void primeReads(qint64 offset);
+    bool flushFillBlock();
+
+    Mode m_mode;
+    Options m_options;
+    QString m_error;
+    int m_fd;
+    QFile m_file;                          // Windows fallback
+    qint64 m_position;
+    qint64 m_fileSize;
+    bool m_failed;
+
+    bool m_uringActive;
+#ifdef PROMUXER_HAVE_LIBURING
+    struct io_uring m_ring;
+#endif
+    QVector<Block> m_blocks;
+    int m_head;                            // read: block holding m_position; write: block being filled
+    int m_inFlight;
+    qint64 m_nextReadOffset;
+};
+
+#endif // BLOCKIO_H
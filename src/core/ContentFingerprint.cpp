@@ -0,0 +1,228 @@
+#include "ContentFingerprint.h"
+#include "BlockIo.h"
+#include <QCryptographicHash>
+#include <QMetaObject>
+#include <QSettings>
+#include <QVector>
+#include <algorithm>
+
+#ifdef PROMUXER_HAVE_XXHASH
+#include <xxhash.h>
+#endif
+
+namespace {
+
+// Streaming hash over the sampled regions
+class SampleHasher
+{
+public:
+    SampleHasher()
+#ifdef PROMUXER_HAVE_XXHASH
+        : m_state(XXH3_createState())
+#else
+        : m_hash(QCryptographicHash::Md5)
+#endif
+    {
+#ifdef PROMUXER_HAVE_XXHASH
+        XXH3_128bits_reset(m_state);
+#endif
+    }
+
+    ~SampleHasher()
+    {
+#ifdef PROMUXER_HAVE_XXHASH
+        XXH3_freeState(m_state);
+#endif
+    }
+
+    void add(const uchar *data, qint64 length)
+    {
+#ifdef PROMUXER_HAVE_XXHASH
+        XXH3_128bits_update(m_state, data, size_t(length));
+#else
+        m_hash.addData(QByteArrayView(reinterpret_cast<const char *>(data), length));
+#endif
+    }
+
+    QByteArray result()
+    {
+#ifdef PROMUXER_HAVE_XXHASH
+        XXH128_canonical_t canonical;
+        XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(m_state));
+        return QByteArray(reinterpret_cast<const char *>(canonical.digest), sizeof(canonical.digest));
+#else
+        return m_hash.result();
+#endif
+    }
+
+private:
+#ifdef PROMUXER_HAVE_XXHASH
+    XXH3_state_t *m_state;
+#else
+    QCryptographicHash m_hash;
+#endif
+};
+
+} // namespace
+
+ContentFingerprint ContentFingerprint::compute(const QString &filePath, qint64 sampleBytes)
+{
+    ContentFingerprint fingerprint;
+
+    // readAt() bypasses the read pipeline, so keep the pipeline minimal
+    BlockIo::Options options;
+    options.queueDepth = 1;
+    options.blockSize = 4096;
+    options.countInStats = false;   // runs beside batches; keep it out of their I/O figures
+    BlockIo io;
+    if (!io.open(filePath, BlockIo::Mode::Read, options)) {
+        return fingerprint;
+    }
+    const qint64 size = io.size();
+    sampleBytes = qMax<qint64>(4096, sampleBytes);
+
+    // (offset, length) of each region; the middle one is page aligned
+    QVector<QPair<qint64, qint64>> regions;
+    if (size <= 3 * sampleBytes) {
+        regions.append({0, size});
+    } else {
+        regions.append({0, sampleBytes});
+        regions.append({(size / 2 - sampleBytes / 2) & ~qint64(4095), sampleBytes});
+        regions.append({size - sampleBytes, sampleBytes});
+    }
+
+    SampleHasher hasher;
+    hasher.add(reinterpret_cast<const uchar *>(&size), sizeof(size));
+    QByteArray buffer(int(qMin<qint64>(sampleBytes, qMax<qint64>(size, 1))), Qt::Uninitialized);
+    uchar *data = reinterpret_cast<uchar *>(buffer.data());
+    for (const auto &region : std::as_const(regions)) {
+        qint64 offset = region.first;
+        qint64 remaining = region.second;
+        while (remaining > 0) {
+            const qint64 chunk = qMin<qint64>(remaining, buffer.size());
+            const qint64 n = io.readAt(offset, data, chunk);
+            if (n != chunk) {
+                return fingerprint;     // short read: the file changed or failed
+            }
+            hasher.add(data, n);
+            offset += n;
+            remaining -= n;
+        }
+    }
+
+    fingerprint.size = size;
+    fingerprint.digest = hasher.result();
+    return fingerprint;
+}
+
+FingerprintScanner::FingerprintScanner(QObject *parent)
+    : QObject(parent)
+    , m_generation(0)
+    , m_nextOrder(0)
+{
+    QSettings settings;
+    m_pool.setMaxThreadCount(qBound(1, settings.value("fingerprint/threads", 2).toInt(), 16));
+    m_sampleBytes = qint64(qBound(1, settings.value("fingerprint/sampleMB", 4).toInt(), 256)) * 1024 * 1024;
+}
+
+FingerprintScanner::~FingerprintScanner()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void FingerprintScanner::scan(const QStringList &files)
+{
+    const quint64 generation = m_generation;
+    const qint64 sampleBytes = m_sampleBytes;
+    for (const QString &file : files) {
+        if (m_order.contains(file)) {
+            continue;
+        }
+        m_order.insert(file, m_nextOrder++);
+        m_pool.start([this, file, generation, sampleBytes]() {
+            const ContentFingerprint fingerprint = ContentFingerprint::compute(file, sampleBytes);
+            // Queued to the scanner's thread; dropped if the scanner is gone by then
+            QMetaObject::invokeMethod(this, [this, file, generation, fingerprint]() {
+                onComputed(file, generation, fingerprint);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void FingerprintScanner::forget(const QString &file)
+{
+    const ContentFingerprint removed = m_fingerprints.take(file);
+    m_order.remove(file);
+    bool wasDuplicate = false;
+    for (const ContentFingerprint &other : std::as_const(m_fingerprints)) {
+        if (removed.isValid() && other == removed) {
+            wasDuplicate = true;
+            break;
+        }
+    }
+    if (wasDuplicate) {
+        emit duplicatesChanged();
+    }
+}
+
+void FingerprintScanner::clear()
+{
+    m_pool.clear();
+    m_generation++;
+    m_fingerprints.clear();
+    m_order.clear();
+    emit duplicatesChanged();
+}
+
+void FingerprintScanner::onComputed(const QString &file, quint64 generation, const ContentFingerprint &fingerprint)
+{
+    if (generation != m_generation || !m_order.contains(file)) {
+        return;
+    }
+    if (fingerprint.isValid()) {
+        bool duplicate = false;
+        for (auto it = m_fingerprints.constBegin(); it != m_fingerprints.constEnd(); ++it) {
+            if (it.value() == fingerprint) {
+                duplicate = true;
+                break;
+            }
+        }
+        m_fingerprints.insert(file, fingerprint);
+        if (duplicate) {
+            emit duplicatesChanged();
+        }
+    }
+    emit fingerprintReady(file);
+}
+
+QList<QStringList> FingerprintScanner::duplicateGroups() const
+{
+    QHash<QString, QStringList> byKey;
+    for (auto it = m_fingerprints.constBegin(); it != m_fingerprints.constEnd(); ++it) {
+        byKey[it.value().toString()].append(it.key());
+    }
+    QList<QStringList> groups;
+    for (QStringList &files : byKey) {
+        if (files.size() < 2) {
+            continue;
+        }
+        std::sort(files.begin(), files.end(), [this](const QString &a, const QString &b) {
+            return m_order.value(a) < m_order.value(b);
+        });
+        groups.append(files);
+    }
+    return groups;
+}
+
+QHash<QString, QString> FingerprintScanner::duplicateLeaders() const
+{
+    QHash<QString, QString> leaders;
+    const QList<QStringList> groups = duplicateGroups();
+    for (const QStringList &group : groups) {
+        for (int i = 1; i < group.size(); ++i) {
+            leaders.insert(group.at(i), group.first());
+        }
+    }
+    return leaders;
+}
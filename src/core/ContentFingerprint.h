@@ -0,0 +1,70 @@
+#ifndef CONTENTFINGERPRINT_H
+#define CONTENTFINGERPRINT_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QThreadPool>
+#include <QtGlobal>
+
+// Cheap identity of a file's content: its size and a hash of the first, middle
+// and last few MB. Two copies of the same clip match regardless of name or folder;
+// files that only share sampled regions are not told apart, which is acceptable
+// for media files where any real difference shows up in size or in the samples.
+struct ContentFingerprint {
+    qint64 size = -1;
+    QByteArray digest;              // xxHash3-128 with libxxhash, MD5 otherwise
+
+    bool isValid() const { return size >= 0 && !digest.isEmpty(); }
+    bool operator==(const ContentFingerprint &other) const
+    {
+        return size == other.size && digest == other.digest;
+    }
+    QString toString() const { return QString("%1:%2").arg(size).arg(QString::fromLatin1(digest.toHex())); }
+
+    // Reads sampleBytes at the head, middle and tail with positional reads;
+    // files up to three samples long are hashed whole. Invalid on read errors.
+    static ContentFingerprint compute(const QString &filePath, qint64 sampleBytes);
+};
+
+// Fingerprints files on a small background pool and groups identical ones.
+//
+// Results are delivered on the scanner's thread. The pool is I/O bound, so it is
+// kept small ("fingerprint/threads", default 2); the sample size is
+// "fingerprint/sampleMB" (default 4).
+class FingerprintScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FingerprintScanner(QObject *parent = nullptr);
+    ~FingerprintScanner();
+
+    void scan(const QStringList &files);
+    void forget(const QString &file);
+    void clear();
+
+    ContentFingerprint fingerprint(const QString &file) const { return m_fingerprints.value(file); }
+    // Groups of two or more files with the same fingerprint, each in scan order
+    QList<QStringList> duplicateGroups() const;
+    // Every duplicate mapped to the first file of its group
+    QHash<QString, QString> duplicateLeaders() const;
+
+signals:
+    void fingerprintReady(const QString &file);
+    void duplicatesChanged();
+
+private:
+    void onComputed(const QString &file, quint64 generation, const ContentFingerprint &fingerprint);
+
+    QThreadPool m_pool;
+    qint64 m_sampleBytes;
+    quint64 m_generation;           // bumped by clear() so stale results are dropped
+    QHash<QString, ContentFingerprint> m_fingerprints;
+    QHash<QString, int> m_order;    // scan order, to pick group leaders
+    int m_nextOrder;
+};
+
+#endif // CONTENTFINGERPRINT_H
@@ -0,0 +1,195 @@
+#include "CostModel.h"
+#include "MediaInfo.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QStringList>
+#include <QThread>
+
+namespace {
+
+// Built-in rates until a codec key has history
+constexpr double kDefaultCopyBytesPerSec = 250e6;
+constexpr double kDefaultDecodePixelsPerSec = 250e6;     // ~2x realtime at 1080p60
+constexpr double kDefaultReencodePixelsPerSec = 8e6;     // SVT-AV1 preset 4, ~4 fps at 1080p
+constexpr double kHistoryWeight = 0.3;                   // EWMA weight of the newest job
+
+// "1:02:03" or "2:03" as produced by MediaAnalyzer::formatDuration
+double parseDurationSeconds(const QString &text)
+{
+    const QStringList parts = text.trimmed().split(':');
+    if (parts.size() < 2 || parts.size() > 3) {
+        return 0.0;
+    }
+    double seconds = 0.0;
+    for (const QString &part : parts) {
+        bool ok = false;
+        const double value = part.toDouble(&ok);
+        if (!ok) {
+            return 0.0;
+        }
+        seconds = seconds * 60.0 + value;
+    }
+    return seconds;
+}
+
+double parseFrameRate(const QString &text)
+{
+    static const QRegularExpression number("([0-9]+(?:\\.[0-9]+)?)");
+    const QRegularExpressionMatch match = number.match(text);
+    const double fps = match.hasMatch() ? match.captured(1).toDouble() : 0.0;
+    return (fps >= 1.0 && fps <= 240.0) ? fps : 30.0;
+}
+
+QString codecName(const QString &videoCodec)
+{
+    QString name = videoCodec.toLower().section(' ', 0, 0);
+    name.remove(QRegularExpression("[^a-z0-9]"));
+    return name.isEmpty() ? "unknown" : name;
+}
+
+} // namespace
+
+CostModel::CostModel()
+{
+}
+
+void CostModel::load()
+{
+    m_throughput.clear();
+    m_samples.clear();
+
+    QSettings settings;
+    settings.beginGroup("cost/throughput");
+    const QStringList keys = settings.allKeys();
+    for (const QString &key : keys) {
+        const double rate = settings.value(key).toDouble();
+        if (rate > 0.0) {
+            m_throughput.insert(key, rate);
+        }
+    }
+    settings.endGroup();
+
+    settings.beginGroup("cost/samples");
+    for (const QString &key : keys) {
+        m_samples.insert(key, settings.value(key, 0).toInt());
+    }
+    settings.endGroup();
+}
+
+void CostModel::save() const
+{
+    QSettings settings;
+    for (auto it = m_throughput.constBegin(); it != m_throughput.constEnd(); ++it) {
+        settings.setValue("cost/throughput/" + it.key(), it.value());
+        settings.setValue("cost/samples/" + it.key(), m_samples.value(it.key()));
+    }
+}
+
+JobCost CostModel::estimate(const QString &inputFile, const MediaInfo &info, JobCost::Kind kind) const
+{
+    JobCost cost;
+    cost.kind = kind;
+    cost.codecKey = kindName(kind) + '/' + codecName(info.videoCodec);
+    cost.inputBytes = QFileInfo(inputFile).size();
+
+    static const QRegularExpression sizePattern("([0-9]{2,5})x([0-9]{2,5})");
+    const QRegularExpressionMatch size = sizePattern.match(info.resolution);
+    const double width = size.hasMatch() ? size.captured(1).toDouble() : 0.0;
+    const double height = size.hasMatch() ? size.captured(2).toDouble() : 0.0;
+    const double frameBytes = (width > 0.0) ? width * height * 3.0 : 1920.0 * 1080.0 * 3.0;  // 4:2:0 at 16 bit
+
+    // The NAL index gives raw streams an exact frame count
+    const double frames = (info.frameCount > 0) ? double(info.frameCount)
+                                                : parseFrameRate(info.frameRate) * parseDurationSeconds(info.duration);
+    cost.pixels = width * height * frames;
+    if (cost.pixels <= 0.0 && kind != JobCost::StreamCopy) {
+        // Raw streams often lack a duration; assume ~0.1 compressed bytes per pixel
+        cost.pixels = double(cost.inputBytes) * 10.0;
+    }
+
+    const int cores = qMax(1, QThread::idealThreadCount());
+    switch (kind) {
+    case JobCost::StreamCopy:
+        cost.cpuCores = 0.5;
+        cost.memoryBytes = 128LL * 1024 * 1024;
+        break;
+    case JobCost::DecodeToYuv:
+        cost.cpuCores = qMin(4, cores);
+        cost.memoryBytes = 256LL * 1024 * 1024 + qint64(frameBytes * 16);
+        break;
+    case JobCost::Reencode:
+        cost.cpuCores = cores;
+        cost.memoryBytes = 1024LL * 1024 * 1024 + qint64(frameBytes * 64);
+        break;
+    }
+
+    const double units = (kind == JobCost::StreamCopy) ? double(cost.inputBytes) : cost.pixels;
+    cost.estimatedSeconds = units / throughput(cost);
+    return cost;
+}
+
+void CostModel::record(const JobCost &cost, double seconds)
+{
+    const double units = (cost.kind == JobCost::StreamCopy) ? double(cost.inputBytes) : cost.pixels;
+    if (seconds < 0.05 || units <= 0.0) {
+        return;     // too short to say anything about throughput
+    }
+    const double rate = units / seconds;
+    const int samples = m_samples.value(cost.codecKey);
+    m_throughput[cost.codecKey] = (samples == 0)
+        ? rate
+        : kHistoryWeight * rate + (1.0 - kHistoryWeight) * m_throughput.value(cost.codecKey);
+    m_samples[cost.codecKey] = samples + 1;
+}
+
+double CostModel::throughput(const JobCost &cost) const
+{
+    const double learned = m_throughput.value(cost.codecKey);
+    if (learned > 0.0) {
+        return learned;
+    }
+    switch (cost.kind) {
+    case JobCost::DecodeToYuv: return kDefaultDecodePixelsPerSec;
+    case JobCost::Reencode: return kDefaultReencodePixelsPerSec;
+    default: return kDefaultCopyBytesPerSec;
+    }
+}
+
+double CostModel::cpuBudget()
+{
+    QSettings settings;
+    const double budget = settings.value("processing/cpuBudget", 0.0).toDouble();
+    return (budget > 0.0) ? budget : double(qMax(1, QThread::idealThreadCount()));
+}
+
+qint64 CostModel::memoryBudgetBytes()
+{
+    QSettings settings;
+    const int budgetMb = settings.value("processing/memoryBudgetMB", -1).toInt();
+    if (budgetMb >= 0) {
+        return qint64(budgetMb) * 1024 * 1024;
+    }
+#ifdef Q_OS_LINUX
+    QFile meminfo("/proc/meminfo");
+    if (meminfo.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QStringList lines = QString::fromLatin1(meminfo.readAll()).split('\n');
+        for (const QString &line : lines) {
+            if (line.startsWith("MemTotal:")) {
+                return line.simplified().section(' ', 1, 1).toLongLong() * 1024 / 2;
+            }
+        }
+    }
+#endif
+    return 0;
+}
+
+QString CostModel::kindName(JobCost::Kind kind)
+{
+    switch (kind) {
+    case JobCost::DecodeToYuv: return "decode";
+    case JobCost::Reencode: return "reencode";
+    default: return "copy";
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef COSTMODEL_H
+#define COSTMODEL_H
+
+#include <QString>
+#include <QHash>
+#include <QtGlobal>
+
+struct MediaInfo;
+
+// Estimated resources of one job, used for ordering and admission
+struct JobCost {
+    enum Kind {
+        StreamCopy,         // remux, I/O bound
+        DecodeToYuv,        // raw bitstream -> rawvideo, decoder bound
+        Reencode            // AV1 film-grain re-encode, encoder bound
+    };
+
+    Kind kind = StreamCopy;
+    QString codecKey;               // history key, e.g. "copy/hevc" or "reencode/av1"
+    qint64 inputBytes = 0;
+    double pixels = 0.0;            // width * height * frames, 0 when unknown
+    double estimatedSeconds = 0.0;
+    double cpuCores = 1.0;          // cores the child keeps busy
+    qint64 memoryBytes = 0;         // peak resident size of the child
+};
+
+// Predicts job cost from MediaInfo and learned per-codec throughput.
+//
+// Stream copies are costed in bytes, decodes and re-encodes in pixels. Each
+// finished job updates an exponentially weighted throughput for its codec key,
+// kept in the "cost/..." QSettings group so estimates improve across sessions.
+// Until a key has history, conservative built-in rates are used.
+class CostModel
+{
+public:
+    CostModel();
+
+    void load();                    // reads history from QSettings
+    void save() const;
+
+    JobCost estimate(const QString &inputFile, const MediaInfo &info, JobCost::Kind kind) const;
+    // Feeds back the measured wall time of a finished job
+    void record(const JobCost &cost, double seconds);
+
+    // Budgets for concurrent admission: "processing/cpuBudget" (cores, default all)
+    // and "processing/memoryBudgetMB" (default half of physical memory, 0 = no limit)
+    static double cpuBudget();
+    static qint64 memoryBudgetBytes();
+
+    static QString kindName(JobCost::Kind kind);
+
+private:
+    double throughput(const JobCost &cost) const;      // work units per second
+
+    QHash<QString, double> m_throughput;                // codecKey -> units/s
+    QHash<QString, int> m_samples;
+};
+
+#endif // COSTMODEL_H
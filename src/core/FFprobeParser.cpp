@@ -0,0 +1,525 @@
+#include "FFprobeParser.h"
+#include <limits>
+
+namespace {
+
+// Deepest nesting skipValue() follows; ffprobe's own output stays within four
+// levels, this only bounds hostile input
+constexpr int MaxSkipDepth = 64;
+
+bool isBareChar(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+bool isNumber(QByteArrayView token)
+{
+    if (token.isEmpty() || !(token.at(0) == '-' || (token.at(0) >= '0' && token.at(0) <= '9'))) {
+        return false;
+    }
+    for (char c : token) {
+        if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Integer part of "3840", "-1" or "48000"; fails on anything else
+bool toInt(QByteArrayView text, int *value)
+{
+    qsizetype i = 0;
+    const bool negative = !text.isEmpty() && text.at(0) == '-';
+    if (negative) {
+        i++;
+    }
+    if (i == text.size()) {
+        return false;
+    }
+    qint64 number = 0;
+    for (; i < text.size(); ++i) {
+        const char c = text.at(i);
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        number = number * 10 + (c - '0');
+        if (number > std::numeric_limits<int>::max()) {
+            return false;
+        }
+    }
+    *value = int(negative ? -number : number);
+    return true;
+}
+
+int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool readHex4(const char *p, const char *end, char32_t *value)
+{
+    if (end - p < 4) {
+        return false;
+    }
+    *value = 0;
+    for (int i = 0; i < 4; ++i) {
+        const int digit = hexDigit(p[i]);
+        if (digit < 0) {
+            return false;
+        }
+        *value = (*value << 4) | char32_t(digit);
+    }
+    return true;
+}
+
+void appendUtf8(QByteArray *out, char32_t cp)
+{
+    if (cp < 0x80) {
+        out->append(char(cp));
+    } else if (cp < 0x800) {
+        out->append(char(0xC0 | (cp >> 6)));
+        out->append(char(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out->append(char(0xE0 | (cp >> 12)));
+        out->append(char(0x80 | ((cp >> 6) & 0x3F)));
+        out->append(char(0x80 | (cp & 0x3F)));
+    } else {
+        out->append(char(0xF0 | (cp >> 18)));
+        out->append(char(0x80 | ((cp >> 12) & 0x3F)));
+        out->append(char(0x80 | ((cp >> 6) & 0x3F)));
+        out->append(char(0x80 | (cp & 0x3F)));
+    }
+}
+
+} // namespace
+
+FFprobeParser::FFprobeParser(QByteArrayView json)
+    : m_pos(json.data())
+    , m_end(json.data() + json.size())
+{
+}
+
+template <typename OnKey>
+bool FFprobeParser::parseObject(OnKey &&onKey)
+{
+    if (!consume('{')) {
+        return false;
+    }
+    if (consume('}')) {
+        return true;
+    }
+    QByteArray scratch;             // escaped keys only; ffprobe writes none
+    do {
+        QByteArrayView key;
+        if (!readKey(&key, &scratch) || !consume(':') || !onKey(key)) {
+            return false;
+        }
+    } while (consume(','));
+    return consume('}');
+}
+
+template <typename OnElement>
+bool FFprobeParser::parseArray(OnElement &&onElement)
+{
+    if (!consume('[')) {
+        return false;
+    }
+    if (consume(']')) {
+        return true;
+    }
+    do {
+        if (!onElement()) {
+            return false;
+        }
+    } while (consume(','));
+    return consume(']');
+}
+
+bool FFprobeParser::parse(QByteArrayView json, FFprobeOutput *output)
+{
+    *output = FFprobeOutput();
+    FFprobeParser parser(json);
+    if (!parser.parseRoot(output)) {
+        return false;
+    }
+    parser.skipWhitespace();
+    return parser.m_pos == parser.m_end;
+}
+
+bool FFprobeParser::parseRoot(FFprobeOutput *output)
+{
+    return parseObject([&](QByteArrayView key) {
+        if (key == "streams") {
+            return parseArray([&] {
+                output->streams.append(FFprobeStream());
+                return parseStream(&output->streams.last());
+            });
+        }
+        if (key == "format") {
+            output->format.present = true;
+            return parseFormat(&output->format);
+        }
+        return skipValue();
+    });
+}
+
+bool FFprobeParser::parseFormat(FFprobeFormat *format)
+{
+    return parseObject([&](QByteArrayView key) {
+        if (key == "format_name") {
+            return readScalar(&format->formatName);
+        }
+        if (key == "duration") {
+            return readScalar(&format->duration);
+        }
+        if (key == "size") {
+            return readScalar(&format->size);
+        }
+        if (key == "bit_rate") {
+            return readScalar(&format->bitRate);
+        }
+        return skipValue();
+    });
+}
+
+bool FFprobeParser::parseStream(FFprobeStream *stream)
+{
+    return parseObject([&](QByteArrayView key) {
+        if (key == "index") {
+            return readInt(&stream->index);
+        }
+        if (key == "codec_type") {
+            return readScalar(&stream->codecType);
+        }
+        if (key == "codec_name") {
+            return readScalar(&stream->codecName);
+        }
+        if (key == "width") {
+            return readInt(&stream->width);
+        }
+        if (key == "height") {
+            return readInt(&stream->height);
+        }
+        if (key == "avg_frame_rate") {
+            return readScalar(&stream->avgFrameRate);
+        }
+        if (key == "r_frame_rate") {
+            return readScalar(&stream->rFrameRate);
+        }
+        if (key == "bits_per_raw_sample") {
+            return readInt(&stream->bitsPerRawSample);
+        }
+        if (key == "pix_fmt") {
+            return readScalar(&stream->pixFmt);
+        }
+        if (key == "color_primaries") {
+            return readScalar(&stream->colorPrimaries);
+        }
+        if (key == "color_transfer") {
+            return readScalar(&stream->colorTransfer);
+        }
+        if (key == "color_space") {
+            return readScalar(&stream->colorSpace);
+        }
+        if (key == "channels") {
+            return readInt(&stream->channels);
+        }
+        if (key == "sample_rate") {
+            return readInt(&stream->sampleRate);
+        }
+        if (key == "disposition") {
+            return parseObject([&](QByteArrayView flag) {
+                if (flag == "default") {
+                    return readFlag(&stream->isDefault);
+                }
+                if (flag == "forced") {
+                    return readFlag(&stream->isForced);
+                }
+                if (flag == "attached_pic") {
+                    return readFlag(&stream->attachedPic);
+                }
+                return skipValue();
+            });
+        }
+        if (key == "tags") {
+            return parseObject([&](QByteArrayView tag) {
+                if (tag == "language") {
+                    return readScalar(&stream->language);
+                }
+                if (tag == "title") {
+                    return readScalar(&stream->title);
+                }
+                return skipValue();
+            });
+        }
+        if (key == "side_data_list") {
+            return parseArray([&] {
+                stream->sideData.append(FFprobeSideData());
+                return parseSideData(&stream->sideData.last());
+            });
+        }
+        return skipValue();
+    });
+}
+
+bool FFprobeParser::parseSideData(FFprobeSideData *side)
+{
+    static const char *const keys[FFprobeSideData::KeyCount] = {
+        "red_x", "red_y", "green_x", "green_y", "blue_x", "blue_y", "white_point_x", "white_point_y",
+        "min_luminance", "max_luminance", "max_content", "max_average"};
+
+    return parseObject([&](QByteArrayView key) {
+        if (key == "side_data_type") {
+            return readScalar(&side->type);
+        }
+        for (int k = 0; k < FFprobeSideData::KeyCount; ++k) {
+            if (key == keys[k]) {
+                return readScalar(&side->values[k]);
+            }
+        }
+        return skipValue();
+    });
+}
+
+bool FFprobeParser::scanString(const char **begin, const char **end, bool *escaped)
+{
+    if (!consume('"')) {
+        return false;
+    }
+    *begin = m_pos;
+    *escaped = false;
+    while (m_pos < m_end && *m_pos != '"') {
+        if (*m_pos == '\\') {
+            *escaped = true;
+            if (++m_pos == m_end) {
+                return false;
+            }
+        } else if (uchar(*m_pos) < 0x20) {
+            return false;           // control characters must be escaped
+        }
+        ++m_pos;
+    }
+    if (m_pos == m_end) {
+        return false;
+    }
+    *end = m_pos++;
+    return true;
+}
+
+bool FFprobeParser::readKey(QByteArrayView *key, QByteArray *scratch)
+{
+    const char *begin;
+    const char *end;
+    bool escaped;
+    if (!scanString(&begin, &end, &escaped)) {
+        return false;
+    }
+    if (!escaped) {
+        *key = QByteArrayView(begin, end - begin);
+        return true;
+    }
+    scratch->clear();
+    if (!unescape(begin, end, scratch)) {
+        return false;
+    }
+    *key = *scratch;
+    return true;
+}
+
+bool FFprobeParser::readString(QString *value)
+{
+    const char *begin;
+    const char *end;
+    bool escaped;
+    if (!scanString(&begin, &end, &escaped)) {
+        return false;
+    }
+    if (!escaped) {
+        *value = QString::fromUtf8(begin, end - begin);
+        return true;
+    }
+    QByteArray bytes;
+    if (!unescape(begin, end, &bytes)) {
+        return false;
+    }
+    *value = QString::fromUtf8(bytes);
+    return true;
+}
+
+bool FFprobeParser::readScalar(QString *value)
+{
+    skipWhitespace();
+    if (m_pos < m_end && *m_pos == '"') {
+        return readString(value);
+    }
+    QByteArrayView token;
+    if (!readBare(&token)) {
+        return false;
+    }
+    if (token != "null") {
+        *value = QString::fromLatin1(token);
+    }
+    return true;
+}
+
+bool FFprobeParser::readInt(int *value)
+{
+    skipWhitespace();
+    QByteArrayView text;
+    if (m_pos < m_end && *m_pos == '"') {
+        // ffprobe quotes some numbers ("sample_rate": "48000"); digits are never escaped
+        const char *begin;
+        const char *end;
+        bool escaped;
+        if (!scanString(&begin, &end, &escaped)) {
+            return false;
+        }
+        text = QByteArrayView(begin, end - begin);
+    } else if (!readBare(&text)) {
+        return false;
+    }
+    toInt(text, value);             // "N/A" and the like leave the default
+    return true;
+}
+
+bool FFprobeParser::readFlag(bool *value)
+{
+    int number = 0;
+    if (!readInt(&number)) {
+        return false;
+    }
+    *value = number != 0;
+    return true;
+}
+
+bool FFprobeParser::readBare(QByteArrayView *token)
+{
+    const char *begin = m_pos;
+    while (m_pos < m_end && isBareChar(*m_pos)) {
+        ++m_pos;
+    }
+    *token = QByteArrayView(begin, m_pos - begin);
+    return *token == "true" || *token == "false" || *token == "null" || isNumber(*token);
+}
+
+bool FFprobeParser::skipValue()
+{
+    // Iterative, with the open brackets as bits (1 = object), so nesting cannot
+    // exhaust the stack and "[}" is still caught
+    quint64 objects = 0;
+    int depth = 0;
+    do {
+        skipWhitespace();
+        if (m_pos == m_end) {
+            return false;
+        }
+        const char c = *m_pos;
+        if (c == '{' || c == '[') {
+            if (depth == MaxSkipDepth) {
+                return false;
+            }
+            objects = (objects << 1) | (c == '{' ? 1 : 0);
+            depth++;
+            ++m_pos;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0 || bool(objects & 1) != (c == '}')) {
+                return false;
+            }
+            objects >>= 1;
+            depth--;
+            ++m_pos;
+        } else if (c == ',' || c == ':') {
+            if (depth == 0) {
+                return false;
+            }
+            ++m_pos;
+        } else if (c == '"') {
+            const char *begin;
+            const char *end;
+            bool escaped;
+            if (!scanString(&begin, &end, &escaped)) {
+                return false;
+            }
+        } else {
+            QByteArrayView token;
+            if (!readBare(&token)) {
+                return false;
+            }
+        }
+    } while (depth > 0);
+    return true;
+}
+
+bool FFprobeParser::unescape(const char *begin, const char *end, QByteArray *out)
+{
+    out->reserve(end - begin);
+    for (const char *p = begin; p < end; ++p) {
+        if (*p != '\\') {
+            out->append(*p);
+            continue;
+        }
+        if (++p == end) {
+            return false;
+        }
+        switch (*p) {
+        case '"':  out->append('"'); break;
+        case '\\': out->append('\\'); break;
+        case '/':  out->append('/'); break;
+        case 'b':  out->append('\b'); break;
+        case 'f':  out->append('\f'); break;
+        case 'n':  out->append('\n'); break;
+        case 'r':  out->append('\r'); break;
+        case 't':  out->append('\t'); break;
+        case 'u': {
+            char32_t cp;
+            if (!readHex4(p + 1, end, &cp)) {
+                return false;
+            }
+            p += 4;
+            if (cp >= 0xD800 && cp < 0xDC00) {
+                // High surrogate; the low half follows as another \u escape
+                char32_t low;
+                if (end - p < 7 || p[1] != '\\' || p[2] != 'u' || !readHex4(p + 3, end, &low)
+                    || low < 0xDC00 || low >= 0xE000) {
+                    return false;
+                }
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                p += 6;
+            } else if (cp >= 0xDC00 && cp < 0xE000) {
+                return false;
+            }
+            appendUtf8(out, cp);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+void FFprobeParser::skipWhitespace()
+{
+    while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t')) {
+        ++m_pos;
+    }
+}
+
+bool FFprobeParser::consume(char c)
+{
+    skipWhitespace();
+    if (m_pos < m_end && *m_pos == c) {
+        ++m_pos;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,105 @@
+#ifndef FFPROBEPARSER_H
+#define FFPROBEPARSER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QVector>
+
+// Side data entry of a stream (mastering display, content light level)
+struct FFprobeSideData {
+    enum Key { RedX, RedY, GreenX, GreenY, BlueX, BlueY, WhitePointX, WhitePointY,
+               MinLuminance, MaxLuminance, MaxContent, MaxAverage, KeyCount };
+
+    QString type;                   // side_data_type
+    QString values[KeyCount];       // as ffprobe printed them ("34000/50000", "1000"), null when absent
+
+    const QString &value(Key key) const { return values[key]; }
+};
+
+// One entry of ffprobe's "streams" array, only the keys MediaAnalyzer reads.
+// Strings are null and numbers -1 when the key is absent.
+struct FFprobeStream {
+    int index = -1;
+    QString codecType;              // "video", "audio", "subtitle", "attachment", "data"
+    QString codecName;
+    int width = -1;
+    int height = -1;
+    QString avgFrameRate;
+    QString rFrameRate;
+    int bitsPerRawSample = -1;
+    QString pixFmt;
+    QString colorPrimaries;
+    QString colorTransfer;
+    QString colorSpace;
+    int channels = -1;
+    int sampleRate = -1;
+    bool isDefault = false;         // disposition.default
+    bool isForced = false;          // disposition.forced
+    bool attachedPic = false;       // disposition.attached_pic: cover art
+    QString language;               // tags.language
+    QString title;                  // tags.title
+    QVector<FFprobeSideData> sideData;
+};
+
+// The "format" object
+struct FFprobeFormat {
+    bool present = false;
+    QString formatName;
+    QString duration;               // seconds as text
+    QString size;                   // bytes as text
+    QString bitRate;                // bits per second as text
+};
+
+struct FFprobeOutput {
+    FFprobeFormat format;
+    QVector<FFprobeStream> streams; // every stream, in file order
+};
+
+// Reader for `ffprobe -print_format json -show_format -show_streams`.
+//
+// One pass over the raw UTF-8 bytes, no DOM and no intermediate QString of the
+// whole output: keys are compared in place, values that are not needed are
+// skipped without being decoded, and only the kept ones become QStrings.
+// Malformed JSON fails the parse as a whole; inside skipped values only string
+// syntax and bracket nesting are checked.
+class FFprobeParser
+{
+public:
+    static bool parse(QByteArrayView json, FFprobeOutput *output);
+
+private:
+    explicit FFprobeParser(QByteArrayView json);
+
+    bool parseRoot(FFprobeOutput *output);
+    bool parseFormat(FFprobeFormat *format);
+    bool parseStream(FFprobeStream *stream);
+    bool parseSideData(FFprobeSideData *side);
+
+    // Calls onKey(key) for every member; onKey consumes the value
+    template <typename OnKey>
+    bool parseObject(OnKey &&onKey);
+    // Calls onElement() for every element; onElement consumes it
+    template <typename OnElement>
+    bool parseArray(OnElement &&onElement);
+
+    // The body of a string, quotes excluded; *escaped tells whether it needs unescape()
+    bool scanString(const char **begin, const char **end, bool *escaped);
+    bool readKey(QByteArrayView *key, QByteArray *scratch);
+    bool readString(QString *value);
+    // A string or a bare number, true, false as text; null leaves *value alone
+    bool readScalar(QString *value);
+    bool readInt(int *value);       // a number or a string holding one
+    bool readFlag(bool *value);     // disposition entries: 0/1
+    bool skipValue();
+    bool readBare(QByteArrayView *token);   // number or literal
+
+    bool unescape(const char *begin, const char *end, QByteArray *out);
+    void skipWhitespace();
+    bool consume(char c);
+
+    const char *m_pos;
+    const char *m_end;
+};
+
+#endif // FFPROBEPARSER_H
@@ -1,15 +1,116 @@
 #include "FileProcessor.h"
 #include "MuxingTask.h"
-#include "../ui/MainWindow.h"
+#include "BlockIo.h"
+#include "MediaInfo.h"
+#include "NalIndex.h"
+#include "SpsParser.h"
+#include "StreamJoin.h"
+#include "ThreadBudget.h"
+#include "TraceRecorder.h"
 #include <QCoreApplication>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QStandardPaths>
 #include <QDebug>
 #include <QRegularExpression>
 #include <QProcess>
 #include <QSettings>
+#include <QSet>
+#include <QDateTime>
+#include <QTimer>
+#include <QJsonObject>
+#include <algorithm>
+#include <cmath>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+namespace {
+
+double frameRateOf(const MediaInfo &mediaInfo)
+{
+    static const QRegularExpression number(R"(([0-9]+(?:\.[0-9]+)?))");
+    const QRegularExpressionMatch match = number.match(mediaInfo.frameRate);
+    const double fps = match.hasMatch() ? match.captured(1).toDouble() : 0.0;
+    return (fps >= 1.0 && fps <= 240.0) ? fps : 0.0;
+}
+
+// "1:02:03" or "2:03" from MediaAnalyzer; 0 if unknown
+double durationSecondsOf(const MediaInfo &mediaInfo)
+{
+    const QStringList parts = mediaInfo.duration.trimmed().split(':');
+    if (parts.size() < 2 || parts.size() > 3) {
+        return 0.0;
+    }
+    double seconds = 0.0;
+    for (const QString &part : parts) {
+        bool ok = false;
+        seconds = seconds * 60.0 + part.toDouble(&ok);
+        if (!ok) {
+            return 0.0;
+        }
+    }
+    return seconds;
+}
+
+// "00h10m05s", for output names
+QString timeTag(double seconds)
+{
+    const qint64 total = qint64(seconds);
+    return QString("%1h%2m%3s").arg(total / 3600, 2, 10, QChar('0'))
+        .arg((total / 60) % 60, 2, 10, QChar('0')).arg(total % 60, 2, 10, QChar('0'));
+}
+
+// Muxer name and options for one tee output
+QString teeOutputSpec(const QString &outputFile)
+{
+    static const QHash<QString, QString> muxers = {
+        {"mp4", "mp4"}, {"mov", "mov"}, {"mkv", "matroska"}, {"webm", "webm"}, {"ts", "mpegts"}
+    };
+    const QString extension = QFileInfo(outputFile).suffix().toLower();
+    QString options = "f=" + muxers.value(extension, extension);
+    if (extension == "mp4" || extension == "mov") {
+        options += ":movflags=+faststart";
+    }
+    // The tee muxer unescapes the output list once; '/' works on every platform
+    QString path = QDir::fromNativeSeparators(outputFile);
+    for (const QChar special : {QChar('\\'), QChar('\''), QChar('|'), QChar('['), QChar(']')}) {
+        path.replace(special, QString("\\") + special);
+    }
+    return QString("[%1]%2").arg(options, path);
+}
 
-QString FileProcessor::detectVideoFormatFromFileName(const QString &fileName)
+// H.273 code point of an ffmpeg colour name, 0 if not mapped
+int colourCode(const QString &name)
+{
+    static const QHash<QString, int> codes = {
+        {"bt709", 1}, {"smpte170m", 6}, {"bt2020", 9}, {"smpte432", 12},            // primaries
+        {"smpte2084", 16}, {"arib-std-b67", 18},                                     // transfer
+        {"bt2020nc", 9}, {"bt2020c", 10}                                             // matrix
+    };
+    return codes.value(name, 0);
+}
+
+// A cancelled ffmpeg gets this long to act on SIGTERM before it is killed
+constexpr int CancelKillMs = 3000;
+
+// ffmpeg's subfile protocol reads only [begin, end) of the file
+QString subfileUrl(const QString &inputFile, qint64 begin, qint64 end)
+{
+    return QString("subfile,,start,%1,end,%2,,:file:%3").arg(begin).arg(end).arg(QDir::toNativeSeparators(inputFile));
+}
+
+} // namespace
+
+QString FileProcessor::detectVideoFormatFromFileName(const QString &fileName) const
 {
     QMap<QString, QStringList> formatKeywords;
     formatKeywords["hevc"] = {"h265", "hevc"};
@@ -46,18 +147,62 @@ QString FileProcessor::parsePixelFormat(const MediaInfo &mediaInfo) const
 
 FileProcessor::FileProcessor(QObject *parent)
     : QObject(parent)
-    , m_currentTask(nullptr)
+    , m_maxParallelJobs(1)
     , m_overwrite(false)
     , m_processing(false)
     , m_currentIndex(0)
+    , m_startedCount(0)
     , m_totalFiles(0)
+    , m_inputBytesDropped(0)
+    , m_outputBytesWrittenBack(0)
+    , m_prefetchOutstanding(0)
+    , m_cpuBudget(1.0)
+    , m_cpuInUse(0.0)
+    , m_memoryBudget(0)
+    , m_memoryInUse(0)
+    , m_threadBudget(false)
+    , m_writeHdrMetadata(false)
+    , m_filmGrainEnabled(false)
+    , m_filmGrainValue(25)
+    , m_longestFirst(true)
+    , m_planGeneration(0)
+    , m_compiling(false)
+    , m_progressTimer(new QTimer(this))
+    , m_completedWork(0.0)
+    , m_lastEtaLogMs(0)
+    , m_etaLogIntervalMs(30000)
+    , m_throughputTimer(new QTimer(this))
+    , m_completedReadBytes(0)
+    , m_lastSampledBytes(0)
+    , m_lastSampleMs(0)
 {
-    m_ffmpegPath = findFFmpegExecutable();
+    // Signal arguments that cross to the GUI thread
+    qRegisterMetaType<BatchPlanPtr>("BatchPlanPtr");
+    qRegisterMetaType<BatchMetrics>("BatchMetrics");
+
+    // One compilation at a time; configure() waits for it before changing its inputs
+    m_planPool.setMaxThreadCount(1);
+    m_throughputTimer->setInterval(1000);
+    connect(m_throughputTimer, &QTimer::timeout, this, &FileProcessor::sampleThroughput);
+    m_progressTimer->setInterval(1000);
+    connect(m_progressTimer, &QTimer::timeout, this, &FileProcessor::updateOverallProgress);
+
+    QSettings settings;
+    m_maxParallelJobs = qMax(1, settings.value("processing/maxParallelJobs", 1).toInt());
+
+    // Prefer the path chosen in the FFmpeg setup dialog, fall back to PATH
+    const QString configuredPath = settings.value("ffmpeg/ffmpeg_path").toString();
+    if (!configuredPath.isEmpty() && QFileInfo(configuredPath).isExecutable()) {
+        m_ffmpegPath = configuredPath;
+    } else {
+        m_ffmpegPath = findFFmpegExecutable();
+    }
 }
 
 FileProcessor::~FileProcessor()
 {
     stop();
+    m_planPool.waitForDone();
 }
 
 void FileProcessor::processFiles(const QStringList &files, const QString &outputFolder,
@@ -70,56 +215,400 @@ void FileProcessor::processFiles(const QStringList &files, const QString &output
         return;
     }
 
+    configure(files, outputFolder, format, mediaInfos, overwrite, processingMode);
+    m_processing = true;
+    emit logMessage(QString("Starting to process %1 files...").arg(files.size()));
+    startCompile(true);
+}
+
+void FileProcessor::compilePlan(const QStringList &files, const QString &outputFolder,
+                                const QString &format, const QVector<MediaInfo> &mediaInfos,
+                                bool overwrite, const QString &processingMode)
+{
+    if (m_processing) {
+        emit logMessage("Already processing files. Stop current operation first.");
+        return;
+    }
+    configure(files, outputFolder, format, mediaInfos, overwrite, processingMode);
+    startCompile(false);
+}
+
+void FileProcessor::runPlan(const BatchPlanPtr &plan)
+{
+    if (m_processing) {
+        emit logMessage("Already processing files. Stop current operation first.");
+        return;
+    }
+    m_planPool.waitForDone();
+    m_processing = true;
+    m_outputNames.reset(new OutputNameRegistry(plan->overwrite));
+    for (const PlannedJob &job : plan->jobs) {
+        for (const QString &output : job.outputs()) {
+            m_outputNames->reservePath(output);
+        }
+    }
+    emit logMessage(QString("Running a plan of %1 jobs for %2 files, compiled %3")
+                        .arg(plan->runCount())
+                        .arg(plan->files.size())
+                        .arg(QDateTime::fromMSecsSinceEpoch(plan->createdMs).toString(Qt::ISODate)));
+    startPlan(plan);
+}
+
+void FileProcessor::configure(const QStringList &files, const QString &outputFolder,
+                              const QString &format, const QVector<MediaInfo> &mediaInfos,
+                              bool overwrite, const QString &processingMode)
+{
+    // The members below are read by compile() on the plan thread; a previous
+    // compilation must be done before they change
+    m_planPool.waitForDone();
+
     m_files = files;
     m_outputFolder = outputFolder;
     m_outputFormat = format;
+    m_fanOutFormats.clear();
+    if (processingMode != "binToYuv") {
+        for (const QString &extra : std::as_const(m_extraFormats)) {
+            const QString lower = extra.toLower();
+            if (lower != format.toLower() && !m_fanOutFormats.contains(lower)) {
+                m_fanOutFormats.append(lower);
+            }
+        }
+    }
     m_mediaInfos = mediaInfos;
     m_overwrite = overwrite;
     m_processingMode = processingMode;
-    m_processing = true;
+
+    QSettings settings;
+    m_writeHdrMetadata = settings.value("hdr/writeMetadata", false).toBool();
+    m_hdrOverride = HdrMetadata();
+    m_hdrOverride.setMasterDisplay(settings.value("hdr/masterDisplay").toString());
+    m_hdrOverride.setMaxCll(settings.value("hdr/maxCll").toString());
+    m_filmGrainEnabled = settings.value("filmgrainEnabled", false).toBool();
+    m_filmGrainValue = qBound(0, settings.value("filmgrainValue", 25).toInt(), 50);
+    m_longestFirst = settings.value("processing/longestFirst", true).toBool();
+    m_dedupMode = settings.value("processing/dedupMode", "off").toString();
+    m_costModel.load();
+    m_outputNames.reset(new OutputNameRegistry(overwrite));
+}
+
+void FileProcessor::startCompile(bool run)
+{
+    const quint64 generation = ++m_planGeneration;
+    const QList<QStringList> joinGroups = m_joinGroups;
+    const QHash<QString, QString> duplicateLeaders = m_duplicateLeaders;
+    const QString program = m_ffmpegPath;
+    m_compiling = run;
+    m_planPool.start([this, generation, run, joinGroups, duplicateLeaders, program]() {
+        const BatchPlanPtr plan(new BatchPlan(compile(joinGroups, duplicateLeaders, program)));
+        QMetaObject::invokeMethod(this, [this, plan, generation, run]() {
+            onPlanCompiled(plan, generation, run);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FileProcessor::onPlanCompiled(const BatchPlanPtr &plan, quint64 generation, bool run)
+{
+    if (generation != m_planGeneration) {
+        return;                 // stopped or superseded while compiling
+    }
+    m_compiling = false;
+    for (const QString &note : plan->notes) {
+        emit logMessage(note);
+    }
+    emit planCompiled(plan);
+    if (run && m_processing) {
+        startPlan(plan);
+    }
+}
+
+BatchPlan FileProcessor::compile(const QList<QStringList> &joinGroups,
+                                 const QHash<QString, QString> &duplicateLeaders, const QString &program) const
+{
+    BatchPlan plan;
+    plan.program = program;
+    plan.processingMode = m_processingMode;
+    plan.outputFormat = m_outputFormat;
+    plan.overwrite = m_overwrite;
+    plan.dedupMode = m_dedupMode;
+    plan.files = m_files;
+    plan.createdMs = QDateTime::currentMSecsSinceEpoch();
+    if (!m_fanOutFormats.isEmpty()) {
+        plan.notes << QString("Writing %1 and %2 from a single read of each input")
+                          .arg(m_outputFormat, m_fanOutFormats.join(", "));
+    }
+
+    // Chunks of a segmented stream become part of their first chunk's job
+    const QHash<int, QList<int>> joins = planJoins(joinGroups, &plan.notes);
+    QSet<int> joinedChunks;
+    for (auto it = joins.constBegin(); it != joins.constEnd(); ++it) {
+        joinedChunks.insert(it.key());
+        for (int chunk : it.value()) {
+            joinedChunks.insert(chunk);
+        }
+    }
+
+    // Duplicates of another file in the batch get a link to its output instead of a job
+    QHash<int, int> linkedTo;       // duplicate -> leader
+    if (m_dedupMode == "hardlink" || m_dedupMode == "reflink") {
+        QHash<QString, int> indexOf;
+        for (int i = 0; i < m_files.size(); ++i) {
+            indexOf.insert(m_files.at(i), i);
+        }
+        for (auto it = duplicateLeaders.constBegin(); it != duplicateLeaders.constEnd(); ++it) {
+            const int duplicate = indexOf.value(it.key(), -1);
+            const int leader = indexOf.value(it.value(), -1);
+            // A copy with its own in/out range needs its own job
+            const MediaInfo duplicateInfo = m_mediaInfos.value(duplicate);
+            const MediaInfo leaderInfo = m_mediaInfos.value(leader);
+            const bool sameRange = duplicateInfo.inPoint == leaderInfo.inPoint
+                && duplicateInfo.outPoint == leaderInfo.outPoint;
+            const bool joined = joinedChunks.contains(duplicate) || joinedChunks.contains(leader);
+            if (duplicate >= 0 && leader >= 0 && sameRange && !joined) {
+                linkedTo.insert(duplicate, leader);
+            }
+        }
+        if (!linkedTo.isEmpty()) {
+            plan.notes << QString("%1 duplicate inputs will be %2ed to the output of their first copy")
+                              .arg(linkedTo.size()).arg(m_dedupMode);
+        }
+    }
+
+    // CRITICAL PATH: Plan a job for each file in the batch. A linked duplicate keeps
+    // its own job, run only if the copy it links to fails.
+    for (int i = 0; i < m_files.size(); ++i) {
+        if (joinedChunks.contains(i) && !joins.contains(i)) {
+            continue;
+        }
+        PlannedJob job = planJob(i, joins.value(i), &plan.notes);
+        job.linkedTo = linkedTo.value(i, -1);
+        plan.jobs << job;
+    }
+
+    // Longest processing time first: a long job started last stretches the whole batch
+    const bool longestFirst = m_longestFirst;
+    std::stable_sort(plan.jobs.begin(), plan.jobs.end(), [longestFirst](const PlannedJob &a, const PlannedJob &b) {
+        if (a.isLinked() != b.isLinked()) {
+            return !a.isLinked();
+        }
+        return longestFirst && a.cost.estimatedSeconds > b.cost.estimatedSeconds;
+    });
+    return plan;
+}
+
+void FileProcessor::startPlan(const BatchPlanPtr &plan)
+{
+    if (!m_cancellingTasks.isEmpty()) {
+        // The stopped batch's jobs are still exiting and removing their partial outputs
+        m_deferredPlan = plan;
+        emit logMessage(QString("Waiting for %1 cancelled jobs to exit").arg(m_cancellingTasks.size()));
+        return;
+    }
+    m_plan = plan;
+    m_files = plan->files;
+    m_overwrite = plan->overwrite;
+    m_processingMode = plan->processingMode;
+    m_dedupMode = plan->dedupMode;
     m_currentIndex = 0;
-    m_totalFiles = files.size();
+    m_startedCount = 0;
+    m_totalFiles = m_files.size();
+    m_ioSettings = IoPolicy::Settings::load();
+    m_processSettings = ProcessPolicy::Settings::load();
+    m_inputBytesDropped = 0;
+    m_outputBytesWrittenBack = 0;
+    m_prefetched.clear();
+    m_prefetchOutstanding = 0;
+    m_metrics.begin();
+    m_taskSlots.clear();
+    m_completedReadBytes = 0;
+    m_lastSampledBytes = 0;
+    m_lastSampleMs = BatchMetrics::clockMs();
+    m_costModel.load();
+    m_taskCosts.clear();
+    m_cpuBudget = CostModel::cpuBudget();
+    m_threadBudget = ThreadBudget::isEnabled();
+    m_memoryBudget = CostModel::memoryBudgetBytes();
+    m_cpuInUse = 0.0;
+    m_memoryInUse = 0;
 
     qDeleteAll(m_taskQueue);
     m_taskQueue.clear();
 
-    emit logMessage(QString("Starting to process %1 files...").arg(m_totalFiles));
     emit logMessage(QString("FFmpeg path: %1").arg(m_ffmpegPath.isEmpty() ? "Not found" : m_ffmpegPath));
+    emit logMessage(QString("Child process limits: %1").arg(ProcessPolicy::describe(m_processSettings)));
 
     if (m_ffmpegPath.isEmpty()) {
         emit logMessage("[ERROR] FFmpeg executable not found. Please ensure FFmpeg is in PATH.");
         m_processing = false;
+        emit finished();
         return;
     }
 
+    // CRITICAL PATH: Create processing tasks for each job of the plan
+    m_joinedInto.clear();
+    m_duplicatesOf.clear();
+    m_linkedJobs.clear();
+    m_taskIndex.clear();
+    QVector<double> progressWeights(m_files.size(), 0.0);
+    for (const PlannedJob &job : plan->jobs) {
+        if (job.isLinked()) {
+            m_duplicatesOf[job.linkedTo].append(job.row);
+            m_linkedJobs.insert(job.row, job);
+            continue;
+        }
+        if (!job.joinedRows.isEmpty()) {
+            m_joinedInto.insert(job.row, job.joinedRows);
+        }
+        progressWeights[job.row] = job.cost.estimatedSeconds;
+        m_taskQueue.enqueue(createTask(job));
+    }
+
+    m_progressBoard.reset(progressWeights);
+    emit batchStarted();
 
-    // CRITICAL PATH: Create processing tasks for each file in the batch
-    for (int i = 0; i < m_files.size(); ++i) {
-        const QString &inputFile = m_files[i];
-        const MediaInfo mediaInfo = (i < m_mediaInfos.size()) ? m_mediaInfos[i] : MediaInfo();
+    const double totalSeconds = plan->estimatedSeconds();
+    emit logMessage(QString("Estimated work: %1 s in total, budget %2 cores / %3")
+                        .arg(totalSeconds, 0, 'f', 0)
+                        .arg(m_cpuBudget, 0, 'f', 1)
+                        .arg(m_memoryBudget > 0 ? QString("%1 MB").arg(m_memoryBudget / (1024 * 1024))
+                                                : QString("unlimited memory")));
 
-        QString outputFile = generateOutputFilePath(inputFile, mediaInfo);
+    m_completedWork = 0.0;
+    m_lastEtaLogMs = BatchMetrics::clockMs();
+    m_etaLogIntervalMs = qint64(qMax(0, QSettings().value("processing/etaLogIntervalSec", 30).toInt())) * 1000;
+    m_progressEstimator.begin(totalSeconds, qMin(m_maxParallelJobs, m_taskQueue.size()));
+    m_progressTimer->start();
 
+    if (TraceRecorder::instance().isEnabled()) {
+        m_throughputTimer->start();
+    }
 
-        MuxingTask *task = new MuxingTask(this);
-        task->setFiles(inputFile, outputFile);
+    processNextFile();
+}
 
-        // Build command based on processing mode (standard muxing vs BIN->YUV conversion)
-        QStringList commandArgs;
-        if (m_processingMode == "binToYuv") {
-            commandArgs = buildBinToYuvCommand(inputFile, outputFile, mediaInfo);
-        } else {
-            commandArgs = buildFFmpegCommand(inputFile, outputFile, m_outputFormat, mediaInfo);
+PlannedJob FileProcessor::planJob(int index, const QList<int> &chunks, QStringList *notes) const
+{
+    const QString &inputFile = m_files[index];
+    const MediaInfo mediaInfo = m_mediaInfos.value(index);
+
+    PlannedJob job;
+    job.row = index;
+    job.inputFile = inputFile;
+    job.joinedRows = chunks;
+    job.probeStartMs = mediaInfo.probeStartMs;
+    job.probeEndMs = mediaInfo.probeEndMs;
+
+    // A joined group is named after its chunks: "title_muxed.mp4"
+    const bool joined = !chunks.isEmpty();
+    const QList<int> rows = QList<int>{index} + chunks;
+    QString namingFile = inputFile;
+    if (joined) {
+        QStringList files;
+        for (int row : rows) {
+            files << m_files.at(row);
+        }
+        const QFileInfo inputInfo(inputFile);
+        namingFile = inputInfo.absolutePath() + '/' + StreamJoin::joinedBaseName(files) + '.' + inputInfo.suffix();
+    }
+    job.outputFile = generateOutputFilePath(namingFile, mediaInfo);
+    job.extraOutputs = extraOutputPaths(namingFile, mediaInfo);
+
+    Extraction extraction;
+    job.expectedFrames = mediaInfo.frameCount;
+    if (joined) {
+        extraction = planJoin(rows);
+        *notes << QString("%1: joining %2").arg(QFileInfo(job.outputFile).fileName(), extraction.description);
+        job.expectedDurationMs = extraction.durationMs;
+        job.expectedFrames = extraction.frames;
+    } else if (mediaInfo.hasRange()) {
+        extraction = planExtraction(inputFile, mediaInfo);
+        *notes << QString("%1: extracting %2").arg(QFileInfo(inputFile).fileName(), extraction.description);
+        job.expectedDurationMs = extraction.durationMs;
+        job.expectedFrames = extraction.frames;
+    }
+
+    // New HDR static metadata goes into the bitstream: ffmpeg reads the stream
+    // from a pipe, rewritten on the way, instead of from the file
+    NalIndex::Codec codec = NalIndex::Codec::Unknown;
+    const HdrMetadata hdr = plannedHdrMetadata(inputFile, mediaInfo, &codec, notes);
+    const bool injectHdr = !hdr.isEmpty();
+    if (injectHdr) {
+        if (extraction.segments.isEmpty()) {
+            extraction.segments << SeiInjector::Segment{inputFile, 0, QFileInfo(inputFile).size()};
         }
-        task->setCommandAndArgs(m_ffmpegPath, commandArgs);
+        extraction.inputArgs = QStringList{"-f", codec == NalIndex::Codec::H265 ? "hevc" : "h264"};
+        extraction.input = "pipe:0";
+        job.injectSegments = extraction.segments;
+        job.injectCodec = codec;
+        job.injectMetadata = hdr;
+        *notes << QString("%1: writing HDR metadata (%2)").arg(QFileInfo(inputFile).fileName(), hdr.describe());
+    }
 
-        connect(task, &MuxingTask::finished, this, &FileProcessor::onTaskFinished);
-        connect(task, &MuxingTask::logMessage, this, &FileProcessor::logMessage);
+    // Where ffmpeg reads, for the page-cache policy: the segments of a join or byte
+    // range; a time seek into a container reads from wherever its index points
+    for (const SeiInjector::Segment &segment : std::as_const(extraction.segments)) {
+        job.readRanges << IoPolicy::FileRange{segment.file, segment.begin, segment.end};
+    }
+    job.seeksInput = job.readRanges.isEmpty() && !joined && mediaInfo.hasRange() && mediaInfo.inPoint > 0.0;
 
-        m_taskQueue.enqueue(task);
+    // Build command based on processing mode (standard muxing vs BIN->YUV conversion)
+    if (m_processingMode == "binToYuv") {
+        job.arguments = buildBinToYuvCommand(inputFile, job.outputFile, mediaInfo);
+    } else {
+        job.arguments = buildFFmpegCommand(inputFile, job.outputFile, m_outputFormat, mediaInfo, job.extraOutputs,
+                                           (joined || injectHdr) ? &extraction : nullptr);
     }
 
-    processNextFile();
+    JobCost::Kind kind = JobCost::StreamCopy;
+    if (m_processingMode == "binToYuv") {
+        kind = JobCost::DecodeToYuv;
+    } else if (job.arguments.contains("libsvtav1")) {
+        kind = JobCost::Reencode;
+    }
+    job.cost = m_costModel.estimate(inputFile, mediaInfo, kind);
+    if (extraction.inputBytes >= 0 && job.cost.inputBytes > 0) {
+        // Only the section is read and written, or every chunk of a join
+        const double share = double(extraction.inputBytes) / job.cost.inputBytes;
+        job.cost.inputBytes = extraction.inputBytes;
+        job.cost.pixels *= share;
+        job.cost.estimatedSeconds *= share;
+    }
+    return job;
+}
+
+MuxingTask *FileProcessor::createTask(const PlannedJob &job)
+{
+    MuxingTask *task = new MuxingTask(this);
+    task->setFiles(job.inputFile, job.outputFile);
+    task->setExtraOutputs(job.extraOutputs);
+    task->setExpectedFrames(job.expectedFrames);
+    task->setExpectedDurationMs(job.expectedDurationMs);
+    if (job.injectsHdr()) {
+        task->setInputInjector(new SeiInjector(job.injectSegments, job.injectCodec, job.injectMetadata));
+    }
+    task->setCommandAndArgs(m_ffmpegPath, job.arguments);
+    task->setIoPolicy(m_ioSettings);
+    if (job.seeksInput) {
+        task->setInputRanges({});
+    } else if (!job.readRanges.isEmpty()) {
+        task->setInputRanges(job.readRanges);
+    }
+
+    m_taskCosts.insert(task, job.cost);
+    task->setProgressSlot(&m_progressBoard, job.row);
+    m_taskIndex.insert(task, job.row);
+
+    JobTiming timing;
+    timing.inputFile = job.inputFile;
+    timing.outputFile = job.outputFile;
+    timing.queuedMs = BatchMetrics::clockMs();
+    timing.probeStartMs = job.probeStartMs;
+    timing.probeEndMs = job.probeEndMs;
+    task->setTiming(timing);
+
+    connect(task, &MuxingTask::finished, this, &FileProcessor::onTaskFinished);
+    connect(task, &MuxingTask::logMessage, this, &FileProcessor::logMessage);
+
+    return task;
 }
 
 void FileProcessor::stop()
@@ -130,53 +619,581 @@ void FileProcessor::stop()
 
     emit logMessage("Stopping processing...");
 
-    if (m_currentTask) {
-        m_currentTask->stop();
-        m_currentTask = nullptr;
+    // Clear the flag first: stopping a task can deliver its finished signal
+    // synchronously, and that must not start the next queued job.
+    m_processing = false;
+    m_planGeneration++;         // a plan still compiling is dropped when it arrives
+    if (m_compiling) {
+        // No job of this batch was created yet, but its rows already show as queued
+        m_compiling = false;
+        for (const QString &file : std::as_const(m_files)) {
+            emit fileCancelled(file);
+        }
+        emit finished();
+        return;
+    }
+
+    // Rows of jobs that never started are cancelled now, running ones as they exit
+    const QList<MuxingTask*> running = m_runningTasks;
+    QStringList cancelledFiles;
+    if (m_deferredPlan) {
+        // Waiting for the previous batch's cancelled jobs; none of its own has started
+        cancelledFiles << m_deferredPlan->files;
+        m_deferredPlan.reset();
+    }
+    for (MuxingTask *task : std::as_const(m_taskQueue)) {
+        cancelledFiles << jobFiles(m_taskIndex.value(task, -1));
+    }
+    for (MuxingTask *task : running) {
+        m_cancellingTasks.insert(task, jobFiles(m_taskIndex.value(task, -1)));
+    }
+    if (!running.isEmpty()) {
+        emit logMessage(QString("Cancelling %1 running jobs").arg(running.size()));
+    }
+
+    m_runningTasks.clear();
+    m_taskSlots.clear();
+    m_taskCosts.clear();
+    m_taskIndex.clear();
+    m_duplicatesOf.clear();
+    m_linkedJobs.clear();
+    m_joinedInto.clear();
+    m_cpuInUse = 0.0;
+    m_memoryInUse = 0;
+    for (MuxingTask *task : running) {
+        disconnect(task, &MuxingTask::finished, this, &FileProcessor::onTaskFinished);
+        connect(task, &MuxingTask::cancelled, this, &FileProcessor::onTaskCancelled);
+        task->cancel(CancelKillMs);
     }
 
     qDeleteAll(m_taskQueue);
     m_taskQueue.clear();
+    m_prefetched.clear();
+    m_prefetchOutstanding = 0;
 
-    m_processing = false;
+    for (const QString &file : std::as_const(cancelledFiles)) {
+        emit fileCancelled(file);
+    }
+    if (m_metrics.isRunning()) {    // a deferred batch never began its metrics
+        finishMetrics();
+    }
     emit finished();
 }
 
+void FileProcessor::onTaskCancelled()
+{
+    MuxingTask *task = qobject_cast<MuxingTask*>(sender());
+    if (!task || !m_cancellingTasks.contains(task)) {
+        return;
+    }
+    const QStringList files = m_cancellingTasks.take(task);
+    emit logMessage(QString("Cancelled: %1").arg(QFileInfo(task->getInputFile()).fileName()));
+    task->deleteLater();
+
+    // A batch started since then owns the rows
+    if (!m_processing) {
+        for (const QString &file : files) {
+            emit fileCancelled(file);
+        }
+    }
+    if (m_cancellingTasks.isEmpty() && m_deferredPlan) {
+        const BatchPlanPtr plan = m_deferredPlan;
+        m_deferredPlan.reset();
+        startPlan(plan);
+    }
+}
+
+void FileProcessor::claimOutputs(MuxingTask *task)
+{
+    // CRITICAL PATH: Create each output with O_EXCL before ffmpeg opens it. A name
+    // taken since the folder was listed moves to the next free one instead of
+    // being overwritten; two jobs can never end up writing the same file.
+    const QStringList planned = QStringList{task->getOutputFile()} + task->extraOutputs();
+    QStringList outputs;
+    QStringList args = task->arguments();
+    bool claimedAny = false;
+    for (const QString &output : planned) {
+        QString path = output;
+        bool taken = false;
+        bool claimed = false;
+        while (!(claimed = OutputNameRegistry::claim(path, &taken)) && taken) {
+            const QFileInfo info(output);
+            path = m_outputNames->reserve(info.absolutePath(), [&info](int n) {
+                return OutputNameRegistry::numbered(info.fileName(), n + 1);
+            });
+        }
+        if (path != output) {
+            emit logMessage(QString("[WARN] %1 was created after the batch was planned; writing %2 instead")
+                                .arg(QFileInfo(output).fileName(), QFileInfo(path).fileName()));
+            for (QString &arg : args) {
+                if (arg == QDir::toNativeSeparators(output)) {
+                    arg = QDir::toNativeSeparators(path);
+                } else {
+                    arg.replace(teeOutputSpec(output), teeOutputSpec(path));
+                }
+            }
+        }
+        claimedAny = claimedAny || claimed;
+        outputs << path;
+    }
+    // The empty files are ours now; without -y ffmpeg would ask on stdin whether
+    // to overwrite them and wait for an answer that never comes
+    const bool addOverwrite = claimedAny && !args.contains("-y");
+    if (addOverwrite) {
+        args.prepend("-y");
+    }
+    if (outputs != planned || addOverwrite) {
+        task->setFiles(task->getInputFile(), outputs.first());
+        task->setExtraOutputs(outputs.mid(1));
+        task->setCommandAndArgs(m_ffmpegPath, args);
+    }
+}
+
+QStringList FileProcessor::jobFiles(int index) const
+{
+    QStringList files;
+    if (index < 0 || index >= m_files.size()) {
+        return files;
+    }
+    files << m_files.at(index);
+    for (int row : m_joinedInto.value(index) + m_duplicatesOf.value(index)) {
+        if (row >= 0 && row < m_files.size()) {
+            files << m_files.at(row);
+        }
+    }
+    return files;
+}
+
 void FileProcessor::processNextFile()
 {
-    // CRITICAL PATH: Process files one by one from the queue
-    if (m_taskQueue.isEmpty()) {
+    // CRITICAL PATH: Start queued files while job slots are free.
+    // A task that fails to start finishes synchronously and re-enters here,
+    // so the loop re-checks m_processing on every iteration.
+    while (m_processing && !m_taskQueue.isEmpty() && m_runningTasks.size() < m_maxParallelJobs) {
+        balanceThreads();
+        const int next = nextAdmissibleTask();
+        if (next < 0) {
+            break;      // resumes when a running job releases its CPU/memory share
+        }
+        MuxingTask *task = m_taskQueue.takeAt(next);
+        const JobCost cost = m_taskCosts.value(task);
+        m_cpuInUse += cost.cpuCores;
+        m_memoryInUse += cost.memoryBytes;
+        m_runningTasks.append(task);
+        m_startedCount++;
+
+        // Lowest free worker slot, one trace track per slot
+        const QList<int> usedSlots = m_taskSlots.values();
+        int slot = 0;
+        while (usedSlots.contains(slot)) {
+            slot++;
+        }
+        m_taskSlots.insert(task, slot);
+        task->setProcessPolicy(m_processSettings, slot);
+
+        if (!m_overwrite) {
+            claimOutputs(task);
+        }
+
+        QString threadNote;
+        if (m_threadBudget && cost.kind != JobCost::StreamCopy) {
+            const int threads = int(cost.cpuCores);
+            task->setCommandAndArgs(m_ffmpegPath, ThreadBudget::apply(task->arguments(), cost.kind, threads));
+            threadNote = QString(" (%1 threads)").arg(threads);
+        }
+
+        emit logMessage(QString("Processing file %1/%2: %3%4")
+                            .arg(m_startedCount)
+                            .arg(m_totalFiles)
+                            .arg(QFileInfo(task->getInputFile()).fileName())
+                            .arg(threadNote));
+
+        emit progress(m_currentIndex, m_totalFiles, task->getInputFile());
+
+        // The input is being consumed now, so its prefetch no longer counts against the budget
+        m_prefetchOutstanding -= m_prefetched.take(task->getInputFile());
+
+        task->start();
+    }
+
+    if (!m_processing) {
+        return;
+    }
+
+    traceQueueDepth();
+
+    if (m_taskQueue.isEmpty() && m_runningTasks.isEmpty()) {
         m_processing = false;
+        if (m_ioSettings.enabled) {
+            emit logMessage(QString("Page cache: released %1 MB of input, wrote back %2 MB of output steadily; %3")
+                                .arg(m_inputBytesDropped / (1024 * 1024))
+                                .arg(m_outputBytesWrittenBack / (1024 * 1024))
+                                .arg(IoPolicy::describeMemoryUsage(IoPolicy::memoryUsage())));
+        }
+        // Only this batch's requests; fingerprinting does not count
+        const BlockIo::Stats ioStats = m_metrics.blockIoStats();
+        if (ioStats.reads + ioStats.writes > 0) {
+            emit logMessage(QString("In-process I/O: %1").arg(BlockIo::describeStats(ioStats)));
+        }
+        finishMetrics();
         emit logMessage("Batch processing completed. Review individual file results above.");
         emit finished();
         return;
     }
 
-    m_currentTask = m_taskQueue.dequeue();
+    prefetchQueuedInputs();
+}
 
-    emit logMessage(QString("Processing file %1/%2: %3")
-                        .arg(m_currentIndex + 1)
-                        .arg(m_totalFiles)
-                        .arg(QFileInfo(m_currentTask->getInputFile()).fileName()));
+void FileProcessor::balanceThreads()
+{
+    if (!m_threadBudget) {
+        return;
+    }
+    // The free cores are split between the decodes/re-encodes that can start now;
+    // running jobs keep the count they were started with
+    int computeQueued = 0;
+    for (MuxingTask *task : std::as_const(m_taskQueue)) {
+        if (m_taskCosts.value(task).kind != JobCost::StreamCopy) {
+            computeQueued++;
+        }
+    }
+    if (computeQueued == 0) {
+        return;
+    }
+    const int sharers = qBound(1, m_maxParallelJobs - int(m_runningTasks.size()), computeQueued);
+    const double freeCores = m_cpuBudget - m_cpuInUse;
+    for (MuxingTask *task : std::as_const(m_taskQueue)) {
+        JobCost &cost = m_taskCosts[task];
+        if (cost.kind != JobCost::StreamCopy) {
+            cost.cpuCores = ThreadBudget::share(cost.kind, freeCores, sharers);
+        }
+    }
+}
 
-    emit progress(m_currentIndex, m_totalFiles, m_currentTask->getInputFile());
+int FileProcessor::nextAdmissibleTask() const
+{
+    auto fits = [this](const JobCost &cost) {
+        return m_cpuInUse + cost.cpuCores <= m_cpuBudget + 1e-6
+            && (m_memoryBudget <= 0 || m_memoryInUse + cost.memoryBytes <= m_memoryBudget);
+    };
+
+    // An idle machine always takes the head, even a job larger than the budget
+    if (m_runningTasks.isEmpty() || fits(m_taskCosts.value(m_taskQueue.head()))) {
+        return 0;
+    }
 
-    m_currentTask->start();
+    // Backfill behind a blocked head only with jobs that should end before the first
+    // running job does, so the head still starts as soon as resources free up
+    const qint64 nowMs = BatchMetrics::clockMs();
+    double firstRelease = -1.0;
+    for (MuxingTask *running : std::as_const(m_runningTasks)) {
+        const double elapsed = (nowMs - running->timing().spawnMs) / 1000.0;
+        const double remaining = qMax(0.0, m_taskCosts.value(running).estimatedSeconds - elapsed);
+        if (firstRelease < 0.0 || remaining < firstRelease) {
+            firstRelease = remaining;
+        }
+    }
+    for (int i = 1; i < m_taskQueue.size(); ++i) {
+        const JobCost cost = m_taskCosts.value(m_taskQueue.at(i));
+        if (fits(cost) && cost.estimatedSeconds <= firstRelease) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void FileProcessor::prefetchQueuedInputs()
+{
+    // Warm the head of the next few inputs so the following job does not start
+    // cold on slow storage. Skipped when the storage is already under pressure,
+    // where extra reads would only slow down the job that is running.
+    if (!m_ioSettings.enabled || m_ioSettings.prefetchDepth <= 0) {
+        return;
+    }
+
+    const double pressure = IoPolicy::ioPressure();
+    if (pressure > m_ioSettings.prefetchMaxIoPressure) {
+        return;
+    }
+
+    const int depth = qMin(m_ioSettings.prefetchDepth, m_taskQueue.size());
+    for (int i = 0; i < depth; ++i) {
+        const QString inputFile = m_taskQueue.at(i)->getInputFile();
+        // The first bytes the job will read: the start of its section or first chunk.
+        // Nothing for a time seek, whose first read is not known.
+        const QList<IoPolicy::FileRange> ranges = m_taskQueue.at(i)->inputRanges();
+        if (ranges.isEmpty() || m_prefetched.contains(inputFile)) {
+            continue;
+        }
+        if (m_prefetchOutstanding + m_ioSettings.prefetchHeadBytes > m_ioSettings.prefetchBudgetBytes) {
+            break;
+        }
+        const IoPolicy::FileRange &first = ranges.first();
+        const qint64 head = first.end >= 0 ? qMin(m_ioSettings.prefetchHeadBytes, first.end - first.begin)
+                                           : m_ioSettings.prefetchHeadBytes;
+        qint64 requested = IoPolicy::prefetchFile(first.file, first.begin, head);
+        m_prefetched.insert(inputFile, requested);
+        m_prefetchOutstanding += requested;
+    }
+}
+
+void FileProcessor::finishMetrics()
+{
+    m_metrics.finish();
+    m_costModel.save();
+    m_progressTimer->stop();
+    m_throughputTimer->stop();
+
+    const BatchMetrics::Summary s = m_metrics.summary();
+    if (s.jobs > 0) {
+        const BatchMetrics::Percentiles &total = s.phases[BatchMetrics::Total];
+        const BatchMetrics::Percentiles &wait = s.phases[BatchMetrics::QueueWait];
+        const BatchMetrics::Percentiles &post = s.phases[BatchMetrics::PostProcess];
+        emit logMessage(QString("Batch timing: %1 jobs in %2 s (%3 jobs/s, read %4 MB/s, write %5 MB/s); "
+                                "job p50/p99 %6/%7 s, queue wait p50 %8 s, post-process p99 %9 s")
+                            .arg(s.jobs)
+                            .arg(s.seconds, 0, 'f', 1)
+                            .arg(s.jobsPerSecond, 0, 'f', 2)
+                            .arg(s.readMBps, 0, 'f', 1)
+                            .arg(s.writeMBps, 0, 'f', 1)
+                            .arg(total.p50 / 1000.0, 0, 'f', 2)
+                            .arg(total.p99 / 1000.0, 0, 'f', 2)
+                            .arg(wait.p50 / 1000.0, 0, 'f', 2)
+                            .arg(post.p99 / 1000.0, 0, 'f', 2));
+    }
+
+    // Optional exports, e.g. metrics/prometheusTextfile =
+    // /var/lib/node_exporter/textfile_collector/promuxer.prom
+    QSettings settings;
+    const QString jsonPath = settings.value("metrics/jsonPath").toString();
+    const QString promPath = settings.value("metrics/prometheusTextfile").toString();
+    QString error;
+    if (!jsonPath.isEmpty() && !m_metrics.writeJson(jsonPath, &error)) {
+        emit logMessage(QString("[WARN] Could not write batch metrics to %1: %2").arg(jsonPath, error));
+    }
+    if (!promPath.isEmpty() && !m_metrics.writePrometheusTextfile(promPath, &error)) {
+        emit logMessage(QString("[WARN] Could not write Prometheus textfile %1: %2").arg(promPath, error));
+    }
+
+    const QString tracePath = TraceRecorder::instance().finishFile();
+    if (!tracePath.isEmpty()) {
+        emit logMessage(QString("Trace written to %1 (open in ui.perfetto.dev or chrome://tracing)").arg(tracePath));
+    }
+
+    emit metricsUpdated(m_metrics);
+}
+
+void FileProcessor::setPriority(int niceLevel, int ioClass, int ioLevel)
+{
+    m_processSettings.niceLevel = niceLevel;
+    m_processSettings.ioClass = ioClass;
+    m_processSettings.ioLevel = ioLevel;
+
+    for (MuxingTask *task : std::as_const(m_runningTasks)) {
+        if (!ProcessPolicy::setPriority(task->processId(), niceLevel, ioClass, ioLevel)) {
+            emit logMessage(QString("[WARN] Could not change priority of %1 (raising priority needs CAP_SYS_NICE)")
+                                .arg(QFileInfo(task->getInputFile()).fileName()));
+        }
+    }
+}
+
+void FileProcessor::resolveDuplicates(int leaderIndex, bool leaderSucceeded, const QStringList &leaderOutputs)
+{
+    const QList<int> duplicates = m_duplicatesOf.take(leaderIndex);
+    for (int index : duplicates) {
+        const PlannedJob job = m_linkedJobs.take(index);
+        const QString &inputFile = job.inputFile;
+        if (!leaderSucceeded) {
+            // No output to share: the copy gets its own job after all
+            emit logMessage(QString("[WARN] %1 failed; processing its duplicate %2 separately")
+                                .arg(QFileInfo(m_files.at(leaderIndex)).fileName())
+                                .arg(QFileInfo(inputFile).fileName()));
+            m_progressEstimator.addWork(job.cost.estimatedSeconds);
+            m_taskQueue.enqueue(createTask(job));
+            continue;
+        }
+
+        const QString &outputFile = job.outputFile;
+        // Same order as the leader's outputs: batch format first, then the extras
+        const QStringList outputs = job.outputs();
+        QString method;
+        QString error;
+        bool ok = true;
+        for (int i = 0; ok && i < outputs.size() && i < leaderOutputs.size(); ++i) {
+            ok = linkOutput(leaderOutputs.at(i), outputs.at(i), &method, &error);
+        }
+        if (ok) {
+            emit logMessage(QString("✓ Duplicate of %1: %2 -> %3 (%4)")
+                                .arg(QFileInfo(m_files.at(leaderIndex)).fileName())
+                                .arg(QFileInfo(inputFile).fileName())
+                                .arg(QFileInfo(outputFile).fileName())
+                                .arg(method));
+        } else {
+            emit logMessage(QString("[ERROR] ✗ Failed to link duplicate output: %1 - %2")
+                                .arg(QFileInfo(outputFile).fileName())
+                                .arg(error));
+        }
+        m_progressBoard.publish(index, ok ? ProgressBoard::Succeeded : ProgressBoard::Failed, 1.0);
+        m_currentIndex++;
+        emit fileProcessed(inputFile, ok);
+    }
+}
+
+bool FileProcessor::linkOutput(const QString &source, const QString &target, QString *method, QString *error) const
+{
+    if (QFileInfo::exists(target)) {
+        if (!m_overwrite) {
+            *error = "output file already exists";
+            return false;
+        }
+        QFile::remove(target);
+    }
+    QDir().mkpath(QFileInfo(target).absolutePath());
+
+#ifdef Q_OS_LINUX
+    const QByteArray sourcePath = QFile::encodeName(source);
+    const QByteArray targetPath = QFile::encodeName(target);
+    if (m_dedupMode == "hardlink") {
+        if (::link(sourcePath.constData(), targetPath.constData()) == 0) {
+            *method = "hardlink";
+            return true;
+        }
+    } else {
+        // Shares extents on btrfs/XFS; fails with EOPNOTSUPP or EXDEV elsewhere
+        const int in = ::open(sourcePath.constData(), O_RDONLY | O_CLOEXEC);
+        const int out = (in >= 0) ? ::open(targetPath.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644) : -1;
+        const bool cloned = (out >= 0 && ::ioctl(out, FICLONE, in) == 0);
+        if (in >= 0) {
+            ::close(in);
+        }
+        if (out >= 0) {
+            ::close(out);
+            if (!cloned) {
+                ::unlink(targetPath.constData());
+            }
+        }
+        if (cloned) {
+            *method = "reflink";
+            return true;
+        }
+    }
+#elif defined(Q_OS_WIN)
+    if (m_dedupMode == "hardlink"
+        && CreateHardLinkW(reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(target).utf16()),
+                           reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(source).utf16()), nullptr)) {
+        *method = "hardlink";
+        return true;
+    }
+#endif
+
+    // Different filesystem or no link support
+    if (QFile::copy(source, target)) {
+        *method = "copy";
+        return true;
+    }
+    *error = QString("cannot link or copy %1").arg(QFileInfo(source).fileName());
+    return false;
+}
+
+void FileProcessor::updateOverallProgress()
+{
+    double work = m_completedWork;
+    for (MuxingTask *task : std::as_const(m_runningTasks)) {
+        work += m_taskCosts.value(task).estimatedSeconds * task->progressFraction();
+    }
+    m_progressEstimator.sample(work);
+    const ProgressEstimator::Estimate estimate = m_progressEstimator.estimate();
+    emit overallProgress(estimate.fraction, estimate.etaMs, estimate.etaLowMs, estimate.etaHighMs);
+
+    // Periodic line for the log and headless runs
+    const qint64 nowMs = BatchMetrics::clockMs();
+    if (m_etaLogIntervalMs > 0 && nowMs - m_lastEtaLogMs >= m_etaLogIntervalMs) {
+        m_lastEtaLogMs = nowMs;
+        emit logMessage(QString("Overall progress: %1").arg(ProgressEstimator::describe(estimate)));
+    }
+}
+
+void FileProcessor::traceJob(MuxingTask *task, int slot, bool success, const QString &message)
+{
+    TraceRecorder &trace = TraceRecorder::instance();
+    const JobTiming t = task->timing();
+
+    QJsonObject args;
+    args["input"] = t.inputFile;
+    args["output"] = t.outputFile;
+    args["success"] = success;
+    args["bytes_read"] = double(t.bytesRead);
+    args["bytes_written"] = double(t.bytesWritten);
+    args["queue_wait_ms"] = double(t.spawnMs - t.queuedMs);
+
+    // The job span encloses its phases, which nest beneath it on the slot track
+    trace.span(TraceRecorder::ProcessorProcess, slot, QFileInfo(t.inputFile).fileName(), "job",
+               t.spawnMs, t.postEndMs, args);
+    trace.span(TraceRecorder::ProcessorProcess, slot, "spawn", "phase", t.spawnMs, t.firstProgressMs);
+    trace.span(TraceRecorder::ProcessorProcess, slot, "mux", "phase",
+               t.firstProgressMs >= 0 ? t.firstProgressMs : t.spawnMs, t.muxEndMs);
+    if (t.postEndMs > t.muxEndMs) {
+        trace.span(TraceRecorder::ProcessorProcess, slot, "faststart", "phase", t.muxEndMs, t.postEndMs);
+    }
+
+    if (!success) {
+        QJsonObject errorArgs;
+        errorArgs["input"] = t.inputFile;
+        errorArgs["message"] = message;
+        trace.instant(TraceRecorder::ProcessorProcess, slot, "job failed", "error", errorArgs);
+    }
+}
+
+void FileProcessor::traceQueueDepth()
+{
+    if (!m_throughputTimer->isActive()) {
+        return; // tracing is off for this batch
+    }
+    QJsonObject values;
+    values["queued"] = m_taskQueue.size();
+    values["running"] = m_runningTasks.size();
+    TraceRecorder::instance().counter(TraceRecorder::ProcessorProcess, "jobs", values);
+}
+
+void FileProcessor::sampleThroughput()
+{
+    // Aggregate read rate of all running jobs, from their /proc/<pid>/io samples
+    qint64 bytes = m_completedReadBytes;
+    for (MuxingTask *task : std::as_const(m_runningTasks)) {
+        bytes += task->bytesReadSoFar();
+    }
+    const qint64 nowMs = BatchMetrics::clockMs();
+    const qint64 elapsedMs = nowMs - m_lastSampleMs;
+    if (elapsedMs <= 0) {
+        return;
+    }
+    QJsonObject values;
+    values["read"] = qMax<qint64>(0, bytes - m_lastSampledBytes) / (1024.0 * 1024.0) / (elapsedMs / 1000.0);
+    TraceRecorder::instance().counter(TraceRecorder::ProcessorProcess, "MB/s", values);
+    m_lastSampledBytes = bytes;
+    m_lastSampleMs = nowMs;
 }
 
 void FileProcessor::onTaskFinished(bool success, const QString &message)
 {
-    if (!m_currentTask) {
+    // Jobs complete in any order when several run at once
+    MuxingTask *task = qobject_cast<MuxingTask*>(sender());
+    if (!task || !m_runningTasks.removeOne(task)) {
         return;
     }
 
-    QString inputFile = m_currentTask->getInputFile();
-    QString outputFile = m_currentTask->getOutputFile();
+    QString inputFile = task->getInputFile();
+    QString outputFile = task->getOutputFile();
+    const QStringList extraOutputs = task->extraOutputs();
 
     if (success) {
+        QString written = QFileInfo(outputFile).fileName();
+        for (const QString &extra : extraOutputs) {
+            written += ", " + QFileInfo(extra).fileName();
+        }
         emit logMessage(QString("✓ Successfully processed: %1 -> %2")
                             .arg(QFileInfo(inputFile).fileName())
-                            .arg(QFileInfo(outputFile).fileName()));
+                            .arg(written));
     } else {
         // This is a critical error that should be logged as ERROR level
         emit logMessage(QString("[ERROR] ✗ Failed to process: %1 - %2")
@@ -184,27 +1201,73 @@ void FileProcessor::onTaskFinished(bool success, const QString &message)
                             .arg(message));
     }
 
+    if (!success && !m_overwrite) {
+        // Names are claimed with an empty file at spawn; do not leave those behind
+        for (const QString &output : QStringList{outputFile} + extraOutputs) {
+            const QFileInfo info(output);
+            if (info.exists() && info.size() == 0) {
+                QFile::remove(output);
+            }
+        }
+    }
+
     emit fileProcessed(inputFile, success);
 
-    m_currentTask->deleteLater();
-    m_currentTask = nullptr;
+    JobTiming timing = task->timing();
+    timing.success = success;
+    m_metrics.addJob(timing);
+    emit metricsUpdated(m_metrics);
+
+    if (m_throughputTimer->isActive()) {
+        traceJob(task, m_taskSlots.value(task), success, message);
+    }
+    m_taskSlots.remove(task);
+    m_completedReadBytes += timing.bytesRead;
+
+    const JobCost cost = m_taskCosts.take(task);
+    m_completedWork += cost.estimatedSeconds;
+    m_cpuInUse = qMax(0.0, m_cpuInUse - cost.cpuCores);
+    m_memoryInUse = qMax<qint64>(0, m_memoryInUse - cost.memoryBytes);
+    if (success && timing.spawnMs >= 0 && timing.postEndMs > timing.spawnMs) {
+        m_costModel.record(cost, (timing.postEndMs - timing.spawnMs) / 1000.0);
+    }
+
+    m_inputBytesDropped += task->inputBytesDropped();
+    m_outputBytesWrittenBack += task->outputBytesWrittenBack();
+
+    const int index = m_taskIndex.take(task);
+    task->deleteLater();
     m_currentIndex++;
 
+    if (m_duplicatesOf.contains(index)) {
+        resolveDuplicates(index, success, QStringList{outputFile} + extraOutputs);
+    }
+
+    // The later chunks of a join share the job's result
+    for (int chunk : m_joinedInto.take(index)) {
+        m_progressBoard.publish(chunk, success ? ProgressBoard::Succeeded : ProgressBoard::Failed, 1.0);
+        m_currentIndex++;
+        emit fileProcessed(m_files.at(chunk), success);
+    }
+
     if (m_processing) {
         processNextFile();
     }
 }
 
 QStringList FileProcessor::buildFFmpegCommand(const QString &inputFile, const QString &outputFile,
-                                              const QString &format, const MediaInfo &mediaInfo)
+                                              const QString &format, const MediaInfo &mediaInfo,
+                                              const QStringList &extraOutputs, const Extraction *source) const
 {
     // CRITICAL PATH: Build FFmpeg command with proper codec and format settings
     QStringList args;
 
     args << "-fflags" << "+genpts";
 
-    // Only specify -framerate when duration is unknown (likely raw streams)
-    if (mediaInfo.duration.isEmpty() || mediaInfo.duration.compare("Unknown", Qt::CaseInsensitive) == 0) {
+    // Only specify -framerate for raw streams (the NAL index fills in their
+    // duration, so check the flag too) or when the duration is unknown
+    if (mediaInfo.isRawStream || mediaInfo.duration.isEmpty()
+        || mediaInfo.duration.compare("Unknown", Qt::CaseInsensitive) == 0) {
         auto normalizeFpsStr = [](const QString &s) -> QString {
             QString text = s;
             QString src = text;
@@ -228,17 +1291,20 @@ QStringList FileProcessor::buildFFmpegCommand(const QString &inputFile, const QS
         args << "-framerate" << frameRate;
     }
 
-    args << "-i" << QDir::toNativeSeparators(inputFile);
-
-    // Determine if AV1 film grain is enabled
-    bool enableFilmGrain = false; int filmGrainValue = 0;
-    {
-        QSettings settings; // Use same scope as UI
-        enableFilmGrain = settings.value("filmgrainEnabled", false).toBool();
-        filmGrainValue = settings.value("filmgrainValue", 25).toInt();
-        if (filmGrainValue < 0) filmGrainValue = 0; if (filmGrainValue > 50) filmGrainValue = 50;
+    if (source) {
+        args << source->inputArgs << "-i" << source->input << source->outputArgs;
+    } else if (mediaInfo.hasRange()) {
+        // Only the requested section is read: seek before -i, or a byte range of a raw stream
+        const Extraction extraction = planExtraction(inputFile, mediaInfo);
+        args << extraction.inputArgs << "-i" << extraction.input << extraction.outputArgs;
+    } else {
+        args << "-i" << QDir::toNativeSeparators(inputFile);
     }
 
+    // AV1 film grain settings, read once per batch in configure()
+    const bool enableFilmGrain = m_filmGrainEnabled;
+    const int filmGrainValue = m_filmGrainValue;
+
     bool isAv1 = mediaInfo.videoCodec.contains("AV1", Qt::CaseInsensitive);
 
     if (enableFilmGrain && isAv1) {
@@ -252,6 +1318,10 @@ QStringList FileProcessor::buildFFmpegCommand(const QString &inputFile, const QS
         QString pixelFormat = parsePixelFormat(mediaInfo);
         args << "-pix_fmt" << pixelFormat;
         args << "-svtav1-params" << QString("film-grain=%1").arg(filmGrainValue);
+        if (!extraOutputs.isEmpty()) {
+            // The encoder's headers must go to every container, not into the stream
+            args << "-flags" << "+global_header";
+        }
     } else {
         // Default: stream copy for video
         args << "-c:v" << "copy";
@@ -261,10 +1331,13 @@ QStringList FileProcessor::buildFFmpegCommand(const QString &inputFile, const QS
         args << "-y";
     }
 
-    if (format.toLower() == "mp4") {
+    // With extra formats the tee muxer takes the per-container options instead
+    const bool fanOut = !extraOutputs.isEmpty();
+    args << streamMapping(mediaInfo, format, fanOut);
+    if (!fanOut && format.toLower() == "mp4") {
         args << "-f" << "mp4";
         args << "-movflags" << "faststart";
-    } else if (format.toLower() == "mkv") {
+    } else if (!fanOut && format.toLower() == "mkv") {
         args << "-f" << "matroska";
     }
 
@@ -275,19 +1348,297 @@ QStringList FileProcessor::buildFFmpegCommand(const QString &inputFile, const QS
         QString matrix = mediaInfo.colorSpaceCode.isEmpty() ? "bt2020nc" : mediaInfo.colorSpaceCode;
         QString trc = (mediaInfo.hdrEotf == "HLG") ? "arib-std-b67" : "smpte2084"; // PQ default otherwise
         args << "-fps_mode" << "vfr"; // keep as in requirement example
-        if (format.toLower() == "mp4") {
+        if (format.toLower() == "mp4" && !fanOut) {
             args << "-movflags" << "faststart";
         }
         args << "-color_primaries" << primaries;
         args << "-color_trc" << trc;
         args << "-colorspace" << matrix;
+
+        // The same values in the VUI, so decoders that ignore the container agree
+        const NalIndex::Codec codec = NalIndex::codecFromName(mediaInfo.videoCodec);
+        if (m_writeHdrMetadata && !(enableFilmGrain && isAv1) && codec != NalIndex::Codec::Unknown) {
+            const int primariesValue = colourCode(primaries);
+            const int trcValue = colourCode(trc);
+            const int matrixValue = colourCode(matrix);
+            if (primariesValue > 0 && trcValue > 0 && matrixValue > 0) {
+                args << "-bsf:v" << QString("%1=colour_primaries=%2:transfer_characteristics=%3:matrix_coefficients=%4")
+                                        .arg(codec == NalIndex::Codec::H265 ? "hevc_metadata" : "h264_metadata")
+                                        .arg(primariesValue).arg(trcValue).arg(matrixValue);
+            }
+        }
     }
 
-    args << QDir::toNativeSeparators(outputFile);
+    if (fanOut) {
+        // One demux (and encode) pass feeds every container
+        QStringList outputs;
+        outputs << teeOutputSpec(outputFile);
+        for (const QString &extra : extraOutputs) {
+            outputs << teeOutputSpec(extra);
+        }
+        args << "-f" << "tee" << outputs.join('|');
+    } else {
+        args << QDir::toNativeSeparators(outputFile);
+    }
+
+    return args;
+}
+
+QStringList FileProcessor::streamMapping(const MediaInfo &mediaInfo, const QString &format, bool fanOut) const
+{
+    static const QSet<QString> textSubtitles{"subrip", "srt", "ass", "ssa", "webvtt", "mov_text", "text"};
 
+    if (mediaInfo.streams.isEmpty()) {
+        // Not probed (or a loaded plan's defaults); tee still needs explicit streams,
+        // these match ffmpeg's default selection
+        return fanOut ? QStringList{"-map", "0:v:0", "-map", "0:a:0?"} : QStringList();
+    }
+
+    // ffmpeg keeps one video, one audio and one subtitle stream by default. Every
+    // audio track is kept instead, and the subtitles and attachments the container
+    // can hold; a tee's containers may differ, so it gets audio only.
+    const QString container = format.toLower();
+    const bool matroska = container == "mkv";
+    QString video;                  // first real video stream; cover art is not it
+    QStringList audio, subtitles, attachments;
+    QStringList subtitleCodecs;     // per mapped subtitle, "copy" or the text encoder
+    for (const StreamInfo &stream : mediaInfo.streams) {
+        const QString input = QString("0:%1").arg(stream.index);
+        if (stream.type == StreamInfo::Video) {
+            if (video.isEmpty() && !stream.attachedPic) {
+                video = input;
+            }
+        } else if (stream.type == StreamInfo::Audio) {
+            audio << input;
+        } else if (stream.type == StreamInfo::Subtitle && !fanOut) {
+            const bool text = textSubtitles.contains(stream.codec);
+            if (matroska) {
+                subtitles << input;
+                subtitleCodecs << (stream.codec == "mov_text" ? "srt" : "copy");
+            } else if (text && (container == "mp4" || container == "mov")) {
+                subtitles << input;
+                subtitleCodecs << "mov_text";
+            } else if (text && container == "webm") {
+                subtitles << input;
+                subtitleCodecs << "webvtt";
+            }
+        } else if (stream.type == StreamInfo::Attachment && matroska && !fanOut) {
+            attachments << input;   // fonts of ASS subtitles, cover images
+        }
+    }
+    if (!fanOut && audio.size() <= 1 && subtitles.size() <= 1 && attachments.isEmpty()) {
+        return QStringList();
+    }
+
+    QStringList args;
+    if (!video.isEmpty()) {
+        args << "-map" << video;    // audio-only inputs have none
+    }
+    for (const QString &input : audio + subtitles + attachments) {
+        args << "-map" << input;
+    }
+    if (!subtitleCodecs.isEmpty() && subtitleCodecs.count(subtitleCodecs.first()) == subtitleCodecs.size()) {
+        args << "-c:s" << subtitleCodecs.first();
+    } else {
+        for (int i = 0; i < subtitleCodecs.size(); ++i) {
+            args << QString("-c:s:%1").arg(i) << subtitleCodecs.at(i);
+        }
+    }
+    if (!attachments.isEmpty()) {
+        args << "-c:t" << "copy";
+    }
     return args;
 }
 
+HdrMetadata FileProcessor::plannedHdrMetadata(const QString &inputFile, const MediaInfo &mediaInfo,
+                                              NalIndex::Codec *codec, QStringList *notes) const
+{
+    if (!m_writeHdrMetadata || m_processingMode == "binToYuv") {
+        return HdrMetadata();
+    }
+    HdrMetadata hdr = mediaInfo.hdrMetadata;
+    hdr.overrideWith(m_hdrOverride);
+    if (hdr.isEmpty()) {
+        return hdr;                 // nothing in the source and nothing supplied
+    }
+
+    *codec = mediaInfo.nalIndex ? mediaInfo.nalIndex->codec() : NalIndex::codecFromName(mediaInfo.videoCodec);
+    const QString fileName = QFileInfo(inputFile).fileName();
+    if (!mediaInfo.isRawStream || *codec == NalIndex::Codec::Unknown) {
+        // Rewriting a container's stream would need a demux in between; the VUI and
+        // container colour flags are still set for HDR inputs
+        *notes << QString("[WARN] %1: HDR metadata SEI is only rewritten in raw H.264/H.265 streams; "
+                          "the container's own metadata is copied as is").arg(fileName);
+        return HdrMetadata();
+    }
+    if (mediaInfo.hasRange() && !mediaInfo.nalIndex) {
+        *notes << QString("[WARN] %1: the section is cut by time, not bytes; HDR metadata SEI not written")
+                      .arg(fileName);
+        return HdrMetadata();
+    }
+    return hdr;
+}
+
+QHash<int, QList<int>> FileProcessor::planJoins(const QList<QStringList> &joinGroups, QStringList *notes) const
+{
+    QHash<int, QList<int>> joins;
+    if (m_processingMode == "binToYuv") {
+        return joins;
+    }
+
+    QHash<QString, int> indexOf;
+    for (int i = 0; i < m_files.size(); ++i) {
+        indexOf.insert(m_files.at(i), i);
+    }
+    QSet<int> claimed;
+    for (const QStringList &group : joinGroups) {
+        QList<int> indexes;
+        QStringList files;
+        for (const QString &file : group) {
+            const int index = indexOf.value(file, -1);
+            if (index >= 0 && !claimed.contains(index) && !indexes.contains(index)) {
+                indexes << index;
+                files << file;
+            }
+        }
+        if (indexes.size() < 2) {
+            continue;
+        }
+
+        // The chunks are concatenated as bytes, so they must be raw streams that
+        // one decoder configuration can read from start to end
+        QString problem;
+        for (int index : std::as_const(indexes)) {
+            const MediaInfo info = m_mediaInfos.value(index);
+            const QString name = QFileInfo(m_files.at(index)).fileName();
+            if (!info.isRawStream) {
+                problem = name + " is not a raw H.264/H.265 stream";
+            } else if (info.hasRange()) {
+                problem = name + " has an in/out range";
+            } else if (m_files.at(index).contains('|')) {
+                problem = name + ": '|' in the path cannot be passed to the concat protocol";
+            }
+            if (!problem.isEmpty()) {
+                break;
+            }
+        }
+        SpsInfo sps;
+        if (problem.isEmpty()) {
+            StreamJoin::checkConsistency(files, &sps, &problem);
+        }
+        const QString groupName = StreamJoin::joinedBaseName(files);
+        if (!problem.isEmpty()) {
+            *notes << QString("[ERROR] Cannot join the %1 chunks of %2: %3. Processing them separately.")
+                          .arg(files.size()).arg(groupName, problem);
+            continue;
+        }
+
+        joins.insert(indexes.first(), indexes.mid(1));
+        for (int index : std::as_const(indexes)) {
+            claimed.insert(index);
+        }
+        *notes << QString("Joining %1 chunks of %2 (%3)").arg(files.size()).arg(groupName, sps.describe());
+    }
+    return joins;
+}
+
+FileProcessor::Extraction FileProcessor::planJoin(const QList<int> &indexes) const
+{
+    Extraction extraction;
+    const int index = indexes.first();
+
+    QStringList urls;
+    qint64 frames = 0;
+    qint64 bytes = 0;
+    for (int chunk : std::as_const(indexes)) {
+        const qint64 size = QFileInfo(m_files.at(chunk)).size();
+        urls << QDir::toNativeSeparators(m_files.at(chunk));
+        extraction.segments << SeiInjector::Segment{m_files.at(chunk), 0, size};
+        bytes += size;
+        const qint64 chunkFrames = m_mediaInfos.value(chunk).frameCount;
+        frames = (frames < 0 || chunkFrames < 0) ? -1 : frames + chunkFrames;
+    }
+
+    // The demuxer sees one elementary stream, so the timestamps generated from
+    // -framerate run on across chunk boundaries
+    const MediaInfo mediaInfo = m_mediaInfos.value(index);
+    NalIndex::Codec codec = mediaInfo.nalIndex ? mediaInfo.nalIndex->codec() : NalIndex::codecFromName(mediaInfo.videoCodec);
+    if (codec == NalIndex::Codec::Unknown) {
+        codec = NalIndex::codecFromExtension(m_files.at(index));
+    }
+    if (codec != NalIndex::Codec::Unknown) {
+        extraction.inputArgs << "-f" << (codec == NalIndex::Codec::H265 ? "hevc" : "h264");
+    }
+    extraction.input = "concat:" + urls.join('|');
+    extraction.inputBytes = bytes;
+    extraction.frames = frames;
+    const double fps = frameRateOf(mediaInfo);
+    if (frames >= 0 && fps > 0.0) {
+        extraction.durationMs = qint64(frames * 1000.0 / fps);
+    }
+    extraction.description = QString("%1 chunks, %2 frames, %3 MB")
+                                 .arg(indexes.size())
+                                 .arg(frames >= 0 ? QString::number(frames) : QString("unknown"))
+                                 .arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+    return extraction;
+}
+
+FileProcessor::Extraction FileProcessor::planExtraction(const QString &inputFile, const MediaInfo &mediaInfo) const
+{
+    Extraction extraction;
+    const double inPoint = qMax(0.0, mediaInfo.inPoint);
+    const double outPoint = (mediaInfo.outPoint > inPoint) ? mediaInfo.outPoint : -1.0;
+    const double fps = frameRateOf(mediaInfo);
+
+    if (mediaInfo.nalIndex && fps > 0.0) {
+        // Raw stream: cut at access-unit boundaries from the index. Stream copy starts
+        // at the keyframe before inPoint; ffmpeg reads nothing outside the range.
+        const NalIndex &index = *mediaInfo.nalIndex;
+        const qint64 inFrame = qint64(std::floor(inPoint * fps));
+        const qint64 outFrame = (outPoint > 0.0) ? qint64(std::ceil(outPoint * fps)) : -1;
+        const NalIndex::ByteRange range = index.rangeForFrames(inFrame, outFrame, QFileInfo(inputFile).size());
+
+        QString input = subfileUrl(inputFile, range.begin, range.end);
+        extraction.inputBytes = range.end - range.begin;
+        if (range.needsHeader) {
+            // Parameter sets only appear at the head of the stream
+            input = "concat:" + subfileUrl(inputFile, 0, index.headerBytes()) + "|" + input;
+            extraction.inputBytes += index.headerBytes();
+            extraction.segments << SeiInjector::Segment{inputFile, 0, index.headerBytes()};
+        }
+        extraction.segments << SeiInjector::Segment{inputFile, range.begin, range.end};
+        extraction.inputArgs << "-f" << (index.codec() == NalIndex::Codec::H265 ? "hevc" : "h264");
+        extraction.input = input;
+        extraction.frames = range.frames();
+        extraction.durationMs = qint64(range.frames() * 1000.0 / fps);
+        extraction.description = QString("frames %1-%2 from keyframe %3, bytes %4-%5 (%6 MB)")
+                                     .arg(inFrame).arg(range.endFrame - 1).arg(range.firstFrame)
+                                     .arg(range.begin).arg(range.end)
+                                     .arg(extraction.inputBytes / (1024.0 * 1024.0), 0, 'f', 1);
+        return extraction;
+    }
+
+    // Containers: -ss before -i seeks through the container index to the keyframe
+    // at or before inPoint; -t stops reading at outPoint
+    if (inPoint > 0.0) {
+        extraction.inputArgs << "-ss" << QString::number(inPoint, 'f', 3);
+    }
+    extraction.input = QDir::toNativeSeparators(inputFile);
+    const double total = durationSecondsOf(mediaInfo);
+    if (outPoint > 0.0) {
+        extraction.outputArgs << "-t" << QString::number(outPoint - inPoint, 'f', 3);
+        extraction.durationMs = qint64((outPoint - inPoint) * 1000.0);
+    } else if (total > inPoint) {
+        extraction.durationMs = qint64((total - inPoint) * 1000.0);
+    }
+    if (total > 0.0 && extraction.durationMs > 0) {
+        extraction.inputBytes = qint64(QFileInfo(inputFile).size() * qMin(1.0, extraction.durationMs / (total * 1000.0)));
+    }
+    extraction.description = QString("%1 - %2 (seek before input)")
+                                 .arg(timeTag(inPoint), outPoint > 0.0 ? timeTag(outPoint) : QString("end"));
+    return extraction;
+}
+
 QString FileProcessor::findFFmpegExecutable()
 {
     // CRITICAL PATH: Locate FFmpeg executable - required for all operations
@@ -360,8 +1711,19 @@ void FileProcessor::parseAndLogFFmpegVersion(const QString &versionOutput)
 
 }
 
-QString FileProcessor::generateOutputFilePath(const QString &inputFile, const MediaInfo &mediaInfo)
+QStringList FileProcessor::extraOutputPaths(const QString &inputFile, const MediaInfo &mediaInfo) const
+{
+    QStringList paths;
+    for (const QString &format : std::as_const(m_fanOutFormats)) {
+        paths << generateOutputFilePath(inputFile, mediaInfo, format);
+    }
+    return paths;
+}
+
+QString FileProcessor::generateOutputFilePath(const QString &inputFile, const MediaInfo &mediaInfo,
+                                              const QString &format) const
 {
+    const QString outputFormat = format.isEmpty() ? m_outputFormat : format;
     // CRITICAL PATH: Generate output file paths with proper naming conventions
     QFileInfo inputInfo(inputFile);
     QString outputName;
@@ -386,34 +1748,42 @@ QString FileProcessor::generateOutputFilePath(const QString &inputFile, const Me
         outputName = QString("%1_%2bit_decoded_%3_%4fps_%5.yuv")
                          .arg(baseName).arg(bitDepth).arg(resolution).arg(frameRate).arg(colorFormat);
     } else { // "muxing" mode
-        outputName = inputInfo.completeBaseName() + "_muxed." + m_outputFormat;
+        outputName = inputInfo.completeBaseName() + "_muxed." + outputFormat;
     }
 
-    QString outputFile = QDir(m_outputFolder).absoluteFilePath(outputName);
-
-    if (QFile::exists(outputFile) && !m_overwrite) {
-        int counter = 1;
-        QString baseName = inputInfo.completeBaseName();
-        QString extension = QFileInfo(outputName).suffix();
-        QString basePart = baseName + (m_processingMode == "binToYuv" ? "_decoded" : "_muxed");
-
-        do {
-            outputName = QString("%1_(%2).%3").arg(basePart).arg(counter++).arg(extension);
-            outputFile = QDir(m_outputFolder).absoluteFilePath(outputName);
-        } while (QFile::exists(outputFile));
+    // Sections of the same input must not overwrite each other or the full remux
+    QString rangeTag;
+    if (mediaInfo.hasRange()) {
+        rangeTag = QString("_%1-%2").arg(timeTag(qMax(0.0, mediaInfo.inPoint)),
+                                         mediaInfo.outPoint > 0.0 ? timeTag(mediaInfo.outPoint) : QString("end"));
+        const QFileInfo nameInfo(outputName);
+        outputName = nameInfo.completeBaseName() + rangeTag + "." + nameInfo.suffix();
     }
 
-    return outputFile;
+    // The plain name, else "_(1)", "_(2)", ...: free in the folder's listing and not
+    // reserved by another job of the batch
+    const QString basePart = inputInfo.completeBaseName() + (m_processingMode == "binToYuv" ? "_decoded" : "_muxed")
+        + rangeTag;
+    const QString extension = QFileInfo(outputName).suffix();
+    return m_outputNames->reserve(m_outputFolder, [&](int n) {
+        return n == 0 ? outputName : QString("%1_(%2).%3").arg(basePart).arg(n).arg(extension);
+    });
 }
 
 QStringList FileProcessor::buildBinToYuvCommand(const QString &inputFile, const QString &outputFile,
-                                                const MediaInfo &mediaInfo)
+                                                const MediaInfo &mediaInfo) const
 {
     QStringList args;
     QString detectedFormat = detectVideoFormatFromFileName(QFileInfo(inputFile).fileName());
     QString pixelFormat = parsePixelFormat(mediaInfo);
 
-    args << "-i" << QDir::toNativeSeparators(inputFile);
+    if (mediaInfo.hasRange()) {
+        // Decoding starts at the keyframe before the in point for raw byte ranges
+        const Extraction extraction = planExtraction(inputFile, mediaInfo);
+        args << extraction.inputArgs << "-i" << extraction.input << extraction.outputArgs;
+    } else {
+        args << "-i" << QDir::toNativeSeparators(inputFile);
+    }
     args << "-c:v" << "rawvideo";
     args << "-pix_fmt" << pixelFormat;
     args << "-y";
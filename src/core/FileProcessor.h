@@ -6,8 +6,21 @@
 #include <QQueue>
 #include <QVector>
 #include <QMap>
+#include <QHash>
+#include <QThreadPool>
+#include "IoPolicy.h"
+#include "ProcessPolicy.h"
+#include "BatchMetrics.h"
+#include "CostModel.h"
+#include "ProgressEstimator.h"
+#include "ProgressBoard.h"
+#include "HdrMetadata.h"
+#include "SeiInjector.h"
+#include "BatchPlan.h"
+#include "OutputNameRegistry.h"
 
 class MuxingTask;
+class QTimer;
 struct MediaInfo;
 
 class FileProcessor : public QObject
@@ -18,55 +31,246 @@ public:
     explicit FileProcessor(QObject *parent = nullptr);
     ~FileProcessor();
 
+    // Compiles the batch into a BatchPlan on a worker thread, then runs it
     void processFiles(const QStringList &files, const QString &outputFolder,
                       const QString &format, const QVector<MediaInfo> &mediaInfos,
                       bool overwrite = false, const QString &processingMode = "muxing");
+    // Dry run: compiles the same plan and delivers it through planCompiled() without
+    // starting anything
+    void compilePlan(const QStringList &files, const QString &outputFolder,
+                     const QString &format, const QVector<MediaInfo> &mediaInfos,
+                     bool overwrite = false, const QString &processingMode = "muxing");
+    // Runs a plan as compiled, e.g. one loaded from JSON; the ffmpeg found here
+    // replaces the plan's program
+    void runPlan(const BatchPlanPtr &plan);
+    // Returns at once: queued jobs are dropped, running ones asked to exit and killed
+    // if they have not within a few seconds. finished() is emitted before they exit;
+    // fileCancelled() follows for each as its process ends and its partial outputs
+    // are removed. A batch started meanwhile waits for them.
     void stop();
 
     bool isProcessing() const { return m_processing; }
 
+    // Overrides the ffmpeg found at construction (settings path, then PATH)
+    void setFFmpegPath(const QString &path) { m_ffmpegPath = path; }
+    QString ffmpegPath() const { return m_ffmpegPath; }
+
+    // Number of ffmpeg jobs run at the same time ("processing/maxParallelJobs", default 1)
+    void setMaxParallelJobs(int jobs) { m_maxParallelJobs = qMax(1, jobs); }
+    int maxParallelJobs() const { return m_maxParallelJobs; }
+
+    // Nice level and I/O priority of ffmpeg children. Applies to running jobs at once
+    // and to every job started later in the batch; does not touch the saved settings.
+    void setPriority(int niceLevel, int ioClass, int ioLevel);
+
+    // Duplicate input -> first copy, from FingerprintScanner. With "processing/dedupMode"
+    // set to "hardlink" or "reflink", duplicates are not processed; their output links
+    // to the first copy's output once that succeeds.
+    void setDuplicateLeaders(const QHash<QString, QString> &leaders) { m_duplicateLeaders = leaders; }
+
+    // Containers written in addition to the batch format ("mkv", "ts", ...). Each
+    // job then demuxes its input once and writes every container through ffmpeg's
+    // tee muxer. Ignored in binToYuv mode.
+    void setExtraFormats(const QStringList &formats) { m_extraFormats = formats; }
+
+    // Chunks of segmented raw streams, each group in playback order. A group is muxed
+    // by one job into one output named after the chunks; its SPS are checked first,
+    // and a group that fails the check is processed chunk by chunk. Ignored in
+    // binToYuv mode.
+    void setJoinGroups(const QList<QStringList> &groups) { m_joinGroups = groups; }
+
+    // Per-file progress of the current batch, indexed like the files passed to
+    // processFiles(); sample it on a timer rather than per update. Safe to read from
+    // another thread between batchStarted() and finished().
+    const ProgressBoard &progressBoard() const { return m_progressBoard; }
+
+    // Phase timings of the current (or last) batch; only on the processor's thread,
+    // other threads get copies through metricsUpdated()
+    const BatchMetrics &metrics() const { return m_metrics; }
+
 signals:
     void progress(int current, int total, const QString &currentFile);
+    // The progress board has been laid out for the batch and its jobs start now
+    void batchStarted();
     void finished();
     void logMessage(const QString &message);
     void error(const QString &message);
     void fileProcessed(const QString &inputFile, bool success);
+    void fileCancelled(const QString &inputFile);
+    void metricsUpdated(const BatchMetrics &metrics);
+    // Work-weighted batch progress (0..1) and ETA with its band, about once a second;
+    // ETAs are -1 while unknown
+    void overallProgress(double fraction, qint64 etaMs, qint64 etaLowMs, qint64 etaHighMs);
+    // Every compiled plan, dry run or not, before any of its jobs starts
+    void planCompiled(const BatchPlanPtr &plan);
 
 private slots:
     void processNextFile();
     void onTaskFinished(bool success, const QString &message);
+    void onTaskCancelled();
+    void sampleThroughput();
+    void updateOverallProgress();
 
 private:
 
-    QString detectVideoFormatFromFileName(const QString &fileName);
+    QString detectVideoFormatFromFileName(const QString &fileName) const;
     QString parsePixelFormat(const MediaInfo &mediaInfo) const;
-    QString generateOutputFilePath(const QString &inputFile, const MediaInfo &mediaInfo);
+    // format defaults to the batch format
+    QString generateOutputFilePath(const QString &inputFile, const MediaInfo &mediaInfo,
+                                   const QString &format = QString()) const;
+    QStringList extraOutputPaths(const QString &inputFile, const MediaInfo &mediaInfo) const;
+
+    // How a row's in/out range (or a joined group) is read: options before -i, the
+    // input URL and options after it. frames/durationMs size the job for progress and cost.
+    struct Extraction {
+        QStringList inputArgs;
+        QString input;
+        QStringList outputArgs;
+        qint64 frames = -1;
+        qint64 durationMs = -1;
+        qint64 inputBytes = -1;     // bytes actually read, -1 if unknown
+        QString description;
+        QList<SeiInjector::Segment> segments;   // raw stream bytes read, in order; empty for containers
+    };
+    Extraction planExtraction(const QString &inputFile, const MediaInfo &mediaInfo) const;
+    // Every chunk of a group, first chunk first, through the concat protocol
+    Extraction planJoin(const QList<int> &indexes) const;
+    // First chunk's index -> the later chunks, for the groups that pass the SPS check
+    QHash<int, QList<int>> planJoins(const QList<QStringList> &joinGroups, QStringList *notes) const;
+    // HDR static metadata to write into this input's bitstream; empty when off or not possible
+    HdrMetadata plannedHdrMetadata(const QString &inputFile, const MediaInfo &mediaInfo,
+                                   NalIndex::Codec *codec, QStringList *notes) const;
+
+    // Plan compilation. configure() snapshots the batch and its settings; compile()
+    // runs on m_planPool and only reads them. Warnings go to the plan's notes.
+    void configure(const QStringList &files, const QString &outputFolder,
+                   const QString &format, const QVector<MediaInfo> &mediaInfos,
+                   bool overwrite, const QString &processingMode);
+    void startCompile(bool run);
+    void onPlanCompiled(const BatchPlanPtr &plan, quint64 generation, bool run);
+    BatchPlan compile(const QList<QStringList> &joinGroups, const QHash<QString, QString> &duplicateLeaders,
+                      const QString &program) const;
+    PlannedJob planJob(int index, const QList<int> &chunks, QStringList *notes) const;
+    void startPlan(const BatchPlanPtr &plan);
 
+    // source overrides how the input is read (a range or a join)
     QStringList buildFFmpegCommand(const QString &inputFile, const QString &outputFile,
-                                   const QString &format, const MediaInfo &mediaInfo);
+                                   const QString &format, const MediaInfo &mediaInfo,
+                                   const QStringList &extraOutputs = QStringList(),
+                                   const Extraction *source = nullptr) const;
+    // -map/-c options from the stream table; empty when ffmpeg's default selection keeps everything
+    QStringList streamMapping(const MediaInfo &mediaInfo, const QString &format, bool fanOut) const;
     QStringList buildBinToYuvCommand(const QString &inputFile, const QString &outputFile,
-                                     const MediaInfo &mediaInfo);
+                                     const MediaInfo &mediaInfo) const;
 
 
+    void prefetchQueuedInputs();
+    int nextAdmissibleTask() const;
+    void balanceThreads();
+    void claimOutputs(MuxingTask *task);
+    MuxingTask *createTask(const PlannedJob &job);
+    QStringList jobFiles(int index) const;     // input files of a job's rows
+    void resolveDuplicates(int leaderIndex, bool leaderSucceeded, const QStringList &leaderOutputs);
+    bool linkOutput(const QString &source, const QString &target, QString *method, QString *error) const;
+    void finishMetrics();
+    void traceJob(MuxingTask *task, int slot, bool success, const QString &message);
+    void traceQueueDepth();
+
     QString findFFmpegExecutable();
     void parseAndLogFFmpegVersion(const QString &versionOutput);
 
 
     QQueue<MuxingTask*> m_taskQueue;
-    MuxingTask *m_currentTask;
+    QList<MuxingTask*> m_runningTasks;
+    int m_maxParallelJobs;
 
     QStringList m_files;
     QString m_outputFolder;
     QString m_outputFormat;
+    QStringList m_extraFormats;     // as requested
+    QStringList m_fanOutFormats;    // in effect for the current batch
     QVector<MediaInfo> m_mediaInfos;
     bool m_overwrite;
     bool m_processing;
     QString m_processingMode;
 
-    int m_currentIndex;
+    int m_currentIndex;          // jobs completed in this batch
+    int m_startedCount;
     int m_totalFiles;
 
     QString m_ffmpegPath;
+
+    // Page-cache management for the batch
+    IoPolicy::Settings m_ioSettings;
+    ProcessPolicy::Settings m_processSettings;
+    qint64 m_inputBytesDropped;
+    qint64 m_outputBytesWrittenBack;
+
+    // Inputs whose head was prefetched and not yet consumed (path -> bytes)
+    QHash<QString, qint64> m_prefetched;
+    qint64 m_prefetchOutstanding;
+
+    BatchMetrics m_metrics;
+
+    // Cost-aware scheduling: estimates per task, and the CPU/memory the running tasks hold
+    CostModel m_costModel;
+    QHash<MuxingTask*, JobCost> m_taskCosts;
+    double m_cpuBudget;
+    double m_cpuInUse;
+    qint64 m_memoryBudget;
+    qint64 m_memoryInUse;
+    bool m_threadBudget;        // decodes and re-encodes hold their thread count as cpuCores
+
+    ProgressBoard m_progressBoard;
+
+    // Duplicate inputs handled by linking to their first copy's output
+    QHash<QString, QString> m_duplicateLeaders;
+    QString m_dedupMode;
+    QHash<int, QList<int>> m_duplicatesOf;      // leader index -> duplicate indexes
+    QHash<int, PlannedJob> m_linkedJobs;        // duplicate index -> its job if the leader fails
+    QHash<MuxingTask*, int> m_taskIndex;        // task -> index in m_files
+
+    // Jobs of a stopped batch that are still exiting -> the files of their rows,
+    // and a plan waiting for them so it cannot race their output cleanup
+    QHash<MuxingTask*, QStringList> m_cancellingTasks;
+    BatchPlanPtr m_deferredPlan;
+
+    // Segmented streams muxed as one: first chunk's index -> the later chunks
+    QList<QStringList> m_joinGroups;            // as requested, checked when compiling
+    QHash<int, QList<int>> m_joinedInto;        // of the running plan
+
+    // HDR static metadata rewrite ("hdr/writeMetadata"), and the user's values
+    // ("hdr/masterDisplay", "hdr/maxCll") that replace the source's
+    bool m_writeHdrMetadata;
+    HdrMetadata m_hdrOverride;
+
+    // Settings read once per batch in configure() instead of per file
+    bool m_filmGrainEnabled;
+    int m_filmGrainValue;
+    bool m_longestFirst;
+
+    // Plan compilation off the UI thread; a result whose generation is stale is dropped
+    QThreadPool m_planPool;
+    quint64 m_planGeneration;
+    bool m_compiling;           // processFiles() waits for its plan
+    BatchPlanPtr m_plan;        // the running (or last) plan
+
+    // Output names of the batch: chosen when compiling, claimed on disk at spawn
+    QSharedPointer<OutputNameRegistry> m_outputNames;
+
+    // Overall progress in estimated job-seconds, for the ETA
+    ProgressEstimator m_progressEstimator;
+    QTimer *m_progressTimer;
+    double m_completedWork;
+    qint64 m_lastEtaLogMs;
+    qint64 m_etaLogIntervalMs;  // "processing/etaLogIntervalSec", 0 = no log lines
+
+    // Trace timeline: worker slot of each running task, and the MB/s counter state
+    QHash<MuxingTask*, int> m_taskSlots;
+    QTimer *m_throughputTimer;
+    qint64 m_completedReadBytes;
+    qint64 m_lastSampledBytes;
+    qint64 m_lastSampleMs;
 };
 
 #endif // FILEPROCESSOR_H
@@ -0,0 +1,346 @@
+#include "HdrMetadata.h"
+#include "StartCodeScanner.h"
+#include <QFile>
+#include <QRegularExpression>
+#include <QVector>
+#include <algorithm>
+
+namespace {
+
+constexpr int MasteringDisplayPayload = 137;
+constexpr int ContentLightPayload = 144;
+
+QByteArray unescape(const uchar *data, qint64 size)
+{
+    QByteArray rbsp;
+    rbsp.reserve(int(size));
+    int zeros = 0;
+    for (qint64 i = 0; i < size; ++i) {
+        if (zeros >= 2 && data[i] == 0x03) {
+            zeros = 0;                      // emulation prevention byte
+            continue;
+        }
+        zeros = (data[i] == 0) ? zeros + 1 : 0;
+        rbsp.append(char(data[i]));
+    }
+    return rbsp;
+}
+
+void appendEscaped(QByteArray *nal, const QByteArray &rbsp)
+{
+    int zeros = 0;
+    for (char c : rbsp) {
+        const uchar byte = uchar(c);
+        if (zeros >= 2 && byte <= 0x03) {
+            nal->append(char(0x03));
+            zeros = 0;
+        }
+        zeros = (byte == 0) ? zeros + 1 : 0;
+        nal->append(c);
+    }
+}
+
+quint32 readBig(const uchar *p, int bytes)
+{
+    quint32 value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+void appendBig(QByteArray *out, quint32 value, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; --i) {
+        out->append(char((value >> (8 * i)) & 0xff));
+    }
+}
+
+// SEI payload type and size: 0xff bytes adding 255 each, then the remainder
+void appendSeiNumber(QByteArray *out, int value)
+{
+    for (; value >= 255; value -= 255) {
+        out->append(char(0xff));
+    }
+    out->append(char(value));
+}
+
+struct SeiMessage {
+    int type = 0;
+    const uchar *begin = nullptr;           // first byte of the type field
+    const uchar *payload = nullptr;
+    int size = 0;
+};
+
+// Payload of an SEI NAL unit without header, emulation prevention or trailing zeros
+QByteArray seiRbsp(const uchar *nal, qint64 size, NalIndex::Codec codec)
+{
+    const int headerBytes = (codec == NalIndex::Codec::H265) ? 2 : 1;
+    if (size <= headerBytes) {
+        return QByteArray();
+    }
+    QByteArray rbsp = unescape(nal + headerBytes, size - headerBytes);
+    while (rbsp.endsWith('\0')) {
+        rbsp.chop(1);                       // zero byte of a following four-byte start code
+    }
+    return rbsp;
+}
+
+// sei_message()s up to rbsp_trailing_bits; stops at the first truncated one
+QVector<SeiMessage> seiMessages(const QByteArray &rbsp)
+{
+    QVector<SeiMessage> messages;
+    const uchar *p = reinterpret_cast<const uchar *>(rbsp.constData());
+    const uchar *end = p + rbsp.size();
+    while (end - p > 1 || (end - p == 1 && *p != 0x80)) {
+        SeiMessage message;
+        message.begin = p;
+        while (p < end && *p == 0xff) {
+            message.type += 255;
+            ++p;
+        }
+        if (p >= end) {
+            break;
+        }
+        message.type += *p++;
+        while (p < end && *p == 0xff) {
+            message.size += 255;
+            ++p;
+        }
+        if (p >= end) {
+            break;
+        }
+        message.size += *p++;
+        if (message.size > end - p) {
+            break;
+        }
+        message.payload = p;
+        messages.append(message);
+        p += message.size;
+    }
+    return messages;
+}
+
+} // namespace
+
+void HdrMetadata::overrideWith(const HdrMetadata &other)
+{
+    if (other.hasMasteringDisplay) {
+        hasMasteringDisplay = true;
+        std::copy(&other.primaries[0][0], &other.primaries[0][0] + 6, &primaries[0][0]);
+        whitePoint[0] = other.whitePoint[0];
+        whitePoint[1] = other.whitePoint[1];
+        maxLuminance = other.maxLuminance;
+        minLuminance = other.minLuminance;
+    }
+    if (other.hasContentLight) {
+        hasContentLight = true;
+        maxCll = other.maxCll;
+        maxFall = other.maxFall;
+    }
+}
+
+QString HdrMetadata::masterDisplayString() const
+{
+    if (!hasMasteringDisplay) {
+        return QString();
+    }
+    return QString("G(%1,%2)B(%3,%4)R(%5,%6)WP(%7,%8)L(%9,%10)")
+        .arg(primaries[0][0]).arg(primaries[0][1])
+        .arg(primaries[1][0]).arg(primaries[1][1])
+        .arg(primaries[2][0]).arg(primaries[2][1])
+        .arg(whitePoint[0]).arg(whitePoint[1])
+        .arg(maxLuminance).arg(minLuminance);
+}
+
+bool HdrMetadata::setMasterDisplay(const QString &text)
+{
+    static const QRegularExpression pattern(
+        R"(^\s*G\((\d+),(\d+)\)\s*B\((\d+),(\d+)\)\s*R\((\d+),(\d+)\)\s*WP\((\d+),(\d+)\)\s*L\((\d+),(\d+)\)\s*$)",
+        QRegularExpression::CaseInsensitiveOption);
+    const QRegularExpressionMatch match = pattern.match(text);
+    if (!match.hasMatch()) {
+        return false;
+    }
+    quint64 values[10];
+    for (int i = 0; i < 10; ++i) {
+        values[i] = match.captured(i + 1).toULongLong();
+        if (values[i] > (i < 8 ? 50000u : 0xffffffffu)) {
+            return false;
+        }
+    }
+    for (int c = 0; c < 3; ++c) {
+        primaries[c][0] = quint16(values[2 * c]);
+        primaries[c][1] = quint16(values[2 * c + 1]);
+    }
+    whitePoint[0] = quint16(values[6]);
+    whitePoint[1] = quint16(values[7]);
+    maxLuminance = quint32(values[8]);
+    minLuminance = quint32(values[9]);
+    hasMasteringDisplay = maxLuminance > minLuminance;
+    return hasMasteringDisplay;
+}
+
+QString HdrMetadata::maxCllString() const
+{
+    return hasContentLight ? QString("%1,%2").arg(maxCll).arg(maxFall) : QString();
+}
+
+bool HdrMetadata::setMaxCll(const QString &text)
+{
+    const QStringList parts = text.split(',');
+    if (parts.size() != 2) {
+        return false;
+    }
+    bool okCll = false;
+    bool okFall = false;
+    const uint cll = parts.at(0).trimmed().toUInt(&okCll);
+    const uint fall = parts.at(1).trimmed().toUInt(&okFall);
+    if (!okCll || !okFall || cll > 0xffff || fall > 0xffff) {
+        return false;
+    }
+    maxCll = quint16(cll);
+    maxFall = quint16(fall);
+    hasContentLight = true;
+    return true;
+}
+
+QString HdrMetadata::describe() const
+{
+    QStringList parts;
+    if (hasMasteringDisplay) {
+        parts << QString("mastering %1-%2 cd/m²")
+                     .arg(minLuminance / 10000.0, 0, 'g', 4)
+                     .arg(maxLuminance / 10000.0, 0, 'g', 5);
+    }
+    if (hasContentLight) {
+        parts << QString("MaxCLL %1, MaxFALL %2").arg(maxCll).arg(maxFall);
+    }
+    return parts.isEmpty() ? QString("none") : parts.join(", ");
+}
+
+bool HdrMetadata::isSeiNal(const uchar *nal, NalIndex::Codec codec)
+{
+    return (codec == NalIndex::Codec::H265) ? ((nal[0] >> 1) & 0x3f) == 39 : (nal[0] & 0x1f) == 6;
+}
+
+bool HdrMetadata::readSei(const uchar *nal, qint64 size, NalIndex::Codec codec)
+{
+    if (!isSeiNal(nal, codec)) {
+        return false;
+    }
+    bool found = false;
+    const QByteArray rbsp = seiRbsp(nal, size, codec);
+    for (const SeiMessage &message : seiMessages(rbsp)) {
+        const uchar *p = message.payload;
+        if (message.type == MasteringDisplayPayload && message.size >= 24) {
+            for (int c = 0; c < 3; ++c) {
+                primaries[c][0] = quint16(readBig(p + 4 * c, 2));
+                primaries[c][1] = quint16(readBig(p + 4 * c + 2, 2));
+            }
+            whitePoint[0] = quint16(readBig(p + 12, 2));
+            whitePoint[1] = quint16(readBig(p + 14, 2));
+            maxLuminance = readBig(p + 16, 4);
+            minLuminance = readBig(p + 20, 4);
+            hasMasteringDisplay = true;
+            found = true;
+        } else if (message.type == ContentLightPayload && message.size >= 4) {
+            maxCll = quint16(readBig(p, 2));
+            maxFall = quint16(readBig(p + 2, 2));
+            hasContentLight = true;
+            found = true;
+        }
+    }
+    return found;
+}
+
+QByteArray HdrMetadata::stripSei(const uchar *nal, qint64 size, NalIndex::Codec codec, bool *changed)
+{
+    *changed = false;
+    if (!isSeiNal(nal, codec)) {
+        return QByteArray(reinterpret_cast<const char *>(nal), int(size));
+    }
+    const QByteArray rbsp = seiRbsp(nal, size, codec);
+    QByteArray kept;
+    for (const SeiMessage &message : seiMessages(rbsp)) {
+        if (message.type == MasteringDisplayPayload || message.type == ContentLightPayload) {
+            *changed = true;
+        } else {
+            kept.append(reinterpret_cast<const char *>(message.begin), int(message.payload + message.size - message.begin));
+        }
+    }
+    if (!*changed) {
+        return QByteArray(reinterpret_cast<const char *>(nal), int(size));
+    }
+    if (kept.isEmpty()) {
+        return QByteArray();
+    }
+    kept.append(char(0x80));                // rbsp_trailing_bits
+    const int headerBytes = (codec == NalIndex::Codec::H265) ? 2 : 1;
+    QByteArray stripped(reinterpret_cast<const char *>(nal), headerBytes);
+    appendEscaped(&stripped, kept);
+    return stripped;
+}
+
+QByteArray HdrMetadata::seiNal(NalIndex::Codec codec) const
+{
+    QByteArray rbsp;
+    if (hasMasteringDisplay) {
+        appendSeiNumber(&rbsp, MasteringDisplayPayload);
+        appendSeiNumber(&rbsp, 24);
+        for (int c = 0; c < 3; ++c) {
+            appendBig(&rbsp, primaries[c][0], 2);
+            appendBig(&rbsp, primaries[c][1], 2);
+        }
+        appendBig(&rbsp, whitePoint[0], 2);
+        appendBig(&rbsp, whitePoint[1], 2);
+        appendBig(&rbsp, maxLuminance, 4);
+        appendBig(&rbsp, minLuminance, 4);
+    }
+    if (hasContentLight) {
+        appendSeiNumber(&rbsp, ContentLightPayload);
+        appendSeiNumber(&rbsp, 4);
+        appendBig(&rbsp, maxCll, 2);
+        appendBig(&rbsp, maxFall, 2);
+    }
+    rbsp.append(char(0x80));                // rbsp_trailing_bits
+
+    QByteArray nal("\x00\x00\x00\x01", 4);
+    if (codec == NalIndex::Codec::H265) {
+        nal.append(char(39 << 1));          // PREFIX_SEI_NUT, layer 0
+        nal.append(char(0x01));             // temporal id 0
+    } else {
+        nal.append(char(0x06));             // nal_ref_idc 0, SEI
+    }
+    appendEscaped(&nal, rbsp);
+    return nal;
+}
+
+HdrMetadata HdrMetadata::scanFile(const QString &filePath, NalIndex::Codec codec, qint64 maxBytes)
+{
+    HdrMetadata metadata;
+    QFile file(filePath);
+    if (codec == NalIndex::Codec::Unknown || !file.open(QIODevice::ReadOnly)) {
+        return metadata;
+    }
+    const QByteArray head = file.read(maxBytes);
+    const uchar *data = reinterpret_cast<const uchar *>(head.constData());
+    const uchar *end = data + head.size();
+    const uchar *p = StartCodeScanner::findNext(data, end);
+    while (p != end) {
+        const uchar *nal = p + 3;
+        if (nal >= end) {
+            break;
+        }
+        const uchar *next = StartCodeScanner::findNext(nal, end);
+        // Only the first picture's SEI: a stream states its metadata up front
+        const int type = (codec == NalIndex::Codec::H265) ? ((nal[0] >> 1) & 0x3f) : (nal[0] & 0x1f);
+        const bool vcl = (codec == NalIndex::Codec::H265) ? type <= 31 : (type >= 1 && type <= 5);
+        if (vcl) {
+            break;
+        }
+        metadata.readSei(nal, next - nal, codec);
+        p = next;
+    }
+    return metadata;
+}
@@ -0,0 +1,50 @@
+#ifndef HDRMETADATA_H
+#define HDRMETADATA_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+#include "NalIndex.h"
+
+// HDR static metadata as carried in H.264/H.265 SEI: mastering display colour
+// volume (SMPTE ST 2086, payload type 137) and content light level (payload type
+// 144). Values are kept in SEI units: chromaticities in 0.00002, luminance in
+// 0.0001 cd/m², light levels in cd/m². The text forms follow x265's
+// --master-display and --max-cll options.
+struct HdrMetadata {
+    bool hasMasteringDisplay = false;
+    quint16 primaries[3][2] = {};   // x, y in SEI order: green, blue, red
+    quint16 whitePoint[2] = {};
+    quint32 maxLuminance = 0;
+    quint32 minLuminance = 0;
+
+    bool hasContentLight = false;
+    quint16 maxCll = 0;
+    quint16 maxFall = 0;
+
+    bool isEmpty() const { return !hasMasteringDisplay && !hasContentLight; }
+    // Fields set in other replace this one's
+    void overrideWith(const HdrMetadata &other);
+
+    // "G(13250,34500)B(7500,3000)R(34000,16000)WP(15635,16450)L(10000000,1)"
+    QString masterDisplayString() const;
+    bool setMasterDisplay(const QString &text);
+    // "1000,400"
+    QString maxCllString() const;
+    bool setMaxCll(const QString &text);
+    QString describe() const;       // "mastering 0.005-1000 cd/m², MaxCLL 1000, MaxFALL 400"
+
+    // Reads payload types 137/144 from an SEI NAL unit (header included); true if any was found
+    bool readSei(const uchar *nal, qint64 size, NalIndex::Codec codec);
+    // One prefix SEI NAL unit carrying both messages, with a four-byte start code
+    QByteArray seiNal(NalIndex::Codec codec) const;
+    // The SEI NAL unit without its mastering display and content light messages:
+    // unchanged if it has none, empty if nothing else is left
+    static QByteArray stripSei(const uchar *nal, qint64 size, NalIndex::Codec codec, bool *changed);
+
+    // Metadata in the SEI within the first maxBytes of a raw stream
+    static HdrMetadata scanFile(const QString &filePath, NalIndex::Codec codec, qint64 maxBytes = 1024 * 1024);
+    static bool isSeiNal(const uchar *nal, NalIndex::Codec codec);
+};
+
+#endif // HDRMETADATA_H
@@ -0,0 +1,387 @@
+#include "IoPolicy.h"
+#include <QFile>
+#include <QSettings>
+#include <QStringList>
+#include <limits>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+QString formatBytes(qint64 bytes)
+{
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+}
+
+#ifdef Q_OS_LINUX
+// Reads "<key>: <value> kB" from /proc/meminfo style files
+qint64 readMeminfoBytes(const QStringList &lines, const QString &key)
+{
+    for (const QString &line : lines) {
+        if (line.startsWith(key + ':')) {
+            const QStringList parts = line.simplified().split(' ');
+            if (parts.size() >= 2) {
+                return parts.at(1).toLongLong() * 1024;
+            }
+        }
+    }
+    return 0;
+}
+#endif
+
+} // namespace
+
+IoPolicy::Settings IoPolicy::Settings::load()
+{
+    QSettings settings;
+    Settings s;
+    s.enabled = settings.value("io/cacheManagement", true).toBool();
+    s.dropInputCache = settings.value("io/dropInputCache", true).toBool();
+    s.steadyWriteback = settings.value("io/steadyWriteback", true).toBool();
+    int chunkMb = settings.value("io/writebackChunkMB", 64).toInt();
+    if (chunkMb < 4) chunkMb = 4;
+    s.writebackChunkBytes = qint64(chunkMb) * 1024 * 1024;
+    s.prefetchDepth = qBound(0, settings.value("io/prefetchDepth", 2).toInt(), 16);
+    s.prefetchHeadBytes = qint64(qMax(1, settings.value("io/prefetchHeadMB", 32).toInt())) * 1024 * 1024;
+    s.prefetchBudgetBytes = qint64(qMax(0, settings.value("io/prefetchBudgetMB", 256).toInt())) * 1024 * 1024;
+    s.prefetchMaxIoPressure = settings.value("io/prefetchMaxIoPressure", 40.0).toDouble();
+    return s;
+}
+
+void IoPolicy::adviseSequential(int fd)
+{
+#ifdef Q_OS_LINUX
+    if (fd >= 0) {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#else
+    Q_UNUSED(fd);
+#endif
+}
+
+void IoPolicy::dropCache(int fd, qint64 offset, qint64 length)
+{
+#ifdef Q_OS_LINUX
+    if (fd >= 0 && length > 0) {
+        ::posix_fadvise(fd, offset, length, POSIX_FADV_DONTNEED);
+    }
+#else
+    Q_UNUSED(fd); Q_UNUSED(offset); Q_UNUSED(length);
+#endif
+}
+
+qint64 IoPolicy::dropFileCache(const QString &filePath)
+{
+#ifdef Q_OS_LINUX
+    int fd = ::open(QFile::encodeName(filePath).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    qint64 size = (::fstat(fd, &st) == 0) ? qint64(st.st_size) : 0;
+    // Dirty pages are skipped by DONTNEED, so kick off writeback first
+    ::sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+    return size;
+#else
+    Q_UNUSED(filePath);
+    return 0;
+#endif
+}
+
+void IoPolicy::startWriteback(int fd, qint64 offset, qint64 length)
+{
+#ifdef Q_OS_LINUX
+    if (fd >= 0 && length > 0) {
+        ::sync_file_range(fd, offset, length, SYNC_FILE_RANGE_WRITE);
+    }
+#else
+    Q_UNUSED(fd); Q_UNUSED(offset); Q_UNUSED(length);
+#endif
+}
+
+void IoPolicy::waitWriteback(int fd, qint64 offset, qint64 length)
+{
+#ifdef Q_OS_LINUX
+    if (fd >= 0 && length > 0) {
+        ::sync_file_range(fd, offset, length,
+                          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+    }
+#else
+    Q_UNUSED(fd); Q_UNUSED(offset); Q_UNUSED(length);
+#endif
+}
+
+qint64 IoPolicy::prefetchFile(const QString &filePath, qint64 offset, qint64 bytes)
+{
+#ifdef Q_OS_LINUX
+    int fd = ::open(QFile::encodeName(filePath).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    qint64 length = (::fstat(fd, &st) == 0) ? qBound<qint64>(0, st.st_size - offset, bytes) : 0;
+    if (length > 0) {
+        ::posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+    }
+    ::close(fd);
+    return length;
+#else
+    Q_UNUSED(filePath); Q_UNUSED(offset); Q_UNUSED(bytes);
+    return 0;
+#endif
+}
+
+double IoPolicy::ioPressure()
+{
+#ifdef Q_OS_LINUX
+    // Format: "some avg10=1.23 avg60=0.50 avg300=0.10 total=12345"
+    QFile file("/proc/pressure/io");
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QStringList lines = QString::fromLatin1(file.readAll()).split('\n');
+        for (const QString &line : lines) {
+            if (!line.startsWith("some ")) {
+                continue;
+            }
+            const QStringList fields = line.split(' ', Qt::SkipEmptyParts);
+            for (const QString &field : fields) {
+                if (field.startsWith("avg10=")) {
+                    return field.mid(6).toDouble();
+                }
+            }
+        }
+    }
+#endif
+    return -1.0;
+}
+
+qint64 IoPolicy::processReadBytes(qint64 pid)
+{
+#ifdef Q_OS_LINUX
+    if (pid <= 0) {
+        return -1;
+    }
+    QFile file(QString("/proc/%1/io").arg(pid));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return -1;
+    }
+    const QStringList lines = QString::fromLatin1(file.readAll()).split('\n');
+    for (const QString &line : lines) {
+        if (line.startsWith("rchar:")) {
+            return line.mid(6).trimmed().toLongLong();
+        }
+    }
+    return -1;
+#else
+    Q_UNUSED(pid);
+    return -1;
+#endif
+}
+
+IoPolicy::MemoryUsage IoPolicy::memoryUsage()
+{
+    MemoryUsage usage;
+#ifdef Q_OS_LINUX
+    QFile meminfo("/proc/meminfo");
+    if (meminfo.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QStringList lines = QString::fromLatin1(meminfo.readAll()).split('\n');
+        usage.pageCacheBytes = readMeminfoBytes(lines, "Cached");
+        usage.dirtyBytes = readMeminfoBytes(lines, "Dirty");
+        usage.writebackBytes = readMeminfoBytes(lines, "Writeback");
+    }
+    QFile status("/proc/self/status");
+    if (status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QStringList lines = QString::fromLatin1(status.readAll()).split('\n');
+        usage.rssBytes = readMeminfoBytes(lines, "VmRSS");
+    }
+#endif
+    return usage;
+}
+
+QString IoPolicy::describeMemoryUsage(const MemoryUsage &usage)
+{
+    return QString("RSS %1, page cache %2, dirty %3, writeback %4")
+        .arg(formatBytes(usage.rssBytes))
+        .arg(formatBytes(usage.pageCacheBytes))
+        .arg(formatBytes(usage.dirtyBytes))
+        .arg(formatBytes(usage.writebackBytes));
+}
+
+CacheGovernor::CacheGovernor()
+    : m_outputFd(-1)
+    , m_inputDropped(0)
+    , m_outputStarted(0)
+    , m_outputFlushed(0)
+{
+}
+
+CacheGovernor::~CacheGovernor()
+{
+    closeFiles();
+}
+
+void CacheGovernor::begin(const QList<IoPolicy::FileRange> &inputRanges, const QString &outputFile,
+                          const IoPolicy::Settings &settings)
+{
+    closeFiles();
+    m_inputs.clear();
+    m_settings = settings;
+    m_outputFile = outputFile;
+    m_inputDropped = 0;
+    m_outputStarted = 0;
+    m_outputFlushed = 0;
+
+    if (!m_settings.enabled || !m_settings.dropInputCache) {
+        return;
+    }
+    for (const IoPolicy::FileRange &range : inputRanges) {
+        Input input;
+        input.range = range;
+        m_inputs << input;
+    }
+}
+
+bool CacheGovernor::ensureInputOpen(Input &input)
+{
+#ifdef Q_OS_LINUX
+    if (input.fd < 0 && !input.opened) {
+        input.opened = true;
+        input.fd = ::open(QFile::encodeName(input.range.file).constData(), O_RDONLY | O_CLOEXEC);
+    }
+#endif
+    return input.fd >= 0;
+}
+
+void CacheGovernor::closeInput(Input &input)
+{
+#ifdef Q_OS_LINUX
+    if (input.fd >= 0) {
+        ::close(input.fd);
+    }
+#endif
+    input.fd = -1;
+}
+
+bool CacheGovernor::ensureOutputOpen()
+{
+#ifdef Q_OS_LINUX
+    // The child creates the output some time after it starts
+    if (m_outputFd < 0 && !m_outputFile.isEmpty()) {
+        m_outputFd = ::open(QFile::encodeName(m_outputFile).constData(), O_RDONLY | O_CLOEXEC);
+    }
+#endif
+    return m_outputFd >= 0;
+}
+
+void CacheGovernor::update(qint64 inputConsumedBytes)
+{
+    if (!m_settings.enabled) {
+        return;
+    }
+
+    const qint64 chunk = m_settings.writebackChunkBytes;
+
+    // The child's read count walks the ranges in order. Release the ranges it has
+    // finished, and in the one it is reading the pages it has moved past, keeping
+    // one chunk behind the read position in case the demuxer seeks back a little.
+    qint64 remaining = inputConsumedBytes;
+    for (Input &input : m_inputs) {
+        if (remaining <= 0) {
+            break;
+        }
+        const qint64 length = input.range.end >= 0 ? input.range.end - input.range.begin
+                                                   : std::numeric_limits<qint64>::max();
+        const qint64 consumed = qMin(remaining, length);
+        remaining -= consumed;
+        const bool passed = consumed == length;
+
+        qint64 target = input.dropped;
+        if (passed) {
+            target = consumed;
+        } else if (consumed > input.dropped + 2 * chunk) {
+            target = consumed - chunk;
+        }
+        if (target > input.dropped && ensureInputOpen(input)) {
+            IoPolicy::dropCache(input.fd, input.range.begin + input.dropped, target - input.dropped);
+            m_inputDropped += target - input.dropped;
+            input.dropped = target;
+        }
+        if (passed) {
+            closeInput(input);
+        }
+    }
+
+    if (!m_settings.steadyWriteback || !ensureOutputOpen()) {
+        return;
+    }
+
+#ifdef Q_OS_LINUX
+    struct stat st;
+    if (::fstat(m_outputFd, &st) != 0) {
+        return;
+    }
+    const qint64 size = st.st_size;
+
+    // Never block here: the range queued on the previous tick has had a full tick
+    // to reach the disk, so drop it now and queue the newly written chunk.
+    if (size - m_outputStarted >= chunk) {
+        IoPolicy::dropCache(m_outputFd, m_outputFlushed, m_outputStarted - m_outputFlushed);
+        m_outputFlushed = m_outputStarted;
+        IoPolicy::startWriteback(m_outputFd, m_outputStarted, size - m_outputStarted);
+        m_outputStarted = size;
+    }
+#endif
+}
+
+void CacheGovernor::finish()
+{
+    if (m_settings.enabled) {
+#ifdef Q_OS_LINUX
+        struct stat st;
+        // Whatever is left of every range the job read
+        for (Input &input : m_inputs) {
+            qint64 end = input.range.end;
+            if (!ensureInputOpen(input)) {
+                continue;
+            }
+            if (end < 0) {
+                end = ::fstat(input.fd, &st) == 0 ? st.st_size : input.range.begin + input.dropped;
+            }
+            const qint64 offset = input.range.begin + input.dropped;
+            if (end > offset) {
+                IoPolicy::dropCache(input.fd, offset, end - offset);
+                m_inputDropped += end - offset;
+                input.dropped = end - input.range.begin;
+            }
+        }
+        if (m_settings.steadyWriteback && ensureOutputOpen()) {
+            // Queue the tail (the faststart rewrite may have touched the whole file).
+            // Pages still under writeback survive this DONTNEED and age out normally.
+            IoPolicy::startWriteback(m_outputFd, 0, 0);
+            IoPolicy::dropCache(m_outputFd, 0, 0);
+            if (::fstat(m_outputFd, &st) == 0) {
+                m_outputStarted = st.st_size;
+            }
+        }
+#endif
+    }
+    closeFiles();
+}
+
+void CacheGovernor::closeFiles()
+{
+    for (Input &input : m_inputs) {
+        closeInput(input);
+    }
+#ifdef Q_OS_LINUX
+    if (m_outputFd >= 0) {
+        ::close(m_outputFd);
+    }
+#endif
+    m_outputFd = -1;
+}
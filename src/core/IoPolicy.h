@@ -0,0 +1,116 @@
+#ifndef IOPOLICY_H
+#define IOPOLICY_H
+
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+// Page-cache policy for large sequential batch I/O.
+//
+// Batches stream hundreds of GB through the page cache. Left alone, that evicts
+// everything else on the machine and builds up dirty pages that flush in multi-second
+// bursts. IoPolicy wraps the Linux hints used to keep a batch's cache footprint flat:
+// posix_fadvise() on inputs and sync_file_range() writeback on outputs. On other
+// platforms every call is a no-op.
+class IoPolicy
+{
+public:
+    struct Settings {
+        bool enabled = true;                          // master switch for cache management
+        bool dropInputCache = true;                   // POSIX_FADV_DONTNEED on consumed input ranges
+        bool steadyWriteback = true;                  // sync_file_range() on output as it grows
+        qint64 writebackChunkBytes = 64LL * 1024 * 1024;
+
+        // Read-ahead of queued inputs while the current job runs
+        int prefetchDepth = 2;                        // next K queued inputs
+        qint64 prefetchHeadBytes = 32LL * 1024 * 1024;  // per input
+        qint64 prefetchBudgetBytes = 256LL * 1024 * 1024; // outstanding across all inputs
+        double prefetchMaxIoPressure = 40.0;          // skip when PSI io "some avg10" exceeds this
+
+        static Settings load();                       // reads the "io/..." QSettings group
+    };
+
+    // Bytes [begin, end) of a file; end -1 is the end of the file
+    struct FileRange {
+        QString file;
+        qint64 begin = 0;
+        qint64 end = -1;
+    };
+
+    struct MemoryUsage {
+        qint64 rssBytes = 0;                          // this process
+        qint64 pageCacheBytes = 0;                    // system-wide "Cached"
+        qint64 dirtyBytes = 0;                        // system-wide "Dirty"
+        qint64 writebackBytes = 0;                    // system-wide "Writeback"
+    };
+
+    // In-process I/O paths call these on their own descriptors
+    static void adviseSequential(int fd);
+    static void dropCache(int fd, qint64 offset, qint64 length);
+    static qint64 dropFileCache(const QString &filePath);   // returns bytes advised
+    static void startWriteback(int fd, qint64 offset, qint64 length);
+    static void waitWriteback(int fd, qint64 offset, qint64 length);
+
+    // Asks the kernel to start reading bytes at offset in the background
+    // (POSIX_FADV_WILLNEED, does not block). Returns bytes requested.
+    static qint64 prefetchFile(const QString &filePath, qint64 offset, qint64 bytes);
+    // PSI "some avg10" for I/O in percent, or -1 when the kernel does not expose it
+    static double ioPressure();
+
+    // Bytes read so far by a child process (/proc/<pid>/io rchar), or -1 if unknown
+    static qint64 processReadBytes(qint64 pid);
+
+    static MemoryUsage memoryUsage();
+    static QString describeMemoryUsage(const MemoryUsage &usage);
+};
+
+// Keeps the cache footprint of one running job bounded while a child process
+// (ffmpeg) reads the input and writes the output.
+//
+// Each update() starts asynchronous writeback of the newly written output chunk,
+// drops the chunk queued on the previous update from the cache, and drops the
+// input range the child has already consumed. update() never waits on the disk,
+// so it is safe to call from the event loop. The result is a steady writeback
+// rate instead of periodic dirty-page storms.
+class CacheGovernor
+{
+public:
+    CacheGovernor();
+    ~CacheGovernor();
+
+    // The child reads inputRanges one after the other: the whole input, a section
+    // of it or the chunks of a join. Empty when that is not known (a time seek into
+    // a container); input pages are then left alone.
+    void begin(const QList<IoPolicy::FileRange> &inputRanges, const QString &outputFile,
+               const IoPolicy::Settings &settings);
+    // inputConsumedBytes: all bytes the child has read so far (rchar)
+    void update(qint64 inputConsumedBytes);
+    void finish();
+
+    qint64 inputBytesDropped() const { return m_inputDropped; }
+    qint64 outputBytesWrittenBack() const { return m_outputStarted; }
+
+private:
+    struct Input {
+        IoPolicy::FileRange range;
+        int fd = -1;                // opened on first drop, closed once read past
+        bool opened = false;
+        qint64 dropped = 0;         // bytes from range.begin already released
+    };
+
+    void closeFiles();
+    bool ensureInputOpen(Input &input);
+    void closeInput(Input &input);
+    bool ensureOutputOpen();
+
+    IoPolicy::Settings m_settings;
+    QString m_outputFile;
+    QList<Input> m_inputs;
+    int m_outputFd;
+
+    qint64 m_inputDropped;      // input bytes released, over all ranges
+    qint64 m_outputStarted;     // output bytes [0, m_outputStarted) queued for writeback
+    qint64 m_outputFlushed;     // output bytes [0, m_outputFlushed) dropped from the cache
+};
+
+#endif // IOPOLICY_H
@@ -1,33 +1,65 @@
 #include "MediaAnalyzer.h"
-#include "../ui/MainWindow.h"
+#include "MediaInfo.h"
+#include "BatchMetrics.h"
+#include "TraceRecorder.h"
+#include "NalIndex.h"
+#include "ThreadBudget.h"
+#include "FFprobeParser.h"
 #include <QDir>
 #include <QFileInfo>
+#include <QRegularExpression>
 #include <QDebug>
 #include <QStandardPaths>
+#include <QSettings>
+#include <QSet>
+#include <cmath>
 
 MediaAnalyzer::MediaAnalyzer(QObject *parent)
     : QObject(parent)
-    , m_probeProcess(nullptr)
     , m_analyzing(false)
+    , m_maxParallelProbes(1)
+    , m_fastProbe(true)
+    , m_indexRawStreams(true)
+    , m_pendingIndexes(0)
+    , m_generation(0)
 {
-    m_ffprobePath = findFFprobeExecutable();
+    // Results cross to the GUI thread
+    qRegisterMetaType<MediaInfo>("MediaInfo");
+
+    QSettings settings;
+    m_maxParallelProbes = qMax(1, settings.value("analysis/maxParallelProbes", 1).toInt());
+    m_indexRawStreams = settings.value("analysis/indexRawStreams", true).toBool();
+    m_fastProbe = settings.value("analysis/fastProbe", true).toBool();
+    m_indexPool.setMaxThreadCount(1);
+
+    // Prefer the path chosen in the FFmpeg setup dialog, fall back to PATH
+    const QString configuredPath = settings.value("ffmpeg/ffprobe_path").toString();
+    if (!configuredPath.isEmpty() && QFileInfo(configuredPath).isExecutable()) {
+        m_ffprobePath = configuredPath;
+    } else {
+        m_ffprobePath = findFFprobeExecutable();
+    }
 }
 
 MediaAnalyzer::~MediaAnalyzer()
 {
     stop();
+    m_indexPool.waitForDone();
 }
 
-void MediaAnalyzer::analyzeFile(int index, const QString &filePath)
+void MediaAnalyzer::analyzeFile(int index, const QString &filePath, bool deep)
 {
     AnalysisTask task;
     task.index = index;
     task.filePath = filePath;
+    task.deep = deep || !m_fastProbe;
+    // Child limits are re-read at the start of each analysis run
+    if (m_taskQueue.isEmpty() && m_deepQueue.isEmpty() && m_runningProbes.isEmpty()) {
+        m_processSettings = ProcessPolicy::Settings::load();
+    }
     m_taskQueue.enqueue(task);
     
-    if (!m_analyzing) {
-        processNextFile();
-    }
+    processNextFile();
 }
 
 void MediaAnalyzer::analyzeFiles(const QStringList &files)
@@ -40,223 +72,402 @@ void MediaAnalyzer::analyzeFiles(const QStringList &files)
 
 void MediaAnalyzer::stop()
 {
-    if (m_probeProcess && m_probeProcess->state() == QProcess::Running) {
-        m_probeProcess->kill();
-        m_probeProcess->waitForFinished(1000);
+    const QList<QProcess*> running = m_runningProbes.keys();
+    m_runningProbes.clear();
+    for (QProcess *process : running) {
+        process->disconnect(this);
+        if (process->state() != QProcess::NotRunning) {
+            // Deleted once it has exited: the QProcess destructor would wait for it
+            connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                    process, &QObject::deleteLater);
+            process->kill();
+        } else {
+            process->deleteLater();
+        }
     }
     
     m_taskQueue.clear();
+    m_deepQueue.clear();
+    // A scan already running finishes in the background; its result is dropped
+    m_indexPool.clear();
+    m_generation++;
+    m_pendingIndexes = 0;
     m_analyzing = false;
 }
 
 void MediaAnalyzer::processNextFile()
 {
-    // CRITICAL PATH: Process analysis tasks sequentially from queue
-    if (m_taskQueue.isEmpty()) {
-        m_analyzing = false;
-        emit allAnalysisFinished();
-        return;
-    }
-    
-    m_analyzing = true;
-    m_currentTask = m_taskQueue.dequeue();
-    
-    if (m_ffprobePath.isEmpty()) {
-        emit analysisError(m_currentTask.index, "FFprobe not found");
-        processNextFile();
-        return;
+    // CRITICAL PATH: Start queued probes while probe slots are free
+    while ((!m_taskQueue.isEmpty() || !m_deepQueue.isEmpty()) && m_runningProbes.size() < m_maxParallelProbes) {
+        m_analyzing = true;
+        const AnalysisTask task = !m_taskQueue.isEmpty() ? m_taskQueue.dequeue() : m_deepQueue.dequeue();
+        
+        if (m_ffprobePath.isEmpty()) {
+            emit analysisError(task.index, "FFprobe not found");
+            continue;
+        }
+        
+        startProbe(task);
     }
     
-    if (!m_probeProcess) {
-        m_probeProcess = new QProcess(this);
-        connect(m_probeProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-                this, &MediaAnalyzer::onProbeFinished);
-        connect(m_probeProcess, &QProcess::errorOccurred, this, &MediaAnalyzer::onProbeError);
+    if (m_analyzing && m_taskQueue.isEmpty() && m_deepQueue.isEmpty() && m_runningProbes.isEmpty()
+        && m_pendingIndexes == 0) {
+        m_analyzing = false;
+        emit allAnalysisFinished();
     }
+}
+
+void MediaAnalyzer::startProbe(const AnalysisTask &task)
+{
+    QProcess *process = new QProcess(this);
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &MediaAnalyzer::onProbeFinished);
+    connect(process, &QProcess::errorOccurred, this, &MediaAnalyzer::onProbeError);
+    AnalysisTask running = task;
+    running.startMs = BatchMetrics::clockMs();
+    // Lowest free slot, so the trace shows one track per concurrent probe
+    QSet<int> usedSlots;
+    for (const AnalysisTask &other : std::as_const(m_runningProbes)) {
+        usedSlots.insert(other.slot);
+    }
+    running.slot = 0;
+    while (usedSlots.contains(running.slot)) {
+        running.slot++;
+    }
+    m_runningProbes.insert(process, running);
     
     QStringList arguments;
     arguments << "-v" << "quiet"
               << "-print_format" << "json"
               << "-show_format"
-              << "-show_streams"
-              << QDir::toNativeSeparators(m_currentTask.filePath);
-    
-    m_probeProcess->start(m_ffprobePath, arguments);
+              << "-show_streams";
+    if (!task.deep) {
+        // The table needs codec, size, rate and duration, which the first packets
+        // carry; ffprobe's defaults read up to 5 MB and 5 s of each file
+        arguments << "-probesize" << QString::number(FastProbeBytes)
+                  << "-analyzeduration" << QString::number(FastAnalyzeUs);
+    }
+    const int threads = ThreadBudget::probeThreads(m_maxParallelProbes);
+    if (threads > 0) {
+        // Stream info decodes a few frames; parallel probes split the cores
+        arguments << "-threads" << QString::number(threads);
+    }
+    arguments << QDir::toNativeSeparators(task.filePath);
+    
+    ProcessPolicy::apply(process, m_processSettings, running.slot);
+    process->start(m_ffprobePath, arguments);
 }
 
 void MediaAnalyzer::onProbeFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
-    if (exitCode == 0 && exitStatus == QProcess::NormalExit) {
-        QString output = QString::fromUtf8(m_probeProcess->readAllStandardOutput());
-        MediaInfo info = parseFFprobeOutput(output);
-        emit analysisFinished(m_currentTask.index, info);
+    QProcess *process = qobject_cast<QProcess*>(sender());
+    if (!process || !m_runningProbes.contains(process)) {
+        return;
+    }
+    const AnalysisTask task = m_runningProbes.take(process);
+    const qint64 endMs = BatchMetrics::clockMs();
+    const bool ok = (exitCode == 0 && exitStatus == QProcess::NormalExit);
+    
+    TraceRecorder &trace = TraceRecorder::instance();
+    QJsonObject traceArgs;
+    traceArgs["file"] = task.filePath;
+    traceArgs["exit_code"] = exitCode;
+    trace.span(TraceRecorder::AnalyzerProcess, task.slot, QFileInfo(task.filePath).fileName(),
+               task.deep ? "deep probe" : "probe", task.startMs, endMs, traceArgs);
+
+    AnalysisTask deepTask = task;
+    deepTask.deep = true;
+    deepTask.startMs = -1;
+    deepTask.slot = -1;
+    
+    if (ok) {
+        MediaInfo info = parseFFprobeOutput(process->readAllStandardOutput());
+        info.probeStartMs = task.startMs;
+        info.probeEndMs = endMs;
+        const bool rawStream = isRawStreamFile(task.filePath);
+        if (!task.deep && needsDeepProbe(info, rawStream)) {
+            // Shown now, refined once every queued file has had its fast probe
+            emit analysisPreliminary(task.index, info);
+            m_deepQueue.enqueue(deepTask);
+        } else if (m_indexRawStreams && rawStream) {
+            // Reported once the index is built; the probe slot is free meanwhile
+            startIndex(task, info);
+        } else {
+            emit analysisFinished(task.index, info);
+        }
+    } else if (!task.deep) {
+        // A bounded probe can fail where the full one succeeds, e.g. on a long
+        // run of junk before the first packet
+        m_deepQueue.enqueue(deepTask);
+    } else if (exitStatus == QProcess::CrashExit) {
+        trace.instant(TraceRecorder::AnalyzerProcess, task.slot, "probe crashed", "error", traceArgs);
+        emit analysisError(task.index, "FFprobe crashed");
     } else {
-        QString error = QString::fromUtf8(m_probeProcess->readAllStandardError());
-        emit analysisError(m_currentTask.index, QString("FFprobe failed: %1").arg(error));
+        QString error = QString::fromUtf8(process->readAllStandardError());
+        traceArgs["stderr"] = error.trimmed();
+        trace.instant(TraceRecorder::AnalyzerProcess, task.slot, "probe failed", "error", traceArgs);
+        emit analysisError(task.index, QString("FFprobe failed: %1").arg(error));
     }
     
+    process->deleteLater();
     processNextFile();
 }
 
+bool MediaAnalyzer::needsDeepProbe(const MediaInfo &info, bool rawStream) const
+{
+    // What the fast tier misses shows as a gap: no streams at all, video without a
+    // size or rate, no duration, or no audio in MPEG-TS, whose audio PIDs often
+    // start seconds in. Raw streams have no container to read further into.
+    if (info.videoCodec.isEmpty() && info.audioCodec.isEmpty()) {
+        return true;
+    }
+    if (rawStream) {
+        return false;
+    }
+    if (!info.videoCodec.isEmpty() && (info.resolution.isEmpty() || info.resolution.startsWith("0x")
+                                       || info.frameRate.isEmpty() || info.frameRateGuessed)) {
+        return true;
+    }
+    return info.duration.isEmpty() || (info.formatName == "mpegts" && info.audioCodec.isEmpty());
+}
+
 void MediaAnalyzer::onProbeError(QProcess::ProcessError error)
 {
-    QString errorString;
-    switch (error) {
-    case QProcess::FailedToStart:
-        errorString = "Failed to start FFprobe";
-        break;
-    case QProcess::Crashed:
-        errorString = "FFprobe crashed";
-        break;
-    default:
-        errorString = "FFprobe process error";
-        break;
-    }
-    
-    emit analysisError(m_currentTask.index, errorString);
+    // A probe that crashed also delivers finished() with CrashExit; only a probe
+    // that never started has to be completed here.
+    if (error != QProcess::FailedToStart) {
+        return;
+    }
+    QProcess *process = qobject_cast<QProcess*>(sender());
+    if (!process || !m_runningProbes.contains(process)) {
+        return;
+    }
+    const AnalysisTask task = m_runningProbes.take(process);
+    
+    QJsonObject traceArgs;
+    traceArgs["file"] = task.filePath;
+    traceArgs["program"] = m_ffprobePath;
+    TraceRecorder::instance().instant(TraceRecorder::AnalyzerProcess, task.slot, "probe failed to start", "error", traceArgs);
+    emit analysisError(task.index, "Failed to start FFprobe");
+    process->deleteLater();
+    processNextFile();
+}
+
+void MediaAnalyzer::startIndex(const AnalysisTask &task, const MediaInfo &info)
+{
+    m_pendingIndexes++;
+    const quint64 generation = m_generation;
+    const NalIndex::Codec codec = NalIndex::codecFromName(info.videoCodec);
+    m_indexPool.start([this, task, info, generation, codec]() {
+        const qint64 startMs = BatchMetrics::clockMs();
+        QSharedPointer<NalIndex> index(new NalIndex);
+        const bool ok = index->build(task.filePath, codec);
+        const QString summary = ok ? index->describe() : index->errorString();
+        MediaInfo indexed = info;
+        if (ok) {
+            // Raw streams state their HDR static metadata in the first picture's SEI
+            indexed.hdrMetadata.overrideWith(HdrMetadata::scanFile(task.filePath, index->codec()));
+        } else {
+            index.reset();
+        }
+        QMetaObject::invokeMethod(this, [=]() {
+            onIndexBuilt(task, indexed, generation, index, summary, startMs);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MediaAnalyzer::onIndexBuilt(const AnalysisTask &task, MediaInfo info, quint64 generation,
+                                 const QSharedPointer<const NalIndex> &index, const QString &summary, qint64 startMs)
+{
+    if (generation != m_generation) {
+        return;
+    }
+    m_pendingIndexes--;
+
+    QJsonObject traceArgs;
+    traceArgs["file"] = task.filePath;
+    traceArgs["result"] = summary;
+    TraceRecorder::instance().span(TraceRecorder::AnalyzerProcess, task.slot, QFileInfo(task.filePath).fileName(),
+                                   "index", startMs, BatchMetrics::clockMs(), traceArgs);
+
+    const QString fileName = QFileInfo(task.filePath).fileName();
+    info.isRawStream = true;
+    if (index) {
+        const qint64 frames = index->frameCount();
+        info.frameCount = frames;
+        info.keyframeCount = index->keyframeCount();
+        info.nalIndex = index;      // kept for keyframe-aligned extraction
+        // Raw streams carry no timestamps; the duration is exact at the probed rate
+        static const QRegularExpression number("([0-9]+(?:\\.[0-9]+)?)");
+        const QRegularExpressionMatch fps = number.match(info.frameRate);
+        if (fps.hasMatch() && fps.captured(1).toDouble() > 0.0) {
+            info.duration = formatDuration(double(frames) / fps.captured(1).toDouble());
+        }
+        emit logMessage(QString("Indexed %1: %2").arg(fileName, summary));
+    } else {
+        emit logMessage(QString("[WARN] Could not index %1: %2").arg(fileName, summary));
+    }
+    emit analysisFinished(task.index, info);
     processNextFile();
 }
 
-MediaInfo MediaAnalyzer::parseFFprobeOutput(const QString &output)
+MediaInfo MediaAnalyzer::parseFFprobeOutput(const QByteArray &output)
 {
     // CRITICAL PATH: Parse FFprobe JSON output to extract media metadata
     MediaInfo info;
     
-    QJsonParseError error;
-    QJsonDocument doc = QJsonDocument::fromJson(output.toUtf8(), &error);
-    
-    if (error.error != QJsonParseError::NoError) {
+    FFprobeOutput probe;
+    if (!FFprobeParser::parse(output, &probe)) {
         return info;
     }
     
-    QJsonObject root = doc.object();
-    
     // Parse format information
-    if (root.contains("format")) {
-        QJsonObject format = root["format"].toObject();
+    if (probe.format.present) {
+        const FFprobeFormat &format = probe.format;
         
-        if (format.contains("duration")) {
-            double duration = format["duration"].toString().toDouble();
+        info.formatName = format.formatName;
+
+        if (!format.duration.isNull()) {
+            double duration = format.duration.toDouble();
             info.duration = formatDuration(duration);
         }
         
-        if (format.contains("size")) {
-            qint64 size = format["size"].toString().toLongLong();
+        if (!format.size.isNull()) {
+            qint64 size = format.size.toLongLong();
             info.fileSize = formatFileSize(size);
         }
         
-        if (format.contains("bit_rate")) {
-            int bitrate = format["bit_rate"].toString().toInt();
+        if (!format.bitRate.isNull()) {
+            int bitrate = format.bitRate.toInt();
             info.bitrate = QString::number(bitrate / 1000) + " kbps";
         }
     }
     
-    // Parse streams information
-    if (root.contains("streams")) {
-        QJsonArray streams = root["streams"].toArray();
-        
-        for (const QJsonValue &streamValue : streams) {
-            QJsonObject stream = streamValue.toObject();
-            QString codecType = stream["codec_type"].toString();
+    // Parse streams information: all of them into the stream table, the first
+    // video and audio stream into the summary fields
+    info.streams.reserve(probe.streams.size());
+    for (const FFprobeStream &stream : probe.streams) {
+        StreamInfo entry;
+        entry.index = stream.index >= 0 ? stream.index : int(info.streams.size());
+        entry.type = StreamInfo::typeFromName(stream.codecType);
+        entry.isDefault = stream.isDefault;
+        entry.isForced = stream.isForced;
+        entry.attachedPic = stream.attachedPic;
+        entry.codec = stream.codecName;
+        entry.language = stream.language;
+        entry.channels = qMax(0, stream.channels);
+        entry.sampleRate = qMax(0, stream.sampleRate);
+        info.streams.append(entry);
+
+        // CRITICAL PATH: Extract video stream metadata
+        if (entry.type == StreamInfo::Video && info.videoCodec.isEmpty()) {
+            info.videoCodec = stream.codecName.toUpper();
             
-            // CRITICAL PATH: Extract video stream metadata
-            if (codecType == "video" && info.videoCodec.isEmpty()) {
-                info.videoCodec = stream["codec_name"].toString().toUpper();
-                
-                if (stream.contains("width") && stream.contains("height")) {
-                    int width = stream["width"].toInt();
-                    int height = stream["height"].toInt();
-                    info.resolution = QString("%1x%2").arg(width).arg(height);
-                }
-                
-                QString fpsSource;
-                if (stream.contains("avg_frame_rate")) {
-                    fpsSource = stream["avg_frame_rate"].toString();
-                } else if (stream.contains("r_frame_rate")) {
-                    fpsSource = stream["r_frame_rate"].toString();
-                }
-                if (!fpsSource.isEmpty()) {
-                    info.frameRate = normalizeFpsFromText(fpsSource);
-                }
-                
-                // Parse bit depth
-                if (stream.contains("bits_per_raw_sample")) {
-                    int bitDepth = stream["bits_per_raw_sample"].toInt();
-                    info.bitDepth = QString::number(bitDepth) + " bit";
-                } else if (stream.contains("pix_fmt")) {
-                    QString pixFmt = stream["pix_fmt"].toString();
-                    info.bitDepth = bitDepthFromPixelFormat(pixFmt);
-                }
-                
-                // CRITICAL PATH: Parse HDR-related color metadata for proper color handling
-                if (stream.contains("color_primaries")) {
-                    info.colorPrimariesCode = stream["color_primaries"].toString();
-                }
-                if (stream.contains("color_transfer")) {
-                    info.colorTransferCode = stream["color_transfer"].toString();
-                }
-                if (stream.contains("color_space")) {
-                    info.colorSpaceCode = stream["color_space"].toString();
-                }
+            if (stream.width >= 0 && stream.height >= 0) {
+                info.resolution = QString("%1x%2").arg(stream.width).arg(stream.height);
+            }
+            
+            const QString &fpsSource = !stream.avgFrameRate.isNull() ? stream.avgFrameRate : stream.rFrameRate;
+            if (!fpsSource.isEmpty()) {
+                info.frameRateGuessed = fpsSource.startsWith("0/");
+                info.frameRate = normalizeFpsFromText(fpsSource);
+            }
+            
+            // Parse bit depth (ffprobe prints bits_per_raw_sample as a string)
+            if (stream.bitsPerRawSample > 0) {
+                info.bitDepth = QString::number(stream.bitsPerRawSample) + " bit";
+            } else if (!stream.pixFmt.isNull()) {
+                info.bitDepth = bitDepthFromPixelFormat(stream.pixFmt);
+            }
+            
+            // CRITICAL PATH: Parse HDR-related color metadata for proper color handling
+            info.colorPrimariesCode = stream.colorPrimaries;
+            info.colorTransferCode = stream.colorTransfer;
+            info.colorSpaceCode = stream.colorSpace;
 
-                // Mark HDR if transfer function is PQ or HLG
-                if (info.colorTransferCode == "smpte2084") {
-                    info.isHdr = true;
-                    info.hdrEotf = "PQ";
-                } else if (info.colorTransferCode == "arib-std-b67") {
-                    info.isHdr = true;
-                    info.hdrEotf = "HLG";
+            // Mastering display and content light level from the container
+            // (side data in SEI units: chromaticity /50000, luminance /10000)
+            for (const FFprobeSideData &side : stream.sideData) {
+                auto units = [&side](FFprobeSideData::Key key, double scale) -> quint32 {
+                    const QStringList parts = side.value(key).split('/');
+                    const double den = parts.size() == 2 ? parts.at(1).toDouble() : 1.0;
+                    return den > 0.0 ? quint32(qRound64(parts.at(0).toDouble() / den * scale)) : 0;
+                };
+                if (side.type == "Mastering display metadata" && !side.value(FFprobeSideData::MaxLuminance).isNull()) {
+                    HdrMetadata &hdr = info.hdrMetadata;
+                    const FFprobeSideData::Key keys[3][2] = {{FFprobeSideData::GreenX, FFprobeSideData::GreenY},
+                                                             {FFprobeSideData::BlueX, FFprobeSideData::BlueY},
+                                                             {FFprobeSideData::RedX, FFprobeSideData::RedY}};
+                    for (int c = 0; c < 3; ++c) {
+                        hdr.primaries[c][0] = quint16(units(keys[c][0], 50000.0));
+                        hdr.primaries[c][1] = quint16(units(keys[c][1], 50000.0));
+                    }
+                    hdr.whitePoint[0] = quint16(units(FFprobeSideData::WhitePointX, 50000.0));
+                    hdr.whitePoint[1] = quint16(units(FFprobeSideData::WhitePointY, 50000.0));
+                    hdr.maxLuminance = units(FFprobeSideData::MaxLuminance, 10000.0);
+                    hdr.minLuminance = units(FFprobeSideData::MinLuminance, 10000.0);
+                    hdr.hasMasteringDisplay = hdr.maxLuminance > 0;
+                } else if (side.type == "Content light level metadata") {
+                    info.hdrMetadata.maxCll = quint16(side.value(FFprobeSideData::MaxContent).toInt());
+                    info.hdrMetadata.maxFall = quint16(side.value(FFprobeSideData::MaxAverage).toInt());
+                    info.hdrMetadata.hasContentLight = true;
                 }
+            }
 
-                // Heuristic: if transfer missing but primaries/matrix suggest BT.2020 and bit depth >=10, mark incomplete HDR
-                bool isAtLeast10Bit = info.bitDepth.contains("10") || info.bitDepth.contains("12") || info.bitDepth.contains("16");
-                if (!info.isHdr && info.colorTransferCode.isEmpty() &&
-                    (info.colorPrimariesCode.contains("2020") || info.colorSpaceCode.contains("2020")) && isAtLeast10Bit) {
-                    info.hdrMetadataIncomplete = true;
-                }
+            // Mark HDR if transfer function is PQ or HLG
+            if (info.colorTransferCode == "smpte2084") {
+                info.isHdr = true;
+                info.hdrEotf = "PQ";
+            } else if (info.colorTransferCode == "arib-std-b67") {
+                info.isHdr = true;
+                info.hdrEotf = "HLG";
+            }
 
-                // Parse color space (human readable)
-                if (stream.contains("color_space")) {
-                    QString colorSpace = stream["color_space"].toString();
-                    if (colorSpace == "bt709") {
-                        info.colorSpace = "Rec. 709";
-                    } else if (colorSpace == "bt2020nc" || colorSpace == "bt2020c") {
-                        info.colorSpace = "Rec. 2020";
-                    } else if (colorSpace == "smpte170m") {
-                        info.colorSpace = "SMPTE 170M";
-                    } else if (colorSpace == "bt470bg") {
-                        info.colorSpace = "PAL";
-                    } else if (!colorSpace.isEmpty()) {
-                        info.colorSpace = colorSpace.toUpper();
-                    } else {
-                        info.colorSpace = "Unknown";
-                    }
+            // Heuristic: if transfer missing but primaries/matrix suggest BT.2020 and bit depth >=10, mark incomplete HDR
+            bool isAtLeast10Bit = info.bitDepth.contains("10") || info.bitDepth.contains("12") || info.bitDepth.contains("16");
+            if (!info.isHdr && info.colorTransferCode.isEmpty() &&
+                (info.colorPrimariesCode.contains("2020") || info.colorSpaceCode.contains("2020")) && isAtLeast10Bit) {
+                info.hdrMetadataIncomplete = true;
+            }
+
+            // Parse color space (human readable)
+            if (!stream.colorSpace.isNull()) {
+                const QString &colorSpace = stream.colorSpace;
+                if (colorSpace == "bt709") {
+                    info.colorSpace = "Rec. 709";
+                } else if (colorSpace == "bt2020nc" || colorSpace == "bt2020c") {
+                    info.colorSpace = "Rec. 2020";
+                } else if (colorSpace == "smpte170m") {
+                    info.colorSpace = "SMPTE 170M";
+                } else if (colorSpace == "bt470bg") {
+                    info.colorSpace = "PAL";
+                } else if (!colorSpace.isEmpty()) {
+                    info.colorSpace = colorSpace.toUpper();
                 } else {
-                    // Try to infer from resolution for common cases
-                    if (stream.contains("width")) {
-                        int width = stream["width"].toInt();
-                        if (width >= 1920) {
-                            info.colorSpace = "Rec. 709"; // HD/UHD default
-                        } else {
-                            info.colorSpace = "Rec. 601"; // SD default
-                        }
+                    info.colorSpace = "Unknown";
+                }
+            } else {
+                // Try to infer from resolution for common cases
+                if (stream.width >= 0) {
+                    if (stream.width >= 1920) {
+                        info.colorSpace = "Rec. 709"; // HD/UHD default
                     } else {
-                        info.colorSpace = "Unknown";
+                        info.colorSpace = "Rec. 601"; // SD default
                     }
+                } else {
+                    info.colorSpace = "Unknown";
                 }
             }
-            else if (codecType == "audio" && info.audioCodec.isEmpty()) {
-                info.audioCodec = stream["codec_name"].toString().toUpper();
-                
-                if (stream.contains("channels")) {
-                    int channels = stream["channels"].toInt();
-                    info.audioCodec += QString(" (%1ch)").arg(channels);
-                }
-                
-                if (stream.contains("sample_rate")) {
-                    int sampleRate = stream["sample_rate"].toInt();
-                    info.audioCodec += QString(" %1Hz").arg(sampleRate);
-                }
+        }
+        else if (entry.type == StreamInfo::Audio && info.audioCodec.isEmpty()) {
+            info.audioCodec = stream.codecName.toUpper();
+            
+            if (stream.channels >= 0) {
+                info.audioCodec += QString(" (%1ch)").arg(stream.channels);
+            }
+            
+            if (stream.sampleRate >= 0) {
+                info.audioCodec += QString(" %1Hz").arg(stream.sampleRate);
             }
         }
     }
@@ -9,12 +9,21 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QQueue>
+#include <QHash>
+#include <QThreadPool>
+#include <QSharedPointer>
+#include "ProcessPolicy.h"
+#include <atomic>
 
 struct MediaInfo;
+class NalIndex;
 
 struct AnalysisTask {
     int index;
     QString filePath;
+    qint64 startMs = -1;
+    int slot = -1;              // probe slot, for the trace timeline
+    bool deep = false;          // full ffprobe defaults instead of the bounded fast tier
 };
 
 class MediaAnalyzer : public QObject
@@ -25,16 +34,44 @@ public:
     explicit MediaAnalyzer(QObject *parent = nullptr);
     ~MediaAnalyzer();
 
-    void analyzeFile(int index, const QString &filePath);
+    // Bounds of the fast probe tier: -probesize in bytes, -analyzeduration in us
+    static constexpr qint64 FastProbeBytes = 1024 * 1024;
+    static constexpr qint64 FastAnalyzeUs = 1000000;
+
+    // Files are first probed by a fast tier that reads at most FastProbeBytes and
+    // FastAnalyzeUs of each; a file it leaves ambiguous is reported through
+    // analysisPreliminary() and probed again with ffprobe's defaults once the fast
+    // tier of every queued file has run. deep skips the fast tier, e.g. for a
+    // re-analysis the user asked for. "analysis/fastProbe" (default on) turns the
+    // fast tier off.
+    void analyzeFile(int index, const QString &filePath, bool deep = false);
     void analyzeFiles(const QStringList &files);
     void stop();
     
+    // Safe to call from any thread
     bool isAnalyzing() const { return m_analyzing; }
 
+    // Overrides the ffprobe found at construction (settings path, then PATH)
+    void setFFprobePath(const QString &path) { m_ffprobePath = path; }
+    QString ffprobePath() const { return m_ffprobePath; }
+
+    // Number of ffprobe processes run at the same time ("analysis/maxParallelProbes",
+    // default 1). With more than one, results arrive out of order; use the index.
+    void setMaxParallelProbes(int probes) { m_maxParallelProbes = qMax(1, probes); }
+    int maxParallelProbes() const { return m_maxParallelProbes; }
+
+    // Raw H.264/H.265 streams are scanned with NalIndex after ffprobe for their
+    // frame count and duration ("analysis/indexRawStreams", default true)
+    void setIndexRawStreams(bool enabled) { m_indexRawStreams = enabled; }
+
 signals:
+    // The fast tier's result for a file that is probed again; analysisFinished()
+    // follows with the refined one
+    void analysisPreliminary(int index, const MediaInfo &info);
     void analysisFinished(int index, const MediaInfo &info);
     void analysisError(int index, const QString &error);
     void allAnalysisFinished();
+    void logMessage(const QString &message);
 
 private slots:
     void processNextFile();
@@ -42,7 +79,9 @@ private slots:
     void onProbeError(QProcess::ProcessError error);
 
 private:
-    MediaInfo parseFFprobeOutput(const QString &output);
+    friend class ParserBench;   // bench/parsers
+
+    MediaInfo parseFFprobeOutput(const QByteArray &output);
     QString formatDuration(double seconds);
     QString formatFileSize(qint64 size);
     QString findFFprobeExecutable();
@@ -54,11 +93,24 @@ private:
     QString extractFpsFromName(const QString &name);
     QString bitDepthFromPixelFormat(const QString &pixFmt);
     
-    QProcess *m_probeProcess;
+    void startProbe(const AnalysisTask &task);
+    bool needsDeepProbe(const MediaInfo &info, bool rawStream) const;
+    void startIndex(const AnalysisTask &task, const MediaInfo &info);
+    void onIndexBuilt(const AnalysisTask &task, MediaInfo info, quint64 generation,
+                      const QSharedPointer<const NalIndex> &index, const QString &summary, qint64 startMs);
+
+    QHash<QProcess*, AnalysisTask> m_runningProbes;
     QQueue<AnalysisTask> m_taskQueue;
-    bool m_analyzing;
+    QQueue<AnalysisTask> m_deepQueue;   // run after m_taskQueue has drained
+    std::atomic<bool> m_analyzing;
+    int m_maxParallelProbes;
     QString m_ffprobePath;
-    AnalysisTask m_currentTask;
+    ProcessPolicy::Settings m_processSettings;  // nice/ionice/affinity for ffprobe children
+    bool m_fastProbe;
+    bool m_indexRawStreams;
+    QThreadPool m_indexPool;        // one thread: the scan is bound by disk bandwidth
+    int m_pendingIndexes;
+    quint64 m_generation;           // bumped by stop() so stale index results are dropped
 };
 
 #endif
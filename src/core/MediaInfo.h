@@ -0,0 +1,82 @@
+#ifndef MEDIAINFO_H
+#define MEDIAINFO_H
+
+#include <QString>
+#include <QSharedPointer>
+#include <QVector>
+#include "HdrMetadata.h"
+
+// One stream of a file as ffprobe reported it
+struct StreamInfo {
+    enum Type : quint8 { Video, Audio, Subtitle, Attachment, Data, Other };
+
+    int index = -1;               // input stream index, as in "-map 0:N"
+    Type type = Other;
+    bool isDefault = false;
+    bool isForced = false;
+    bool attachedPic = false;     // cover art carried as a video stream
+    QString codec;                // ffprobe codec name, e.g. "aac", "subrip"
+    QString language;             // ISO 639-2 tag, e.g. "eng"; empty if untagged
+    int channels = 0;             // audio only
+    int sampleRate = 0;           // audio only
+
+    // ffprobe's codec_type
+    static Type typeFromName(const QString &codecType)
+    {
+        if (codecType == QLatin1String("video")) return Video;
+        if (codecType == QLatin1String("audio")) return Audio;
+        if (codecType == QLatin1String("subtitle")) return Subtitle;
+        if (codecType == QLatin1String("attachment")) return Attachment;
+        if (codecType == QLatin1String("data")) return Data;
+        return Other;
+    }
+};
+
+struct MediaInfo {
+    QString videoCodec;
+    QString audioCodec;
+    QString resolution;
+    QString frameRate;
+    bool frameRateGuessed = false;  // ffprobe gave no usable rate; frameRate is a default
+    QString duration;
+    QString fileSize;
+    QString bitrate;
+    QString formatName;           // ffprobe's container name, e.g. "mpegts"
+    QString bitDepth;
+    QString colorSpace;
+    // HDR metadata (from ffprobe)
+    QString colorPrimariesCode;   // e.g., bt2020
+    QString colorTransferCode;    // e.g., smpte2084 (PQ), arib-std-b67 (HLG)
+    QString colorSpaceCode;       // e.g., bt2020nc
+    bool isHdr = false;           // true if transfer is PQ/HLG and primaries/matrix suggest HDR
+    QString hdrEotf;              // "PQ" or "HLG" when isHdr
+    bool hdrMetadataIncomplete = false; // true if HDR suspected but missing transfer or inconsistent
+    HdrMetadata hdrMetadata;      // mastering display/content light: container side data or SEI
+    bool isRawStream = false;
+    // From the NAL index of raw H.264/H.265 streams, -1 if not indexed
+    qint64 frameCount = -1;
+    int keyframeCount = -1;
+    QSharedPointer<const NalIndex> nalIndex;
+    // Every stream, in file order; the fields above describe the first video and
+    // the first audio stream. Empty when ffprobe did not run.
+    QVector<StreamInfo> streams;
+    int streamCount(StreamInfo::Type type) const
+    {
+        int count = 0;
+        for (const StreamInfo &stream : streams) {
+            count += stream.type == type ? 1 : 0;
+        }
+        return count;
+    }
+    // Per-row extraction range in seconds, -1 when unset; stream copy starts at
+    // the keyframe at or before inPoint
+    double inPoint = -1.0;
+    double outPoint = -1.0;
+    bool hasRange() const { return inPoint > 0.0 || outPoint > 0.0; }
+    bool analyzed = false;
+    // When ffprobe ran for this file (BatchMetrics::clockMs), -1 if not probed
+    qint64 probeStartMs = -1;
+    qint64 probeEndMs = -1;
+};
+
+#endif // MEDIAINFO_H
@@ -1,15 +1,28 @@
 #include "MuxingTask.h"
+#include "SeiInjector.h"
 #include <QRegularExpression>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
 
 MuxingTask::MuxingTask(QObject *parent)
     : QObject(parent)
     , m_process(nullptr)
     , m_progressTimer(new QTimer(this))
+    , m_workerSlot(0)
+    , m_lastReadBytes(0)
+    , m_inputSize(0)
+    , m_progressBoard(nullptr)
+    , m_progressJob(-1)
     , m_totalDuration(0)
     , m_currentTime(0)
+    , m_expectedFrames(-1)
+    , m_expectedDurationMs(-1)
+    , m_currentFrame(0)
     , m_durationParsed(false)
+    , m_finishReported(false)
+    , m_cancelled(false)
 {
     m_progressTimer->setSingleShot(false);
     m_progressTimer->setInterval(1000); // Update every second
@@ -23,12 +36,23 @@ MuxingTask::~MuxingTask()
         m_process->waitForFinished(3000);
         m_process->deleteLater();
     }
+    // Shutting down with a cancellation still in flight
+    if (m_cancelled && !m_finishReported) {
+        removePartialOutputs();
+    }
 }
 
 void MuxingTask::setFiles(const QString &inputFile, const QString &outputFile)
 {
     m_inputFile = inputFile;
     m_outputFile = outputFile;
+    m_timing.inputFile = inputFile;
+    m_timing.outputFile = outputFile;
+}
+
+void MuxingTask::setInputInjector(SeiInjector *injector)
+{
+    m_injector.reset(injector);
 }
 
 void MuxingTask::setCommandAndArgs(const QString &program, const QStringList &args)
@@ -47,47 +71,140 @@ void MuxingTask::start()
         connect(m_process, &QProcess::errorOccurred, this, &MuxingTask::onProcessError);
         connect(m_process, &QProcess::readyReadStandardError, this, &MuxingTask::onProcessReadyRead);
         connect(m_process, &QProcess::readyReadStandardOutput, this, &MuxingTask::onProcessReadyRead);
+        connect(m_process, &QProcess::bytesWritten, this, &MuxingTask::feedInput);
     }
 
+    m_finishReported = false;
+    m_cancelled = false;
+    m_startedAt = QDateTime::currentDateTime();
+    m_timing.spawnMs = BatchMetrics::clockMs();
+    m_timing.firstProgressMs = -1;
+    m_timing.muxEndMs = -1;
+    m_timing.postEndMs = -1;
+    m_lastReadBytes = 0;
+    m_inputSize = QFileInfo(m_inputFile).size();
+    publishProgress(ProgressBoard::Running);
+
     if (m_program.isEmpty()) {
+        m_finishReported = true;
+        recordCompletion(false);
         emit finished(false, "No FFmpeg program path specified");
         return;
     }
 
     m_accumulatedOutput.clear();
-    m_totalDuration = 0;
+    m_totalDuration = qMax<qint64>(0, m_expectedDurationMs);
     m_currentTime = 0;
-    m_durationParsed = false;
+    m_currentFrame = 0;
+    m_durationParsed = m_expectedDurationMs > 0;
 
 
     emit logMessage(QString("Starting FFmpeg: \"%1\" %2").arg(m_program).arg(m_arguments.join(" ")));
 
     m_elapsedTimer.start();
 
+    ProcessPolicy::apply(m_process, m_processSettings, m_workerSlot);
     m_process->start(m_program, m_arguments);
 
     if (!m_process->waitForStarted(5000)) {
-        emit finished(false, QString("Failed to start FFmpeg: %1").arg(m_process->errorString()));
+        // FailedToStart has usually been reported through onProcessError already
+        if (!m_finishReported) {
+            m_finishReported = true;
+            recordCompletion(false);
+            emit finished(false, QString("Failed to start FFmpeg: %1").arg(m_process->errorString()));
+        }
         return;
     }
 
+    m_cacheGovernor.begin(inputRanges(), m_outputFile, m_ioSettings);
+
+    m_inputError.clear();
+    feedInput();
+
     m_progressTimer->start();
 }
 
-void MuxingTask::stop()
+void MuxingTask::feedInput()
 {
-    if (m_process && m_process->state() == QProcess::Running) {
-        emit logMessage("Stopping FFmpeg process...");
-        m_process->terminate();
-        
-        // Give it a chance to terminate gracefully
-        if (!m_process->waitForFinished(3000)) {
+    // Keep a few MB queued on ffmpeg's stdin; bytesWritten() calls back as it drains
+    static const qint64 chunkBytes = 4 * 1024 * 1024;
+    if (!m_injector || !m_process || m_process->state() != QProcess::Running) {
+        return;
+    }
+    while (m_process->bytesToWrite() < chunkBytes) {
+        QByteArray chunk;
+        const bool more = m_injector->read(&chunk, chunkBytes);
+        if (!chunk.isEmpty()) {
+            m_process->write(chunk);
+        }
+        if (more) {
+            continue;
+        }
+        if (!m_injector->errorString().isEmpty()) {
+            // A truncated stream would still mux cleanly; fail the job instead
+            m_inputError = QString("Reading the input failed: %1").arg(m_injector->errorString());
             m_process->kill();
-            m_process->waitForFinished(1000);
+        } else {
+            emit logMessage(QString("HDR metadata SEI written before %1 keyframes, %2 SEI units replaced")
+                                .arg(m_injector->insertedCount()).arg(m_injector->replacedCount()));
+            m_process->closeWriteChannel();
         }
+        m_injector.reset();
+        return;
     }
-    
+}
+
+void MuxingTask::cancel(int killAfterMs)
+{
+    if (m_cancelled || m_finishReported) {
+        return;
+    }
+    m_cancelled = true;
     m_progressTimer->stop();
+    m_injector.reset();
+
+    if (!m_process || m_process->state() == QProcess::NotRunning) {
+        // Nothing to wait for; report after the caller has returned
+        QTimer::singleShot(0, this, &MuxingTask::finishCancel);
+        return;
+    }
+#ifdef Q_OS_WIN
+    m_process->kill();
+#else
+    m_process->terminate();
+#endif
+    // Escalate if ffmpeg ignores the request, e.g. blocked on a stalled input
+    QTimer::singleShot(killAfterMs, this, [this]() {
+        if (m_process && m_process->state() != QProcess::NotRunning) {
+            emit logMessage(QString("[WARN] FFmpeg for %1 did not exit within %2 ms, killing it")
+                                .arg(QFileInfo(m_inputFile).fileName()).arg(killAfterMs));
+            m_process->kill();
+        }
+    });
+}
+
+void MuxingTask::finishCancel()
+{
+    if (m_finishReported) {
+        return;
+    }
+    m_finishReported = true;
+    m_cacheGovernor.finish();
+    removePartialOutputs();
+    emit cancelled();
+}
+
+void MuxingTask::removePartialOutputs()
+{
+    // Only files this run has written to; an older output that ffmpeg never
+    // reached stays (one second of slack for coarse file system timestamps)
+    const QDateTime since = m_startedAt.addSecs(-1);
+    for (const QString &output : QStringList{m_outputFile} + m_extraOutputs) {
+        const QFileInfo info(output);
+        if (info.exists() && info.lastModified() >= since) {
+            QFile::remove(output);
+        }
+    }
 }
 
 bool MuxingTask::isRunning() const
@@ -98,12 +215,24 @@ bool MuxingTask::isRunning() const
 void MuxingTask::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
     // CRITICAL PATH: Handle FFmpeg process completion and determine success/failure
+    if (m_cancelled) {
+        finishCancel();
+        return;
+    }
+    if (m_finishReported) {
+        return;
+    }
+    m_finishReported = true;
     m_progressTimer->stop();
+    m_cacheGovernor.finish();
     
     QString message;
-    bool success = (exitCode == 0 && exitStatus == QProcess::NormalExit);
+    bool success = (exitCode == 0 && exitStatus == QProcess::NormalExit && m_inputError.isEmpty());
+    recordCompletion(success);
     
-    if (success) {
+    if (!m_inputError.isEmpty()) {
+        message = m_inputError;
+    } else if (success) {
         message = QString("FFmpeg completed successfully in %1 seconds")
                      .arg(m_elapsedTimer.elapsed() / 1000.0, 0, 'f', 1);
         emit progress(100); // Set to 100% on success
@@ -132,7 +261,21 @@ void MuxingTask::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus
 
 void MuxingTask::onProcessError(QProcess::ProcessError error)
 {
+    // Only FailedToStart ends the job here. After Crashed, QProcess also emits
+    // finished() with CrashExit, and read/write errors leave the process running.
+    if (error != QProcess::FailedToStart) {
+        if (error != QProcess::Crashed) {
+            emit logMessage(QString("[WARN] FFmpeg process I/O error: %1").arg(m_process->errorString()));
+        }
+        return;
+    }
+    if (m_finishReported) {
+        return;
+    }
+    m_finishReported = true;
     m_progressTimer->stop();
+    m_cacheGovernor.finish();
+    recordCompletion(false);
     
     QString errorString;
     switch (error) {
@@ -174,13 +317,45 @@ void MuxingTask::onProcessReadyRead()
     parseFFmpegOutput(output);
 }
 
+double MuxingTask::progressFraction() const
+{
+    if (m_totalDuration > 0) {
+        return qBound(0.0, double(m_currentTime) / m_totalDuration, 1.0);
+    }
+    if (m_expectedFrames > 0) {
+        // Raw streams: ffmpeg has no duration, but the index counted the frames
+        return qBound(0.0, double(m_currentFrame) / m_expectedFrames, 1.0);
+    }
+    if (m_inputSize > 0) {
+        // rchar also counts ffmpeg's own small reads, so never claim completion
+        return qBound(0.0, double(m_lastReadBytes) / m_inputSize, 0.99);
+    }
+    return 0.0;
+}
+
 void MuxingTask::checkProgress()
 {
     // This is called periodically to update progress even if no new output is available
-    if (m_totalDuration > 0 && m_currentTime > 0) {
-        int percentage = qMin(99, (int)((m_currentTime * 100) / m_totalDuration));
+    if ((m_totalDuration > 0 && m_currentTime > 0) || (m_expectedFrames > 0 && m_currentFrame > 0)) {
+        int percentage = qMin(99, (int)(progressFraction() * 100));
         emit progress(percentage);
     }
+
+    // Keep the page-cache footprint of this job bounded while it runs
+    if (m_process) {
+        const qint64 readBytes = IoPolicy::processReadBytes(m_process->processId());
+        m_lastReadBytes = qMax(m_lastReadBytes, readBytes);
+        m_cacheGovernor.update(readBytes);
+        publishProgress(ProgressBoard::Running);
+    }
+}
+
+void MuxingTask::publishProgress(ProgressBoard::State state)
+{
+    if (m_progressBoard) {
+        m_progressBoard->publish(m_progressJob, state,
+                                 state == ProgressBoard::Running ? progressFraction() : 1.0);
+    }
 }
 
 void MuxingTask::parseFFmpegOutput(const QString &output)
@@ -208,6 +383,10 @@ void MuxingTask::parseFFmpegOutput(const QString &output)
     QRegularExpression timeRegex(R"(time=(\d+):(\d+):(\d+)\.(\d+))");
     QRegularExpressionMatchIterator timeIterator = timeRegex.globalMatch(output);
     
+    if (m_timing.firstProgressMs < 0 && timeIterator.hasNext()) {
+        m_timing.firstProgressMs = BatchMetrics::clockMs();
+    }
+    
     while (timeIterator.hasNext()) {
         QRegularExpressionMatch timeMatch = timeIterator.next();
         int hours = timeMatch.captured(1).toInt();
@@ -218,6 +397,22 @@ void MuxingTask::parseFFmpegOutput(const QString &output)
         m_currentTime = hours * 3600 + minutes * 60 + seconds;
         m_currentTime = m_currentTime * 1000 + milliseconds; // Convert to milliseconds
     }
+
+    // Frame counter, the progress measure for inputs without a duration
+    if (m_expectedFrames > 0) {
+        static const QRegularExpression frameRegex(R"(frame=\s*(\d+))");
+        QRegularExpressionMatchIterator frameIterator = frameRegex.globalMatch(output);
+        while (frameIterator.hasNext()) {
+            m_currentFrame = frameIterator.next().captured(1).toLongLong();
+        }
+    }
+    publishProgress(ProgressBoard::Running);
+    
+    // With -movflags faststart the mp4 muxer rewrites the file after the last
+    // packet; everything from here to exit is post-processing.
+    if (m_timing.muxEndMs < 0 && output.contains("Starting second pass")) {
+        m_timing.muxEndMs = BatchMetrics::clockMs();
+    }
     
     // Look for error messages
     if (output.contains("Error", Qt::CaseInsensitive) || 
@@ -228,6 +423,26 @@ void MuxingTask::parseFFmpegOutput(const QString &output)
     }
 }
 
+void MuxingTask::recordCompletion(bool success)
+{
+    m_timing.postEndMs = BatchMetrics::clockMs();
+    publishProgress(success ? ProgressBoard::Succeeded : ProgressBoard::Failed);
+    if (m_timing.muxEndMs < 0) {
+        m_timing.muxEndMs = m_timing.postEndMs;
+    }
+    // /proc/<pid>/io is gone once the child exits; a successful job read its whole input
+    m_timing.bytesRead = m_lastReadBytes;
+    if (success) {
+        m_timing.bytesRead = qMax(m_timing.bytesRead, QFileInfo(m_inputFile).size());
+    }
+    QFileInfo output(m_outputFile);
+    m_timing.bytesWritten = output.exists() ? output.size() : 0;
+    for (const QString &extra : std::as_const(m_extraOutputs)) {
+        m_timing.bytesWritten += QFileInfo(extra).size();
+    }
+    m_timing.success = success;
+}
+
 QString MuxingTask::formatDuration(qint64 seconds)
 {
     qint64 hours = seconds / 3600;
@@ -9,6 +9,14 @@
 #include <QString>
 #include <QStringList>
 #include <QElapsedTimer>
+#include <QDateTime>
+#include <QScopedPointer>
+#include "IoPolicy.h"
+#include "ProcessPolicy.h"
+#include "ProgressBoard.h"
+#include "BatchMetrics.h"
+
+class SeiInjector;
 
 class MuxingTask : public QObject
 {
@@ -20,16 +28,66 @@ public:
 
     void setFiles(const QString &inputFile, const QString &outputFile);
     void setCommandAndArgs(const QString &program, const QStringList &args);
+    QStringList arguments() const { return m_arguments; }
+    void setIoPolicy(const IoPolicy::Settings &settings) { m_ioSettings = settings; }
+    // The bytes ffmpeg reads, in order, for the cache policy; the whole input unless
+    // set. An empty list means they are not known.
+    void setInputRanges(const QList<IoPolicy::FileRange> &ranges)
+    {
+        m_inputRanges = ranges;
+        m_inputRangesSet = true;
+    }
+    QList<IoPolicy::FileRange> inputRanges() const
+    {
+        return m_inputRangesSet ? m_inputRanges : QList<IoPolicy::FileRange>{{m_inputFile, 0, -1}};
+    }
+    // Applied to the ffmpeg child at start(); workerSlot selects its NUMA node
+    void setProcessPolicy(const ProcessPolicy::Settings &settings, int workerSlot)
+    {
+        m_processSettings = settings;
+        m_workerSlot = workerSlot;
+    }
 
     void start();
-    void stop();
+    // Asks ffmpeg to exit (SIGTERM; kill on Windows, where console processes ignore
+    // it) and kills it if it is still running after killAfterMs. Returns at once;
+    // cancelled() follows when the process has exited and its partial outputs are
+    // removed. finished() is not emitted for a cancelled run.
+    void cancel(int killAfterMs);
+    bool isCancelled() const { return m_cancelled; }
 
     bool isRunning() const;
+    qint64 processId() const { return m_process ? m_process->processId() : 0; }
     QString getInputFile() const { return m_inputFile; }
     QString getOutputFile() const { return m_outputFile; }
+    // Further containers written by the same ffmpeg run (tee muxer)
+    void setExtraOutputs(const QStringList &outputs) { m_extraOutputs = outputs; }
+    QStringList extraOutputs() const { return m_extraOutputs; }
+    // ffmpeg reads its input from stdin ("pipe:0"), produced by the injector as it
+    // drains; takes ownership
+    void setInputInjector(SeiInjector *injector);
+    qint64 inputBytesDropped() const { return m_cacheGovernor.inputBytesDropped(); }
+    qint64 outputBytesWrittenBack() const { return m_cacheGovernor.outputBytesWrittenBack(); }
+
+    // Slot this task publishes its progress to; the board outlives the task
+    void setProgressSlot(ProgressBoard *board, int job) { m_progressBoard = board; m_progressJob = job; }
+
+    // Phase timestamps; the owner fills in queued/probe times before start()
+    void setTiming(const JobTiming &timing) { m_timing = timing; }
+    JobTiming timing() const { return m_timing; }
+    qint64 bytesReadSoFar() const { return m_lastReadBytes; }
+    // Frames in the input when known up front (NalIndex for raw streams), -1 otherwise
+    void setExpectedFrames(qint64 frames) { m_expectedFrames = frames; }
+    // Length of the output when only a section is extracted; overrides the input
+    // duration ffmpeg reports. -1 to use ffmpeg's.
+    void setExpectedDurationMs(qint64 ms) { m_expectedDurationMs = ms; }
+    // 0..1 by media time when ffmpeg reported a duration, else by frames written
+    // against the expected count, else by input bytes read
+    double progressFraction() const;
 
 signals:
     void finished(bool success, const QString &message);
+    void cancelled();
     void logMessage(const QString &message);
     void progress(int percentage);
 
@@ -38,10 +96,17 @@ private slots:
     void onProcessError(QProcess::ProcessError error);
     void onProcessReadyRead();
     void checkProgress();
+    void feedInput();
 
 private:
+    friend class ParserBench;   // bench/parsers
+
     void parseFFmpegOutput(const QString &output);
     QString formatDuration(qint64 seconds);
+    void recordCompletion(bool success);
+    void publishProgress(ProgressBoard::State state);
+    void finishCancel();
+    void removePartialOutputs();
 
     QProcess *m_process;
     QTimer *m_progressTimer;
@@ -49,14 +114,38 @@ private:
 
     QString m_inputFile;
     QString m_outputFile;
+    QStringList m_extraOutputs;
+    QScopedPointer<SeiInjector> m_injector;
+    QString m_inputError;       // the injector failed; the job fails with this
 
     QString m_program;
     QStringList m_arguments;
 
+    IoPolicy::Settings m_ioSettings;
+    QList<IoPolicy::FileRange> m_inputRanges;
+    bool m_inputRangesSet = false;
+    CacheGovernor m_cacheGovernor;
+
+    ProcessPolicy::Settings m_processSettings;
+    int m_workerSlot;
+
+    JobTiming m_timing;
+    qint64 m_lastReadBytes;     // last /proc/<pid>/io sample while running
+    qint64 m_inputSize;
+
+    ProgressBoard *m_progressBoard;
+    int m_progressJob;
+
     QString m_accumulatedOutput;
     qint64 m_totalDuration;
     qint64 m_currentTime;
+    qint64 m_expectedFrames;
+    qint64 m_expectedDurationMs;
+    qint64 m_currentFrame;      // last frame= from ffmpeg's progress line
     bool m_durationParsed;
+    bool m_finishReported;      // finished() is emitted exactly once per start()
+    bool m_cancelled;
+    QDateTime m_startedAt;      // outputs modified since were written by this run
 };
 
 #endif // MUXINGTASK_H
@@ -0,0 +1,293 @@
+#include "NalIndex.h"
+#include "StartCodeScanner.h"
+#include "BatchMetrics.h"
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// What a NAL unit means for access-unit boundaries
+struct NalClass {
+    bool vcl = false;               // coded slice
+    bool firstSlice = false;        // first slice of a picture
+    bool keyframe = false;          // IDR (H.264) or IRAP (H.265)
+    bool opensUnit = false;         // non-VCL unit that can only precede a picture
+    bool parameterSet = false;      // SPS
+};
+
+NalClass classifyH264(const uchar *nal, const uchar *end)
+{
+    NalClass c;
+    const int type = nal[0] & 0x1f;
+    if (type >= 1 && type <= 5) {
+        c.vcl = true;
+        // first_mb_in_slice is ue(v); a leading 1 bit means 0
+        c.firstSlice = (nal + 1 < end) && (nal[1] & 0x80);
+        c.keyframe = (type == 5);
+    } else {
+        // SEI, SPS, PPS, AUD, prefix/subset SPS and reserved 16..18
+        c.opensUnit = (type >= 6 && type <= 9) || (type >= 14 && type <= 18);
+        c.parameterSet = (type == 7);
+    }
+    return c;
+}
+
+NalClass classifyH265(const uchar *nal, const uchar *end)
+{
+    NalClass c;
+    if (nal + 1 >= end) {
+        return c;
+    }
+    const int type = (nal[0] >> 1) & 0x3f;
+    const int layerId = ((nal[0] & 0x01) << 5) | (nal[1] >> 3);
+    if (layerId != 0) {
+        return c;                   // enhancement layers belong to the base-layer unit
+    }
+    if (type <= 31) {
+        c.vcl = true;
+        // first_slice_segment_in_pic_flag follows the two-byte header
+        c.firstSlice = (nal + 2 < end) && (nal[2] & 0x80);
+        c.keyframe = (type >= 16 && type <= 23);
+    } else {
+        // VPS, SPS, PPS, AUD, prefix SEI, reserved 41..44 and unspecified 48..55
+        c.opensUnit = (type >= 32 && type <= 35) || type == 39 || (type >= 41 && type <= 44) || (type >= 48 && type <= 55);
+        c.parameterSet = (type == 33);
+    }
+    return c;
+}
+
+} // namespace
+
+NalIndex::NalIndex()
+    : m_codec(Codec::Unknown)
+    , m_keyframes(0)
+    , m_headerBytes(0)
+    , m_scannedBytes(0)
+    , m_scanMs(0)
+{
+}
+
+bool NalIndex::build(const QString &filePath, Codec codec)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_error = file.errorString();
+        return false;
+    }
+    const qint64 size = file.size();
+    if (size <= 0) {
+        m_error = "Empty file";
+        return false;
+    }
+    uchar *data = file.map(0, size);
+    if (!data) {
+        m_error = QString("Cannot map file: %1").arg(file.errorString());
+        return false;
+    }
+#ifdef Q_OS_LINUX
+    // One front-to-back pass; let the kernel read ahead aggressively
+    madvise(data, size_t(size), MADV_SEQUENTIAL);
+#endif
+    if (codec == Codec::Unknown) {
+        codec = codecFromExtension(filePath);
+    }
+    const bool ok = build(data, size, codec);
+    file.unmap(data);
+    return ok;
+}
+
+bool NalIndex::build(const uchar *data, qint64 size, Codec codec)
+{
+    // CRITICAL PATH: one pass over the whole stream; keep per-NAL work minimal
+    const qint64 startMs = BatchMetrics::clockMs();
+    m_units.clear();
+    m_keyframes = 0;
+    m_headerBytes = 0;
+    m_error.clear();
+
+    if (codec == Codec::Unknown) {
+        codec = sniffCodec(data, size);
+    }
+    m_codec = codec;
+    if (codec == Codec::Unknown) {
+        m_error = "Not an H.264/H.265 Annex B stream";
+        return false;
+    }
+
+    const uchar *end = data + size;
+    // Offset of the first parameter set/SEI/delimiter since the last slice; the
+    // next picture's unit starts there
+    qint64 pendingStart = -1;
+    bool pendingParameterSets = false;
+    const uchar *p = StartCodeScanner::findNext(data, end);
+    while (p != end) {
+        const uchar *nal = p + 3;
+        if (nal >= end) {
+            break;
+        }
+        // Four-byte start codes: the unit starts at the leading zero
+        const qint64 offset = (p > data && p[-1] == 0) ? (p - 1 - data) : (p - data);
+        const NalClass c = (codec == Codec::H264) ? classifyH264(nal, end) : classifyH265(nal, end);
+        if (c.vcl) {
+            if (c.firstSlice) {
+                quint64 unit = quint64(pendingStart >= 0 ? pendingStart : offset);
+                if (pendingParameterSets) {
+                    unit |= ParameterSetsFlag;
+                }
+                if (c.keyframe) {
+                    unit |= KeyframeFlag;
+                    m_keyframes++;
+                }
+                if (m_units.isEmpty()) {
+                    m_headerBytes = offset;
+                }
+                m_units.append(unit);
+            }
+            pendingStart = -1;
+            pendingParameterSets = false;
+        } else if (c.opensUnit) {
+            if (pendingStart < 0) {
+                pendingStart = offset;
+            }
+            pendingParameterSets |= c.parameterSet;
+        }
+        p = StartCodeScanner::findNext(nal, end);
+    }
+
+    m_scannedBytes = size;
+    m_scanMs = BatchMetrics::clockMs() - startMs;
+    if (m_units.isEmpty()) {
+        m_error = "No coded pictures found";
+        return false;
+    }
+    return true;
+}
+
+QVector<qint64> NalIndex::keyframeOffsets() const
+{
+    QVector<qint64> offsets;
+    offsets.reserve(m_keyframes);
+    for (quint64 unit : m_units) {
+        if (unit & KeyframeFlag) {
+            offsets.append(qint64(unit & OffsetMask));
+        }
+    }
+    return offsets;
+}
+
+qint64 NalIndex::keyframeAtOrBefore(qint64 frame) const
+{
+    if (m_units.isEmpty()) {
+        return -1;
+    }
+    for (qint64 i = qMin<qint64>(frame, m_units.size() - 1); i >= 0; --i) {
+        if (m_units.at(int(i)) & KeyframeFlag) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+NalIndex::ByteRange NalIndex::rangeForFrames(qint64 inFrame, qint64 outFrame, qint64 fileSize) const
+{
+    ByteRange range;
+    const qint64 count = m_units.size();
+    if (count == 0) {
+        return range;
+    }
+    inFrame = qBound<qint64>(0, inFrame, count - 1);
+    outFrame = (outFrame < 0) ? count : qBound<qint64>(inFrame + 1, outFrame, count);
+
+    // Stream copy can only start on a keyframe; without one before inFrame, start
+    // at the beginning of the stream
+    range.firstFrame = qMax<qint64>(0, keyframeAtOrBefore(inFrame));
+    range.endFrame = outFrame;
+    range.begin = unitOffset(range.firstFrame);
+    range.end = (outFrame < count) ? unitOffset(outFrame) : fileSize;
+    range.needsHeader = range.firstFrame > 0 && !hasParameterSets(range.firstFrame);
+    return range;
+}
+
+double NalIndex::durationSeconds(double fps) const
+{
+    return fps > 0.0 ? double(m_units.size()) / fps : -1.0;
+}
+
+QString NalIndex::describe() const
+{
+    const double gb = double(m_scannedBytes) / (1024.0 * 1024.0 * 1024.0);
+    const double gbps = m_scanMs > 0 ? gb / (m_scanMs / 1000.0) : 0.0;
+    return QString("%1 frames, %2 keyframes, %3, %4 GB in %5 ms (%6 GB/s, %7)")
+        .arg(m_units.size())
+        .arg(m_keyframes)
+        .arg(codecName(m_codec))
+        .arg(gb, 0, 'f', 2)
+        .arg(m_scanMs)
+        .arg(gbps, 0, 'f', 1)
+        .arg(StartCodeScanner::name(StartCodeScanner::active()));
+}
+
+NalIndex::Codec NalIndex::codecFromExtension(const QString &filePath)
+{
+    const QString extension = QFileInfo(filePath).suffix().toLower();
+    if (extension == "h264" || extension == "264" || extension == "avc") {
+        return Codec::H264;
+    }
+    if (extension == "h265" || extension == "265" || extension == "hevc") {
+        return Codec::H265;
+    }
+    return Codec::Unknown;          // .bin and friends are sniffed
+}
+
+NalIndex::Codec NalIndex::codecFromName(const QString &name)
+{
+    const QString upper = name.toUpper();
+    if (upper.contains("HEVC") || upper.contains("265")) {
+        return Codec::H265;
+    }
+    if (upper.contains("H264") || upper.contains("H.264") || upper.contains("AVC")) {
+        return Codec::H264;
+    }
+    return Codec::Unknown;
+}
+
+const char *NalIndex::codecName(Codec codec)
+{
+    switch (codec) {
+    case Codec::H264: return "H.264";
+    case Codec::H265: return "H.265";
+    default: return "unknown";
+    }
+}
+
+NalIndex::Codec NalIndex::sniffCodec(const uchar *data, qint64 size)
+{
+    // Streams open with parameter sets or a delimiter. An H.265 header's second
+    // byte is almost always 0x01 (layer 0, temporal id 1), which H.264 SPS/PPS/AUD
+    // headers (0x67 0x4d.., 0x68 0xce.., 0x09 0xf0) never produce.
+    const uchar *end = data + qMin<qint64>(size, 64 * 1024);
+    const uchar *p = StartCodeScanner::findNext(data, end);
+    for (int checked = 0; p != end && checked < 8; ++checked) {
+        const uchar *nal = p + 3;
+        if (nal + 1 >= end) {
+            break;
+        }
+        if (!(nal[0] & 0x80)) {                 // forbidden_zero_bit
+            const int h265Type = (nal[0] >> 1) & 0x3f;
+            if (nal[1] == 0x01 && ((h265Type >= 32 && h265Type <= 35) || h265Type == 39 || h265Type <= 21)) {
+                return Codec::H265;
+            }
+            const int h264Type = nal[0] & 0x1f;
+            if (h264Type == 7 || h264Type == 9 || h264Type == 5) {
+                return Codec::H264;
+            }
+        }
+        p = StartCodeScanner::findNext(nal, end);
+    }
+    return Codec::Unknown;
+}
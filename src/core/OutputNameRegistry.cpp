@@ -0,0 +1,87 @@
+#include "OutputNameRegistry.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRegularExpression>
+
+OutputNameRegistry::OutputNameRegistry(bool overwrite)
+    : m_overwrite(overwrite)
+{
+}
+
+QString OutputNameRegistry::key(const QString &name) const
+{
+    // Names that differ only in case are the same file here
+#if defined(Q_OS_WIN) || defined(Q_OS_MACOS)
+    return name.toLower();
+#else
+    return name;
+#endif
+}
+
+bool OutputNameRegistry::isTaken(const QString &directory, const QString &fileName)
+{
+    const QString path = QDir(directory).absoluteFilePath(fileName);
+    if (m_reserved.contains(key(path))) {
+        return true;
+    }
+    if (m_overwrite) {
+        return false;
+    }
+    auto listing = m_listings.find(directory);
+    if (listing == m_listings.end()) {
+        QSet<QString> names;
+        const QStringList entries = QDir(directory).entryList(QDir::AllEntries | QDir::Hidden | QDir::System
+                                                              | QDir::NoDotAndDotDot, QDir::Unsorted);
+        for (const QString &entry : entries) {
+            names.insert(key(entry));
+        }
+        listing = m_listings.insert(directory, names);
+    }
+    return listing->contains(key(fileName));
+}
+
+QString OutputNameRegistry::reserve(const QString &directory, const std::function<QString(int)> &candidate)
+{
+    QMutexLocker locker(&m_mutex);
+    const QString absolute = QDir(directory).absolutePath();
+    int n = 0;
+    while (isTaken(absolute, candidate(n))) {
+        n++;
+    }
+    const QString path = QDir(absolute).absoluteFilePath(candidate(n));
+    m_reserved.insert(key(path));
+    return path;
+}
+
+void OutputNameRegistry::reservePath(const QString &filePath)
+{
+    QMutexLocker locker(&m_mutex);
+    m_reserved.insert(key(QFileInfo(filePath).absoluteFilePath()));
+}
+
+bool OutputNameRegistry::claim(const QString &filePath, bool *taken)
+{
+    QFile file(filePath);
+    // NewOnly is open(O_CREAT | O_EXCL): atomic against anyone creating the same name
+    if (file.open(QIODevice::WriteOnly | QIODevice::NewOnly)) {
+        *taken = false;
+        return true;
+    }
+    *taken = QFileInfo::exists(filePath);
+    return false;
+}
+
+QString OutputNameRegistry::numbered(const QString &fileName, int n)
+{
+    if (n == 0) {
+        return fileName;
+    }
+    static const QRegularExpression counter(R"(_\(\d+\)$)");
+    const QFileInfo info(fileName);
+    QString base = info.completeBaseName();
+    base.remove(counter);
+    const QString suffix = info.suffix();
+    return QString("%1_(%2)").arg(base).arg(n) + (suffix.isEmpty() ? QString() : "." + suffix);
+}
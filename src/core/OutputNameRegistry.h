@@ -0,0 +1,47 @@
+#ifndef OUTPUTNAMEREGISTRY_H
+#define OUTPUTNAMEREGISTRY_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <functional>
+
+// Output file names of one batch.
+//
+// Each destination directory is listed once, on first use, into a hash set, so
+// picking a free "_(N)" name costs no stat per candidate, also on network mounts.
+// Names handed out are reserved in memory: two jobs of the batch never get the
+// same one, even before either has written anything. claim() makes a reservation
+// binding on disk when its job starts, creating the file with O_EXCL, so a name
+// that another program or batch took after the listing is noticed rather than
+// overwritten. Safe to use from several threads.
+class OutputNameRegistry
+{
+public:
+    // With overwrite, files on disk do not make a name taken; reservations still do
+    explicit OutputNameRegistry(bool overwrite);
+
+    // First free name among candidate(0), candidate(1), ... in directory, reserved;
+    // its absolute path
+    QString reserve(const QString &directory, const std::function<QString(int)> &candidate);
+    // Reserves a path chosen elsewhere, e.g. the outputs of a loaded plan
+    void reservePath(const QString &filePath);
+
+    // Creates filePath empty, failing if anything exists there. *taken tells an
+    // existing file apart from other errors.
+    static bool claim(const QString &filePath, bool *taken);
+    // "name_(N).ext" from "name.ext" or "name_(M).ext"; n == 0 gives the name itself
+    static QString numbered(const QString &fileName, int n);
+
+private:
+    QString key(const QString &name) const;
+    bool isTaken(const QString &directory, const QString &fileName);
+
+    bool m_overwrite;
+    QMutex m_mutex;
+    QHash<QString, QSet<QString>> m_listings;   // directory -> names found there
+    QSet<QString> m_reserved;                   // keys of the paths handed out
+};
+
+#endif // OUTPUTNAMEREGISTRY_H
@@ -0,0 +1,253 @@
+#include "ProcessPolicy.h"
+#include <QDir>
+#include <QFile>
+#include <QProcess>
+#include <QSettings>
+#include <QStringList>
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_LINUX
+// From linux/ioprio.h and linux/mempolicy.h, which glibc does not wrap
+constexpr int kIoprioWhoProcess = 1;
+constexpr int kIoprioClassShift = 13;
+constexpr int kMpolPreferred = 1;
+
+int ioprioValue(int ioClass, int ioLevel)
+{
+    const int level = (ioClass == ProcessPolicy::IoClassIdle) ? 0 : qBound(0, ioLevel, 7);
+    return (ioClass << kIoprioClassShift) | level;
+}
+
+// Everything the child needs, computed in the parent: only syscalls run after fork
+struct ChildSetup {
+    bool setNice = false;
+    int niceLevel = 0;
+    bool setIoprio = false;
+    int ioprio = 0;
+    bool setAffinity = false;
+    cpu_set_t cpus;
+    bool setNode = false;
+    unsigned long nodeMask = 0;
+    rlim_t addressSpaceLimit = 0;
+};
+#endif
+
+QString ioClassName(int ioClass)
+{
+    switch (ioClass) {
+    case ProcessPolicy::IoClassRealtime: return "realtime";
+    case ProcessPolicy::IoClassBestEffort: return "best-effort";
+    case ProcessPolicy::IoClassIdle: return "idle";
+    default: return "inherit";
+    }
+}
+
+} // namespace
+
+ProcessPolicy::Settings ProcessPolicy::Settings::load()
+{
+    QSettings settings;
+    Settings s;
+    s.niceLevel = qBound(-20, settings.value("process/niceLevel", 0).toInt(), 19);
+    s.ioClass = qBound(0, settings.value("process/ioClass", int(IoClassInherit)).toInt(), 3);
+    s.ioLevel = qBound(0, settings.value("process/ioLevel", 4).toInt(), 7);
+    s.cpuList = settings.value("process/cpuList").toString().trimmed();
+    s.numaSplit = settings.value("process/numaSplit", false).toBool();
+    s.addressSpaceLimitBytes = qint64(qMax(0, settings.value("process/addressSpaceLimitMB", 0).toInt())) * 1024 * 1024;
+    return s;
+}
+
+void ProcessPolicy::apply(QProcess *process, const Settings &settings, int workerSlot)
+{
+#ifdef Q_OS_LINUX
+    ChildSetup setup;
+    CPU_ZERO(&setup.cpus);
+    setup.setNice = settings.niceLevel != 0;
+    setup.niceLevel = settings.niceLevel;
+    setup.setIoprio = settings.ioClass != IoClassInherit;
+    setup.ioprio = ioprioValue(settings.ioClass, settings.ioLevel);
+    setup.addressSpaceLimit = rlim_t(qMax<qint64>(0, settings.addressSpaceLimitBytes));
+
+    QVector<int> cpus = parseCpuList(settings.cpuList);
+    if (settings.numaSplit) {
+        const QVector<NumaNode> nodes = numaNodeCpus();
+        if (nodes.size() > 1) {
+            const NumaNode &node = nodes.at(qMax(0, workerSlot) % nodes.size());
+            QVector<int> nodeCpus = node.cpus;
+            if (!cpus.isEmpty()) {
+                // Restrict to the configured CPUs, unless that leaves the node empty
+                QVector<int> both;
+                for (int cpu : std::as_const(nodeCpus)) {
+                    if (cpus.contains(cpu)) {
+                        both.append(cpu);
+                    }
+                }
+                if (!both.isEmpty()) {
+                    nodeCpus = both;
+                }
+            }
+            cpus = nodeCpus;
+            if (node.id < int(sizeof(setup.nodeMask) * 8)) {
+                setup.setNode = true;
+                setup.nodeMask = 1UL << node.id;
+            }
+        }
+    }
+    for (int cpu : std::as_const(cpus)) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &setup.cpus);
+            setup.setAffinity = true;
+        }
+    }
+
+    if (!setup.setNice && !setup.setIoprio && !setup.setAffinity && !setup.setNode
+        && setup.addressSpaceLimit == 0) {
+        return;
+    }
+
+    // Failures are ignored: the child runs with the inherited setting
+    process->setChildProcessModifier([setup]() {
+        if (setup.setNice) {
+            ::setpriority(PRIO_PROCESS, 0, setup.niceLevel);
+        }
+        if (setup.setIoprio) {
+            ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, setup.ioprio);
+        }
+        if (setup.setAffinity) {
+            ::sched_setaffinity(0, sizeof(setup.cpus), &setup.cpus);
+        }
+        if (setup.setNode) {
+            // The kernel reads maxnode - 1 bits, hence the + 1 (as libnuma does)
+            ::syscall(SYS_set_mempolicy, kMpolPreferred, &setup.nodeMask, sizeof(setup.nodeMask) * 8 + 1);
+        }
+        if (setup.addressSpaceLimit > 0) {
+            struct rlimit limit;
+            limit.rlim_cur = setup.addressSpaceLimit;
+            limit.rlim_max = setup.addressSpaceLimit;
+            ::setrlimit(RLIMIT_AS, &limit);
+        }
+    });
+#else
+    Q_UNUSED(process); Q_UNUSED(settings); Q_UNUSED(workerSlot);
+#endif
+}
+
+bool ProcessPolicy::setPriority(qint64 pid, int niceLevel, int ioClass, int ioLevel)
+{
+#ifdef Q_OS_LINUX
+    if (pid <= 0) {
+        return false;
+    }
+    // Both nice and ioprio are per thread on Linux, and ffmpeg runs many
+    QStringList threads = QDir(QString("/proc/%1/task").arg(pid)).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    if (threads.isEmpty()) {
+        threads << QString::number(pid);
+    }
+    const int ioprio = ioprioValue(ioClass == IoClassInherit ? IoClassBestEffort : ioClass, ioLevel);
+    bool ok = true;
+    for (const QString &thread : std::as_const(threads)) {
+        const int tid = thread.toInt();
+        if (tid <= 0) {
+            continue;
+        }
+        if (::setpriority(PRIO_PROCESS, id_t(tid), qBound(-20, niceLevel, 19)) != 0) {
+            ok = false;
+        }
+        if (::syscall(SYS_ioprio_set, kIoprioWhoProcess, tid, ioprio) != 0) {
+            ok = false;
+        }
+    }
+    return ok;
+#else
+    Q_UNUSED(pid); Q_UNUSED(niceLevel); Q_UNUSED(ioClass); Q_UNUSED(ioLevel);
+    return false;
+#endif
+}
+
+QVector<int> ProcessPolicy::parseCpuList(const QString &list)
+{
+    QVector<int> cpus;
+    const QStringList parts = list.split(',', Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        const QStringList bounds = part.trimmed().split('-');
+        bool okFirst = false;
+        bool okLast = false;
+        const int first = bounds.at(0).toInt(&okFirst);
+        const int last = (bounds.size() == 2) ? bounds.at(1).toInt(&okLast) : first;
+        if (bounds.size() == 1) {
+            okLast = okFirst;
+        }
+        if (!okFirst || !okLast || first < 0 || last < first || bounds.size() > 2) {
+            continue;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            if (!cpus.contains(cpu)) {
+                cpus.append(cpu);
+            }
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
+QVector<ProcessPolicy::NumaNode> ProcessPolicy::numaNodeCpus()
+{
+    QVector<NumaNode> nodes;
+#ifdef Q_OS_LINUX
+    QDir nodeDir("/sys/devices/system/node");
+    const QStringList entries = nodeDir.entryList(QStringList() << "node*", QDir::Dirs);
+    for (const QString &entry : entries) {
+        bool ok = false;
+        NumaNode node;
+        node.id = entry.mid(4).toInt(&ok);
+        if (!ok || node.id < 0) {
+            continue;
+        }
+        QFile file(nodeDir.filePath(entry + "/cpulist"));
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            continue;
+        }
+        node.cpus = parseCpuList(QString::fromLatin1(file.readAll()).trimmed());
+        if (!node.cpus.isEmpty()) {     // memory-only nodes have no CPUs
+            nodes.append(node);
+        }
+    }
+    // node10 sorts before node2 as text
+    std::sort(nodes.begin(), nodes.end(), [](const NumaNode &a, const NumaNode &b) {
+        return a.id < b.id;
+    });
+#endif
+    return nodes;
+}
+
+QString ProcessPolicy::describe(const Settings &settings)
+{
+    QStringList parts;
+    parts << QString("nice %1").arg(settings.niceLevel);
+    if (settings.ioClass == IoClassInherit) {
+        parts << "I/O priority inherited";
+    } else if (settings.ioClass == IoClassIdle) {
+        parts << "I/O idle";
+    } else {
+        parts << QString("I/O %1/%2").arg(ioClassName(settings.ioClass)).arg(settings.ioLevel);
+    }
+    if (!settings.cpuList.isEmpty()) {
+        parts << QString("CPUs %1").arg(settings.cpuList);
+    }
+    if (settings.numaSplit) {
+        parts << "one NUMA node per worker";
+    }
+    if (settings.addressSpaceLimitBytes > 0) {
+        parts << QString("address space %1 MB").arg(settings.addressSpaceLimitBytes / (1024 * 1024));
+    }
+    return parts.join(", ");
+}
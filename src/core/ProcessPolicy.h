@@ -0,0 +1,61 @@
+#ifndef PROCESSPOLICY_H
+#define PROCESSPOLICY_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+class QProcess;
+
+// Scheduling limits for the ffmpeg/ffprobe children of a batch.
+//
+// A batch should not make the workstation it runs on unusable, nor starve other
+// work on a shared server. ProcessPolicy applies a nice level, an I/O priority
+// class, a CPU affinity mask (optionally one NUMA node per worker slot) and an
+// address-space cap to every child between fork and exec. Nice and I/O priority
+// can also be changed on running children. On other platforms every call is a no-op.
+class ProcessPolicy
+{
+public:
+    // Values match the kernel's IOPRIO_CLASS_* constants
+    enum IoClass {
+        IoClassInherit = 0,
+        IoClassRealtime = 1,
+        IoClassBestEffort = 2,
+        IoClassIdle = 3
+    };
+
+    struct NumaNode {
+        int id = -1;                                  // N of /sys/devices/system/node/nodeN
+        QVector<int> cpus;
+    };
+
+    struct Settings {
+        int niceLevel = 0;                            // -20..19, below 0 needs CAP_SYS_NICE
+        int ioClass = IoClassInherit;
+        int ioLevel = 4;                              // 0 (highest) .. 7, realtime/best-effort only
+        QString cpuList;                              // "0-7,16-23", empty to inherit
+        bool numaSplit = false;                       // worker slot N runs on the (N % nodes)th node with CPUs
+        qint64 addressSpaceLimitBytes = 0;            // RLIMIT_AS per child, 0 for no limit
+
+        static Settings load();                       // reads the "process/..." QSettings group
+    };
+
+    // Installs a child modifier on process; call before QProcess::start().
+    // workerSlot picks the NUMA node when numaSplit is set.
+    static void apply(QProcess *process, const Settings &settings, int workerSlot);
+
+    // Re-prioritises every thread of a running child. Returns false if the kernel
+    // refused any change, typically raising priority without CAP_SYS_NICE.
+    static bool setPriority(qint64 pid, int niceLevel, int ioClass, int ioLevel);
+
+    // "0-3,8,10-11" -> {0,1,2,3,8,10,11}; invalid ranges are skipped
+    static QVector<int> parseCpuList(const QString &list);
+    // NUMA nodes that have CPUs, by id, from /sys/devices/system/node. Ids can
+    // be sparse and skip memory-only nodes, so they are not list positions.
+    static QVector<NumaNode> numaNodeCpus();
+
+    static QString describe(const Settings &settings);
+};
+
+#endif // PROCESSPOLICY_H
@@ -0,0 +1,70 @@
+#include "ProgressBoard.h"
+
+namespace {
+
+quint32 pack(ProgressBoard::State state, int permille)
+{
+    return (quint32(state) << 16) | quint32(qBound(0, permille, 1000));
+}
+
+} // namespace
+
+ProgressBoard::ProgressBoard()
+    : m_totalWeight(0.0)
+    , m_size(0)
+{
+}
+
+void ProgressBoard::reset(const QVector<double> &weights)
+{
+    m_size = weights.size();
+    m_slots.reset(new std::atomic<quint32>[m_size]);
+    m_weights = weights;
+    m_totalWeight = 0.0;
+    for (int i = 0; i < m_size; ++i) {
+        m_slots[i].store(pack(Queued, 0), std::memory_order_relaxed);
+        // Zero-cost jobs still move the bar when they finish
+        m_weights[i] = qMax(1e-3, m_weights.at(i));
+        m_totalWeight += m_weights.at(i);
+    }
+}
+
+void ProgressBoard::publish(int job, State state, double fraction)
+{
+    if (job < 0 || job >= m_size) {
+        return;
+    }
+    // A single word per slot: readers never see a torn state/progress pair
+    m_slots[job].store(pack(state, qRound(fraction * 1000.0)), std::memory_order_relaxed);
+}
+
+ProgressBoard::Entry ProgressBoard::read(int job) const
+{
+    Entry entry;
+    if (job < 0 || job >= m_size) {
+        return entry;
+    }
+    const quint32 value = m_slots[job].load(std::memory_order_relaxed);
+    entry.state = State(value >> 16);
+    entry.permille = int(value & 0xffff);
+    return entry;
+}
+
+quint32 ProgressBoard::rawValue(int job) const
+{
+    return (job >= 0 && job < m_size) ? m_slots[job].load(std::memory_order_relaxed) : 0;
+}
+
+double ProgressBoard::overallFraction() const
+{
+    if (m_totalWeight <= 0.0) {
+        return 0.0;
+    }
+    double done = 0.0;
+    for (int i = 0; i < m_size; ++i) {
+        const Entry entry = read(i);
+        const bool finished = (entry.state == Succeeded || entry.state == Failed);
+        done += m_weights.at(i) * (finished ? 1.0 : entry.permille / 1000.0);
+    }
+    return done / m_totalWeight;
+}
@@ -0,0 +1,52 @@
+#ifndef PROGRESSBOARD_H
+#define PROGRESSBOARD_H
+
+#include <QVector>
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+
+// Per-job progress shared between the jobs and the UI.
+//
+// Each job owns one slot and overwrites it as often as it likes; the UI reads all
+// slots on a fixed timer instead of receiving a signal per update, so the cost on
+// the GUI thread is bounded by the refresh rate, not by the number of jobs or how
+// chatty ffmpeg is. A slot is a single atomic word, so publish() and read() are
+// wait-free from any thread.
+class ProgressBoard
+{
+public:
+    enum State : quint8 {
+        Idle = 0,
+        Queued,
+        Running,
+        Succeeded,
+        Failed
+    };
+
+    struct Entry {
+        State state = Idle;
+        int permille = 0;           // 0..1000
+    };
+
+    ProgressBoard();
+
+    // One slot per job, weighted for the overall fraction. Call while no job publishes.
+    void reset(const QVector<double> &weights);
+    int size() const { return m_size; }
+
+    void publish(int job, State state, double fraction);
+    Entry read(int job) const;
+    quint32 rawValue(int job) const;    // packed slot, for cheap change detection
+
+    // Weighted completion of the whole batch; finished jobs count as complete
+    double overallFraction() const;
+
+private:
+    std::unique_ptr<std::atomic<quint32>[]> m_slots;   // state << 16 | permille
+    QVector<double> m_weights;
+    double m_totalWeight;
+    int m_size;
+};
+
+#endif // PROGRESSBOARD_H
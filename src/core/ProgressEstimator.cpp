@@ -0,0 +1,117 @@
+#include "ProgressEstimator.h"
+#include "BatchMetrics.h"
+#include <cmath>
+
+namespace {
+
+constexpr qint64 kWindowMs = 180000;        // rate is judged on the last three minutes
+constexpr qint64 kRateSpanMs = 5000;        // each rate sample covers at least this long
+constexpr qint64 kTrustAfterMs = 60000;     // observed rate fully replaces the prior after this
+constexpr double kPriorSpread = 0.5;        // relative band while relying on the cost model
+
+} // namespace
+
+ProgressEstimator::ProgressEstimator()
+    : m_totalWork(0.0)
+    , m_priorRate(1.0)
+{
+}
+
+void ProgressEstimator::begin(double totalWork, int parallelism)
+{
+    m_totalWork = qMax(0.0, totalWork);
+    m_priorRate = qMax(1, parallelism);
+    m_samples.clear();
+    sample(0.0);
+}
+
+void ProgressEstimator::sample(double completedWork)
+{
+    const qint64 nowMs = BatchMetrics::clockMs();
+    m_samples.append({nowMs, completedWork});
+    int drop = 0;
+    while (drop < m_samples.size() - 2 && m_samples.at(drop).ms < nowMs - kWindowMs) {
+        drop++;
+    }
+    m_samples.remove(0, drop);
+}
+
+ProgressEstimator::Estimate ProgressEstimator::estimate() const
+{
+    Estimate result;
+    if (m_samples.isEmpty() || m_totalWork <= 0.0) {
+        return result;
+    }
+    const Sample &last = m_samples.last();
+    result.fraction = qBound(0.0, last.work / m_totalWork, 1.0);
+    const double remaining = qMax(0.0, m_totalWork - last.work);
+    if (remaining <= 0.0) {
+        result.etaMs = result.etaLowMs = result.etaHighMs = 0;
+        return result;
+    }
+
+    // Rates over consecutive spans of the window
+    QVector<double> rates;
+    int from = 0;
+    for (int i = 1; i < m_samples.size(); ++i) {
+        const qint64 span = m_samples.at(i).ms - m_samples.at(from).ms;
+        if (span >= kRateSpanMs) {
+            rates.append((m_samples.at(i).work - m_samples.at(from).work) * 1000.0 / span);
+            from = i;
+        }
+    }
+
+    double observed = m_priorRate;
+    double spread = kPriorSpread;
+    if (!rates.isEmpty()) {
+        double sum = 0.0;
+        for (double rate : std::as_const(rates)) {
+            sum += rate;
+        }
+        observed = sum / rates.size();
+        double variance = 0.0;
+        for (double rate : std::as_const(rates)) {
+            variance += (rate - observed) * (rate - observed);
+        }
+        spread = (observed > 0.0) ? std::sqrt(variance / rates.size()) / observed : kPriorSpread;
+    }
+
+    // Blend towards the observed rate as the window fills
+    const double trust = rates.isEmpty()
+        ? 0.0
+        : qMin(1.0, double(last.ms - m_samples.first().ms) / kTrustAfterMs);
+    const double rate = trust * observed + (1.0 - trust) * m_priorRate;
+    const double band = qBound(0.05, trust * spread + (1.0 - trust) * kPriorSpread, 0.8);
+    if (rate <= 0.0) {
+        return result;      // stalled: no honest ETA
+    }
+
+    result.etaMs = qint64(remaining / rate * 1000.0);
+    result.etaLowMs = qint64(remaining / (rate * (1.0 + band)) * 1000.0);
+    result.etaHighMs = qint64(remaining / (rate * (1.0 - band)) * 1000.0);
+    return result;
+}
+
+QString ProgressEstimator::formatDuration(qint64 ms)
+{
+    const qint64 seconds = qMax<qint64>(0, ms / 1000);
+    if (seconds >= 3600) {
+        return QString("%1h %2m").arg(seconds / 3600).arg((seconds % 3600) / 60, 2, 10, QChar('0'));
+    }
+    if (seconds >= 60) {
+        return QString("%1m %2s").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+    }
+    return QString("%1s").arg(seconds);
+}
+
+QString ProgressEstimator::describe(const Estimate &estimate)
+{
+    QString text = QString("%1%").arg(estimate.fraction * 100.0, 0, 'f', 1);
+    if (estimate.etaMs >= 0) {
+        text += QString(", ETA %1 (%2 - %3)")
+                    .arg(formatDuration(estimate.etaMs))
+                    .arg(formatDuration(estimate.etaLowMs))
+                    .arg(formatDuration(estimate.etaHighMs));
+    }
+    return text;
+}
@@ -0,0 +1,50 @@
+#ifndef PROGRESSESTIMATOR_H
+#define PROGRESSESTIMATOR_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// Overall batch progress and ETA.
+//
+// Work is measured in estimated job-seconds from CostModel, which already weighs
+// each job by its size, duration and kind, and by the learned throughput of its
+// codec. Progress is the completed share of that work. The ETA divides the work
+// left by the rate the batch has actually achieved over the last minutes; until
+// enough samples exist it leans on the cost model's own prediction, with a wider
+// band. The band is the spread of the observed rate.
+class ProgressEstimator
+{
+public:
+    struct Estimate {
+        double fraction = 0.0;      // 0..1
+        qint64 etaMs = -1;          // -1 while unknown
+        qint64 etaLowMs = -1;
+        qint64 etaHighMs = -1;
+    };
+
+    ProgressEstimator();
+
+    // totalWork in estimated job-seconds; parallelism is how many jobs run at once
+    void begin(double totalWork, int parallelism);
+    // Work that joined the batch after begin()
+    void addWork(double work) { m_totalWork += qMax(0.0, work); }
+    // Records the completed work at the current time; call about once a second
+    void sample(double completedWork);
+    Estimate estimate() const;
+
+    static QString formatDuration(qint64 ms);
+    static QString describe(const Estimate &estimate);   // "42.0%, ETA 12m 30s (9m 10s - 16m 00s)"
+
+private:
+    struct Sample {
+        qint64 ms;
+        double work;
+    };
+
+    double m_totalWork;
+    double m_priorRate;             // job-seconds per second expected from the cost model
+    QVector<Sample> m_samples;      // sliding window, oldest first
+};
+
+#endif // PROGRESSESTIMATOR_H
@@ -0,0 +1,130 @@
+#include "SeiInjector.h"
+#include "StartCodeScanner.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// First slice of an IDR (H.264) or IRAP (H.265) picture in the base layer
+bool opensKeyframe(const uchar *nal, const uchar *end, NalIndex::Codec codec)
+{
+    if (codec == NalIndex::Codec::H265) {
+        const int type = (nal[0] >> 1) & 0x3f;
+        const bool baseLayer = (nal + 1 < end) && (nal[0] & 0x01) == 0 && (nal[1] >> 3) == 0;
+        return type >= 16 && type <= 23 && baseLayer && (nal + 2 < end) && (nal[2] & 0x80);
+    }
+    return (nal[0] & 0x1f) == 5 && (nal + 1 < end) && (nal[1] & 0x80);
+}
+
+} // namespace
+
+SeiInjector::SeiInjector(const QList<Segment> &segments, NalIndex::Codec codec, const HdrMetadata &metadata)
+    : m_segments(segments)
+    , m_codec(codec)
+    , m_seiNal(metadata.seiNal(codec))
+    , m_data(nullptr)
+    , m_size(0)
+    , m_pos(0)
+    , m_nextSegment(0)
+    , m_inserted(0)
+    , m_replaced(0)
+{
+}
+
+SeiInjector::~SeiInjector()
+{
+    closeSegment();
+}
+
+bool SeiInjector::openSegment()
+{
+    const Segment &segment = m_segments.at(m_nextSegment++);
+    m_file.setFileName(segment.file);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = QString("%1: %2").arg(segment.file, m_file.errorString());
+        return false;
+    }
+    m_size = segment.end - segment.begin;
+    m_pos = 0;
+    if (m_size <= 0) {
+        return true;
+    }
+    m_data = m_file.map(segment.begin, m_size);
+    if (!m_data) {
+        m_error = QString("%1: cannot map file: %2").arg(segment.file, m_file.errorString());
+        return false;
+    }
+#ifdef Q_OS_LINUX
+    madvise(const_cast<uchar *>(m_data), size_t(m_size), MADV_SEQUENTIAL);
+#endif
+    return true;
+}
+
+void SeiInjector::closeSegment()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+        m_data = nullptr;
+    }
+    m_file.close();
+    m_size = 0;
+    m_pos = 0;
+}
+
+bool SeiInjector::read(QByteArray *out, qint64 chunkBytes)
+{
+    // CRITICAL PATH: runs over the whole stream; copies are per NAL unit
+    const qint64 target = out->size() + chunkBytes;
+    while (out->size() < target) {
+        if (m_pos >= m_size) {
+            closeSegment();
+            if (m_nextSegment >= m_segments.size()) {
+                return false;
+            }
+            if (!openSegment()) {
+                return false;
+            }
+            continue;
+        }
+
+        const uchar *data = m_data;
+        const uchar *end = data + m_size;
+        const uchar *p = StartCodeScanner::findNext(data + m_pos, end);
+        if (p == end) {
+            out->append(reinterpret_cast<const char *>(data + m_pos), int(end - (data + m_pos)));
+            m_pos = m_size;
+            continue;
+        }
+        // Bytes before the start code: leading zeros, or the fourth byte of a start code
+        if (p > data + m_pos) {
+            out->append(reinterpret_cast<const char *>(data + m_pos), int(p - (data + m_pos)));
+        }
+        const uchar *nal = p + 3;
+        const uchar *next = (nal < end) ? StartCodeScanner::findNext(nal, end) : end;
+        m_pos = next - data;
+        if (nal >= end) {
+            out->append(reinterpret_cast<const char *>(p), int(end - p));
+            continue;
+        }
+
+        if (opensKeyframe(nal, end, m_codec)) {
+            out->append(m_seiNal);
+            m_inserted++;
+        } else if (HdrMetadata::isSeiNal(nal, m_codec)) {
+            bool changed = false;
+            const QByteArray stripped = HdrMetadata::stripSei(nal, next - nal, m_codec, &changed);
+            if (changed) {
+                m_replaced++;
+                if (!stripped.isEmpty()) {
+                    out->append(reinterpret_cast<const char *>(p), 3);
+                    out->append(stripped);
+                }
+                continue;
+            }
+        }
+        out->append(reinterpret_cast<const char *>(p), int(next - p));
+    }
+    return true;
+}
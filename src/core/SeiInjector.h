@@ -0,0 +1,54 @@
+#ifndef SEIINJECTOR_H
+#define SEIINJECTOR_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include "HdrMetadata.h"
+#include "NalIndex.h"
+
+// Rewrites a raw H.264/H.265 stream with new HDR static metadata, for ffmpeg to
+// read from a pipe while it stream-copies. An SEI NAL unit with the mastering
+// display and content light messages goes in front of the first slice of every
+// keyframe, and those messages are removed from the stream's own SEI. Everything
+// else passes through byte for byte, so the cost is one sequential read.
+class SeiInjector
+{
+public:
+    // Byte range of a file; ranges start on access-unit boundaries
+    struct Segment {
+        QString file;
+        qint64 begin = 0;
+        qint64 end = 0;
+    };
+
+    SeiInjector(const QList<Segment> &segments, NalIndex::Codec codec, const HdrMetadata &metadata);
+    ~SeiInjector();
+
+    // Appends at least chunkBytes of the rewritten stream to out (less at the end).
+    // False once the stream is complete or on a read error; check errorString().
+    bool read(QByteArray *out, qint64 chunkBytes);
+    QString errorString() const { return m_error; }
+
+    int insertedCount() const { return m_inserted; }
+    int replacedCount() const { return m_replaced; }
+
+private:
+    bool openSegment();
+    void closeSegment();
+
+    QList<Segment> m_segments;
+    NalIndex::Codec m_codec;
+    QByteArray m_seiNal;
+    QFile m_file;
+    const uchar *m_data;            // mapped current segment
+    qint64 m_size;
+    qint64 m_pos;
+    int m_nextSegment;
+    int m_inserted;
+    int m_replaced;
+    QString m_error;
+};
+
+#endif // SEIINJECTOR_H
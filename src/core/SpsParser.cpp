@@ -0,0 +1,323 @@
+#include "SpsParser.h"
+#include "StartCodeScanner.h"
+#include <QFile>
+#include <QVarLengthArray>
+
+namespace {
+
+// MSB-first reader over an RBSP; reads past the end return zeros and set overrun
+class BitReader
+{
+public:
+    BitReader(const uchar *data, int size) : m_data(data), m_bits(qint64(size) * 8), m_pos(0), m_overrun(false) {}
+
+    quint32 bits(int count)
+    {
+        quint32 value = 0;
+        for (int i = 0; i < count; ++i) {
+            value = (value << 1) | bit();
+        }
+        return value;
+    }
+
+    quint32 bit()
+    {
+        if (m_pos >= m_bits) {
+            m_overrun = true;
+            return 0;
+        }
+        const quint32 value = (m_data[m_pos >> 3] >> (7 - (m_pos & 7))) & 1;
+        m_pos++;
+        return value;
+    }
+
+    void skip(int count) { m_pos += count; m_overrun |= m_pos > m_bits; }
+
+    // Exp-Golomb ue(v); values wider than 31 bits only occur in corrupt data
+    quint32 ue()
+    {
+        int zeros = 0;
+        while (bit() == 0) {
+            if (++zeros > 31 || m_overrun) {
+                m_overrun = true;
+                return 0;
+            }
+        }
+        return ((quint32(1) << zeros) - 1) + bits(zeros);
+    }
+
+    qint32 se()
+    {
+        const quint32 code = ue();
+        return (code & 1) ? qint32((code + 1) / 2) : -qint32(code / 2);
+    }
+
+    bool overrun() const { return m_overrun; }
+
+private:
+    const uchar *m_data;
+    qint64 m_bits;
+    qint64 m_pos;
+    bool m_overrun;
+};
+
+// SPS payloads are short; unescape() stops at 4 KB, past the largest scaling lists
+using Rbsp = QVarLengthArray<uchar, 512>;
+
+void unescape(const uchar *data, qint64 size, Rbsp *rbsp)
+{
+    int zeros = 0;
+    for (qint64 i = 0; i < size && rbsp->size() < 4096; ++i) {
+        const uchar byte = data[i];
+        if (zeros >= 2 && byte == 0x03) {
+            zeros = 0;                      // emulation prevention byte
+            continue;
+        }
+        zeros = (byte == 0) ? zeros + 1 : 0;
+        rbsp->append(byte);
+    }
+}
+
+void skipScalingList(BitReader &reader, int size)
+{
+    int lastScale = 8;
+    int nextScale = 8;
+    for (int j = 0; j < size && nextScale != 0; ++j) {
+        nextScale = (lastScale + reader.se() + 256) % 256;
+        lastScale = (nextScale == 0) ? lastScale : nextScale;
+    }
+}
+
+void parseH264(BitReader &reader, SpsInfo *info)
+{
+    info->profile = int(reader.bits(8));
+    reader.skip(8);                         // constraint_set flags
+    info->level = int(reader.bits(8));
+    reader.ue();                            // seq_parameter_set_id
+
+    info->chromaFormat = 1;
+    info->bitDepth = 8;
+    switch (info->profile) {
+    case 100: case 110: case 122: case 244: case 44: case 83:
+    case 86: case 118: case 128: case 138: case 139: case 134: case 135: {
+        info->chromaFormat = int(reader.ue());
+        if (info->chromaFormat == 3) {
+            reader.skip(1);                 // separate_colour_plane_flag
+        }
+        info->bitDepth = 8 + int(reader.ue());
+        reader.ue();                        // bit_depth_chroma_minus8
+        reader.skip(1);                     // qpprime_y_zero_transform_bypass_flag
+        if (reader.bit()) {                 // seq_scaling_matrix_present_flag
+            const int lists = (info->chromaFormat == 3) ? 12 : 8;
+            for (int i = 0; i < lists; ++i) {
+                if (reader.bit()) {
+                    skipScalingList(reader, i < 6 ? 16 : 64);
+                }
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    reader.ue();                            // log2_max_frame_num_minus4
+    const quint32 pocType = reader.ue();
+    if (pocType == 0) {
+        reader.ue();                        // log2_max_pic_order_cnt_lsb_minus4
+    } else if (pocType == 1) {
+        reader.skip(1);                     // delta_pic_order_always_zero_flag
+        reader.se();                        // offset_for_non_ref_pic
+        reader.se();                        // offset_for_top_to_bottom_field
+        const quint32 cycle = reader.ue();
+        for (quint32 i = 0; i < cycle && !reader.overrun(); ++i) {
+            reader.se();
+        }
+    }
+    reader.ue();                            // max_num_ref_frames
+    reader.skip(1);                         // gaps_in_frame_num_value_allowed_flag
+    const int widthInMbs = int(reader.ue()) + 1;
+    const int heightInMapUnits = int(reader.ue()) + 1;
+    const int frameMbsOnly = int(reader.bit());
+    if (!frameMbsOnly) {
+        reader.skip(1);                     // mb_adaptive_frame_field_flag
+    }
+    reader.skip(1);                         // direct_8x8_inference_flag
+
+    int cropX = 0;
+    int cropY = 0;
+    if (reader.bit()) {                     // frame_cropping_flag
+        const int left = int(reader.ue());
+        const int right = int(reader.ue());
+        const int top = int(reader.ue());
+        const int bottom = int(reader.ue());
+        // Crop units are chroma samples, and field pairs for interlaced streams
+        const int unitX = (info->chromaFormat == 1 || info->chromaFormat == 2) ? 2 : 1;
+        const int unitY = ((info->chromaFormat == 1) ? 2 : 1) * (2 - frameMbsOnly);
+        cropX = unitX * (left + right);
+        cropY = unitY * (top + bottom);
+    }
+    info->width = widthInMbs * 16 - cropX;
+    info->height = (2 - frameMbsOnly) * heightInMapUnits * 16 - cropY;
+}
+
+void parseH265(BitReader &reader, SpsInfo *info)
+{
+    reader.skip(4);                         // sps_video_parameter_set_id
+    const int maxSubLayersMinus1 = int(reader.bits(3));
+    reader.skip(1);                         // sps_temporal_id_nesting_flag
+
+    // profile_tier_level(1, sps_max_sub_layers_minus1)
+    reader.skip(3);                         // general_profile_space, general_tier_flag
+    info->profile = int(reader.bits(5));
+    reader.skip(32 + 48);                   // compatibility flags, constraint flags
+    info->level = int(reader.bits(8));
+    bool profilePresent[8] = {};
+    bool levelPresent[8] = {};
+    for (int i = 0; i < maxSubLayersMinus1; ++i) {
+        profilePresent[i] = reader.bit();
+        levelPresent[i] = reader.bit();
+    }
+    if (maxSubLayersMinus1 > 0) {
+        reader.skip(2 * (8 - maxSubLayersMinus1));
+    }
+    for (int i = 0; i < maxSubLayersMinus1; ++i) {
+        reader.skip((profilePresent[i] ? 88 : 0) + (levelPresent[i] ? 8 : 0));
+    }
+
+    reader.ue();                            // sps_seq_parameter_set_id
+    info->chromaFormat = int(reader.ue());
+    if (info->chromaFormat == 3) {
+        reader.skip(1);                     // separate_colour_plane_flag
+    }
+    int width = int(reader.ue());
+    int height = int(reader.ue());
+    if (reader.bit()) {                     // conformance_window_flag
+        const int left = int(reader.ue());
+        const int right = int(reader.ue());
+        const int top = int(reader.ue());
+        const int bottom = int(reader.ue());
+        const int unitX = (info->chromaFormat == 1 || info->chromaFormat == 2) ? 2 : 1;
+        const int unitY = (info->chromaFormat == 1) ? 2 : 1;
+        width -= unitX * (left + right);
+        height -= unitY * (top + bottom);
+    }
+    info->width = width;
+    info->height = height;
+    info->bitDepth = 8 + int(reader.ue());
+}
+
+QString profileName(NalIndex::Codec codec, int profile)
+{
+    if (codec == NalIndex::Codec::H264) {
+        switch (profile) {
+        case 66: return "Baseline";
+        case 77: return "Main";
+        case 88: return "Extended";
+        case 100: return "High";
+        case 110: return "High 10";
+        case 122: return "High 4:2:2";
+        case 244: return "High 4:4:4";
+        default: break;
+        }
+    } else if (codec == NalIndex::Codec::H265) {
+        switch (profile) {
+        case 1: return "Main";
+        case 2: return "Main 10";
+        case 3: return "Main Still Picture";
+        case 4: return "Range Extensions";
+        default: break;
+        }
+    }
+    return QString("profile %1").arg(profile);
+}
+
+} // namespace
+
+bool SpsInfo::isCompatibleWith(const SpsInfo &other) const
+{
+    return codec == other.codec && profile == other.profile && chromaFormat == other.chromaFormat
+        && bitDepth == other.bitDepth && width == other.width && height == other.height;
+}
+
+QString SpsInfo::describe() const
+{
+    static const char *const chroma[] = {"4:0:0", "4:2:0", "4:2:2", "4:4:4"};
+    // H.264 levels are level*10 (51 = 5.1), H.265 levels level*30 (153 = 5.1)
+    const double levelNumber = (codec == NalIndex::Codec::H265) ? level / 30.0 : level / 10.0;
+    return QString("%1 %2, %3x%4, %5 %6-bit, level %7")
+        .arg(NalIndex::codecName(codec), profileName(codec, profile))
+        .arg(width).arg(height)
+        .arg(chromaFormat >= 0 && chromaFormat <= 3 ? chroma[chromaFormat] : "?")
+        .arg(bitDepth)
+        .arg(levelNumber, 0, 'f', 1);
+}
+
+bool SpsParser::parse(const uchar *nal, qint64 size, NalIndex::Codec codec, SpsInfo *info)
+{
+    const int headerBytes = (codec == NalIndex::Codec::H265) ? 2 : 1;
+    if (codec == NalIndex::Codec::Unknown || size <= headerBytes) {
+        return false;
+    }
+    Rbsp rbsp;
+    unescape(nal + headerBytes, size - headerBytes, &rbsp);
+    BitReader reader(rbsp.constData(), rbsp.size());
+
+    SpsInfo parsed;
+    parsed.codec = codec;
+    if (codec == NalIndex::Codec::H264) {
+        parseH264(reader, &parsed);
+    } else {
+        parseH265(reader, &parsed);
+    }
+    if (reader.overrun() || !parsed.isValid()) {
+        return false;
+    }
+    *info = parsed;
+    return true;
+}
+
+bool SpsParser::parseFile(const QString &filePath, SpsInfo *info, QString *error,
+                          NalIndex::Codec codec, qint64 maxBytes)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    const QByteArray head = file.read(maxBytes);
+    const uchar *data = reinterpret_cast<const uchar *>(head.constData());
+    const uchar *end = data + head.size();
+    if (codec == NalIndex::Codec::Unknown) {
+        codec = NalIndex::codecFromExtension(filePath);
+    }
+    if (codec == NalIndex::Codec::Unknown) {
+        codec = NalIndex::sniffCodec(data, head.size());
+    }
+    if (codec == NalIndex::Codec::Unknown) {
+        *error = "not an H.264/H.265 Annex B stream";
+        return false;
+    }
+
+    const uchar *p = StartCodeScanner::findNext(data, end);
+    while (p != end) {
+        const uchar *nal = p + 3;
+        if (nal >= end) {
+            break;
+        }
+        const uchar *next = StartCodeScanner::findNext(nal, end);
+        const int type = (codec == NalIndex::Codec::H265) ? ((nal[0] >> 1) & 0x3f) : (nal[0] & 0x1f);
+        if (type == (codec == NalIndex::Codec::H265 ? 33 : 7)) {
+            // A four-byte start code leaves a trailing zero on this unit; it only
+            // pads the RBSP past the fields read here
+            if (!parse(nal, next - nal, codec, info)) {
+                *error = "unreadable SPS";
+                return false;
+            }
+            return true;
+        }
+        p = next;
+    }
+    *error = QString("no SPS in the first %1 KB").arg(maxBytes / 1024);
+    return false;
+}
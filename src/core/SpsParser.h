@@ -0,0 +1,41 @@
+#ifndef SPSPARSER_H
+#define SPSPARSER_H
+
+#include <QString>
+#include <QtGlobal>
+#include "NalIndex.h"
+
+// Fields of an H.264/H.265 sequence parameter set that decide whether two streams
+// can be decoded as one: a change in any of them needs a new SPS the container
+// cannot carry mid-track.
+struct SpsInfo {
+    NalIndex::Codec codec = NalIndex::Codec::Unknown;
+    int profile = -1;               // profile_idc
+    int level = -1;                 // level_idc
+    int chromaFormat = -1;          // 0 = 4:0:0, 1 = 4:2:0, 2 = 4:2:2, 3 = 4:4:4
+    int bitDepth = -1;              // luma
+    int width = -1;                 // after cropping
+    int height = -1;
+
+    bool isValid() const { return width > 0 && height > 0; }
+    // Same codec, profile, chroma format, bit depth and picture size; the level may differ
+    bool isCompatibleWith(const SpsInfo &other) const;
+    QString describe() const;       // "H.265 Main 10, 3840x2160, 4:2:0 10-bit, level 5.1"
+};
+
+// Minimal SPS reader: profile, level, chroma format, bit depth and cropped picture
+// size, nothing after them (no VUI). Works on the NAL unit as found in the stream,
+// header included; emulation prevention bytes are removed here.
+namespace SpsParser {
+
+bool parse(const uchar *nal, qint64 size, NalIndex::Codec codec, SpsInfo *info);
+
+// First SPS within the first maxBytes of a raw stream file. False with error set if
+// the file cannot be read or has no parseable SPS there; the codec is sniffed when
+// Unknown.
+bool parseFile(const QString &filePath, SpsInfo *info, QString *error,
+               NalIndex::Codec codec = NalIndex::Codec::Unknown, qint64 maxBytes = 1024 * 1024);
+
+} // namespace SpsParser
+
+#endif // SPSPARSER_H
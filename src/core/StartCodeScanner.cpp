@@ -0,0 +1,198 @@
+#include "StartCodeScanner.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PROMUXER_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PROMUXER_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang compile the AVX2 kernel for that target only; MSVC accepts the
+// intrinsics anywhere. Either way it only runs after the CPU check.
+#if defined(PROMUXER_SCAN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PROMUXER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PROMUXER_TARGET_AVX2
+#endif
+
+namespace StartCodeScanner {
+
+namespace {
+
+const uchar *findScalar(const uchar *p, const uchar *end)
+{
+    // Look at every third byte: anything above 1 there rules out a start code
+    // ending at, or overlapping, that byte
+    while (end - p >= 3) {
+        if (p[2] > 1) {
+            p += 3;
+        } else if (p[2] == 0) {
+            p += 1;
+        } else {
+            if (p[0] == 0 && p[1] == 0) {
+                return p;
+            }
+            p += 3;
+        }
+    }
+    return end;
+}
+
+#if defined(PROMUXER_SCAN_X86)
+inline int lowestBit(unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return int(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+const uchar *findSse2(const uchar *p, const uchar *end)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    // Each step tests the 16 positions p[0..15], reading up to p[17]
+    while (end - p >= 18) {
+        const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 1));
+        const __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 2));
+        const __m128i hit = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+                                          _mm_cmpeq_epi8(b2, one));
+        const unsigned mask = unsigned(_mm_movemask_epi8(hit));
+        if (mask) {
+            return p + lowestBit(mask);
+        }
+        p += 16;
+    }
+    return findScalar(p, end);
+}
+
+PROMUXER_TARGET_AVX2
+const uchar *findAvx2(const uchar *p, const uchar *end)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    while (end - p >= 34) {
+        const __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        const __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 1));
+        const __m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 2));
+        const __m256i hit = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero)),
+                                             _mm256_cmpeq_epi8(b2, one));
+        const unsigned mask = unsigned(_mm256_movemask_epi8(hit));
+        if (mask) {
+            return p + lowestBit(mask);
+        }
+        p += 32;
+    }
+    return findSse2(p, end);
+}
+
+bool cpuHasAvx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;           // the OS does not save YMM state
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // PROMUXER_SCAN_X86
+
+#if defined(PROMUXER_SCAN_NEON)
+const uchar *findNeon(const uchar *p, const uchar *end)
+{
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t one = vdupq_n_u8(1);
+    while (end - p >= 18) {
+        const uint8x16_t hit = vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(p), zero), vceqq_u8(vld1q_u8(p + 1), zero)),
+                                        vceqq_u8(vld1q_u8(p + 2), one));
+        if (vmaxvq_u8(hit)) {
+            // No movemask on NEON; the hit is somewhere in these 16 positions
+            for (int i = 0; i < 16; ++i) {
+                if (p[i] == 0 && p[i + 1] == 0 && p[i + 2] == 1) {
+                    return p + i;
+                }
+            }
+        }
+        p += 16;
+    }
+    return findScalar(p, end);
+}
+#endif
+
+Implementation detect()
+{
+#if defined(PROMUXER_SCAN_X86)
+    return cpuHasAvx2() ? Implementation::Avx2 : Implementation::Sse2;
+#elif defined(PROMUXER_SCAN_NEON)
+    return Implementation::Neon;
+#else
+    return Implementation::Scalar;
+#endif
+}
+
+} // namespace
+
+Implementation active()
+{
+    static const Implementation implementation = detect();
+    return implementation;
+}
+
+const char *name(Implementation implementation)
+{
+    switch (implementation) {
+    case Implementation::Sse2: return "SSE2";
+    case Implementation::Avx2: return "AVX2";
+    case Implementation::Neon: return "NEON";
+    default: return "scalar";
+    }
+}
+
+const uchar *findNextWith(Implementation implementation, const uchar *begin, const uchar *end)
+{
+    switch (implementation) {
+    case Implementation::Scalar:
+        return findScalar(begin, end);
+#if defined(PROMUXER_SCAN_X86)
+    case Implementation::Sse2:
+        return findSse2(begin, end);
+    case Implementation::Avx2:
+        return (active() == Implementation::Avx2) ? findAvx2(begin, end) : nullptr;
+#endif
+#if defined(PROMUXER_SCAN_NEON)
+    case Implementation::Neon:
+        return findNeon(begin, end);
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+const uchar *findNext(const uchar *begin, const uchar *end)
+{
+    // Resolved once; the switch is cheap next to a multi-kilobyte scan
+    static const Implementation implementation = active();
+    return findNextWith(implementation, begin, end);
+}
+
+} // namespace StartCodeScanner
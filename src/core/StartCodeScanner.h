@@ -0,0 +1,34 @@
+#ifndef STARTCODESCANNER_H
+#define STARTCODESCANNER_H
+
+#include <QtGlobal>
+
+// Finds Annex B start codes (00 00 01) in H.264/H.265 elementary streams.
+//
+// The search compares 16 or 32 bytes per step with SSE2, AVX2 or NEON, picked at
+// runtime from what the CPU supports, and falls back to a scalar skip loop. All
+// implementations return the same positions.
+namespace StartCodeScanner {
+
+enum class Implementation {
+    Scalar,
+    Sse2,
+    Avx2,
+    Neon
+};
+
+// First 00 00 01 in [begin, end), or end if there is none. Four-byte start codes
+// (00 00 00 01) are reported at their last three bytes.
+const uchar *findNext(const uchar *begin, const uchar *end);
+
+// Implementation selected for this CPU
+Implementation active();
+const char *name(Implementation implementation);
+
+// For benchmarks and cross-checking: runs a specific implementation, or returns
+// nullptr if it is not available on this CPU/build
+const uchar *findNextWith(Implementation implementation, const uchar *begin, const uchar *end);
+
+} // namespace StartCodeScanner
+
+#endif // STARTCODESCANNER_H
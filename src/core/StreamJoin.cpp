@@ -0,0 +1,109 @@
+#include "StreamJoin.h"
+#include "SpsParser.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QRegularExpression>
+#include <algorithm>
+
+namespace {
+
+// "title_012" -> ("title_", 12); names without a trailing number get -1
+struct NumberedName {
+    QString stem;
+    qint64 number = -1;
+};
+
+NumberedName splitName(const QString &filePath)
+{
+    static const QRegularExpression trailingNumber(R"(^(.*?)(\d+)$)");
+    NumberedName name;
+    const QString base = QFileInfo(filePath).completeBaseName();
+    const QRegularExpressionMatch match = trailingNumber.match(base);
+    if (match.hasMatch()) {
+        name.stem = match.captured(1);
+        name.number = match.captured(2).toLongLong();
+    } else {
+        name.stem = base;
+    }
+    return name;
+}
+
+} // namespace
+
+QList<QStringList> StreamJoin::groupByName(const QStringList &files)
+{
+    QHash<QString, QStringList> byKey;
+    QStringList keys;                       // first-seen order, for a stable result
+    for (const QString &file : files) {
+        const NumberedName name = splitName(file);
+        if (name.number < 0) {
+            continue;
+        }
+        const QFileInfo info(file);
+        const QString key = info.absolutePath() + '/' + name.stem + '.' + info.suffix().toLower();
+        if (!byKey.contains(key)) {
+            keys.append(key);
+        }
+        byKey[key].append(file);
+    }
+
+    QList<QStringList> groups;
+    for (const QString &key : std::as_const(keys)) {
+        const QStringList &members = byKey[key];
+        if (members.size() >= 2) {
+            groups.append(sortedByNumber(members));
+        }
+    }
+    return groups;
+}
+
+QStringList StreamJoin::sortedByNumber(const QStringList &files)
+{
+    QStringList sorted = files;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const QString &a, const QString &b) {
+        const NumberedName nameA = splitName(a);
+        const NumberedName nameB = splitName(b);
+        if (nameA.number != nameB.number) {
+            return nameA.number < nameB.number;
+        }
+        return QFileInfo(a).fileName() < QFileInfo(b).fileName();
+    });
+    return sorted;
+}
+
+QString StreamJoin::joinedBaseName(const QStringList &files)
+{
+    if (files.isEmpty()) {
+        return QString();
+    }
+    QString stem = splitName(files.first()).stem;
+    // Drop the separator before the number: "title_" -> "title"
+    while (!stem.isEmpty() && (stem.endsWith('_') || stem.endsWith('-') || stem.endsWith('.') || stem.endsWith(' '))) {
+        stem.chop(1);
+    }
+    return stem.isEmpty() ? QFileInfo(files.first()).completeBaseName() + "_joined" : stem;
+}
+
+bool StreamJoin::checkConsistency(const QStringList &files, SpsInfo *sps, QString *error)
+{
+    SpsInfo first;
+    for (int i = 0; i < files.size(); ++i) {
+        const QString name = QFileInfo(files.at(i)).fileName();
+        SpsInfo info;
+        QString parseError;
+        if (!SpsParser::parseFile(files.at(i), &info, &parseError)) {
+            *error = QString("%1: %2").arg(name, parseError);
+            return false;
+        }
+        if (i == 0) {
+            first = info;
+        } else if (!info.isCompatibleWith(first)) {
+            *error = QString("%1 is %2, %3 is %4")
+                         .arg(name, info.describe(), QFileInfo(files.first()).fileName(), first.describe());
+            return false;
+        }
+    }
+    *sps = first;
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef STREAMJOIN_H
+#define STREAMJOIN_H
+
+#include <QList>
+#include <QStringList>
+
+struct SpsInfo;
+
+// Segmented raw streams: encoders that write one title as numbered chunks
+// ("title_001.h265", "title_002.h265", ...). Annex B streams can be concatenated
+// byte for byte, so a join is one ffmpeg run reading every chunk in order through
+// the concat protocol, with timestamps generated across the chunk boundaries.
+namespace StreamJoin {
+
+// Files whose names differ only in a trailing number, grouped by folder, name and
+// extension and ordered by that number. Only groups of two or more are returned.
+QList<QStringList> groupByName(const QStringList &files);
+
+// Files ordered by the number at the end of their names, then by name
+QStringList sortedByNumber(const QStringList &files);
+
+// Name for the joined output: the common name without the number ("title")
+QString joinedBaseName(const QStringList &files);
+
+// Reads the first SPS of every chunk. False with error naming the first chunk that
+// cannot be parsed or whose stream differs from the first chunk's; see
+// SpsInfo::isCompatibleWith(). sps receives the first chunk's SPS.
+bool checkConsistency(const QStringList &files, SpsInfo *sps, QString *error);
+
+} // namespace StreamJoin
+
+#endif // STREAMJOIN_H
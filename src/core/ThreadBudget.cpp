@@ -0,0 +1,59 @@
+#include "ThreadBudget.h"
+#include <QSettings>
+#include <QThread>
+#include <cmath>
+
+namespace {
+
+// ffmpeg's own automatic limit: decoders gain little from more frame/slice threads
+constexpr int kMaxDecodeThreads = 16;
+
+} // namespace
+
+namespace ThreadBudget {
+
+bool isEnabled()
+{
+    return QSettings().value("processing/threadBudget", true).toBool();
+}
+
+int share(JobCost::Kind kind, double freeCores, int sharers)
+{
+    if (kind == JobCost::StreamCopy) {
+        return 0;
+    }
+    const int threads = qMax(1, int(std::floor(freeCores / qMax(1, sharers) + 1e-6)));
+    return (kind == JobCost::DecodeToYuv) ? qMin(threads, kMaxDecodeThreads) : threads;
+}
+
+QStringList apply(const QStringList &args, JobCost::Kind kind, int threads)
+{
+    if (threads <= 0 || kind == JobCost::StreamCopy) {
+        return args;
+    }
+    const QString count = QString::number(threads);
+    QStringList result{"-filter_threads", count};
+    bool decoderSet = false;
+    for (int i = 0; i < args.size(); ++i) {
+        if (args.at(i) == "-i" && !decoderSet) {
+            result << "-threads" << count;      // input option: the decoder's pool
+            decoderSet = true;
+        }
+        result << args.at(i);
+        if (args.at(i) == "-svtav1-params" && i + 1 < args.size()) {
+            result << args.at(++i) + ":lp=" + count;
+            result << "-threads" << count;      // output option: the encoder's pool
+        }
+    }
+    return result;
+}
+
+int probeThreads(int parallelProbes)
+{
+    if (parallelProbes <= 1 || !isEnabled()) {
+        return 0;
+    }
+    return qMax(1, QThread::idealThreadCount() / parallelProbes);
+}
+
+} // namespace ThreadBudget
@@ -0,0 +1,33 @@
+#ifndef THREADBUDGET_H
+#define THREADBUDGET_H
+
+#include <QStringList>
+#include "CostModel.h"
+
+// Thread counts for concurrently running ffmpeg/ffprobe children.
+//
+// Left alone, every decoder, encoder and filter graph sizes its pool to the whole
+// machine, so N parallel jobs run N x cores threads and lose throughput to context
+// switches. Instead each decode or re-encode is given an explicit share when it
+// starts: the cores the running jobs leave free, split between the jobs that will
+// start beside it. ffmpeg cannot resize a running pool, so the budget is rebalanced
+// at spawn time; cores released by a finished job go to the jobs started next.
+// "processing/threadBudget" (default on) turns this off.
+namespace ThreadBudget {
+
+bool isEnabled();
+
+// Threads for one job of this kind given the free cores and the number of jobs about
+// to share them; 0 for stream copies, which are left to ffmpeg
+int share(JobCost::Kind kind, double freeCores, int sharers);
+
+// args with the allocation applied: decoder -threads before -i, -filter_threads for
+// the scaler/format graph, and lp for libsvtav1. Unchanged when threads is 0.
+QStringList apply(const QStringList &args, JobCost::Kind kind, int threads);
+
+// Decoder threads of each of parallelProbes concurrent ffprobe runs, 0 when not limited
+int probeThreads(int parallelProbes);
+
+} // namespace ThreadBudget
+
+#endif // THREADBUDGET_H
@@ -0,0 +1,190 @@
+#include "TraceRecorder.h"
+#include "BatchMetrics.h"
+#include <QDateTime>
+#include <QDir>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSettings>
+
+TraceRecorder &TraceRecorder::instance()
+{
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+TraceRecorder::TraceRecorder()
+    : m_directoryResolved(false)
+    , m_firstEvent(true)
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    finishFile();
+}
+
+QString TraceRecorder::directoryLocked() const
+{
+    if (!m_directoryResolved) {
+        m_directory = qEnvironmentVariable("PROMUXER_TRACE_DIR");
+        if (m_directory.isEmpty()) {
+            QSettings settings;
+            m_directory = settings.value("trace/directory").toString();
+        }
+        m_directoryResolved = true;
+    }
+    return m_directory;
+}
+
+bool TraceRecorder::isEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return !directoryLocked().isEmpty();
+}
+
+bool TraceRecorder::ensureOpenLocked()
+{
+    if (m_file.isOpen()) {
+        return true;
+    }
+    const QString directory = directoryLocked();
+    if (directory.isEmpty() || !QDir().mkpath(directory)) {
+        return false;
+    }
+    const QString name = QString("promuxer-trace-%1.json")
+                             .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz"));
+    m_file.setFileName(QDir(directory).absoluteFilePath(name));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    // JSON array format: viewers accept a missing "]" if the app dies mid-batch
+    m_file.write("[\n");
+    m_firstEvent = true;
+    m_namedTracks.clear();
+
+    const QPair<Process, const char *> processes[] = {
+        {AnalyzerProcess, "Analyzer (ffprobe)"},
+        {ProcessorProcess, "Processor (ffmpeg)"}};
+    for (const auto &process : processes) {
+        QJsonObject args;
+        args["name"] = process.second;
+        QJsonObject event;
+        event["ph"] = "M";
+        event["name"] = "process_name";
+        event["pid"] = int(process.first);
+        event["args"] = args;
+        writeEventLocked(event);
+    }
+    return true;
+}
+
+void TraceRecorder::writeEventLocked(const QJsonObject &event)
+{
+    if (!m_firstEvent) {
+        m_file.write(",\n");
+    }
+    m_firstEvent = false;
+    m_file.write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+}
+
+void TraceRecorder::nameTrackLocked(Process process, int slot)
+{
+    const qint64 key = (qint64(process) << 32) | quint32(slot);
+    if (m_namedTracks.contains(key)) {
+        return;
+    }
+    m_namedTracks.insert(key);
+
+    QJsonObject args;
+    args["name"] = QString("%1 slot %2").arg(process == AnalyzerProcess ? "probe" : "job").arg(slot + 1);
+    QJsonObject event;
+    event["ph"] = "M";
+    event["name"] = "thread_name";
+    event["pid"] = int(process);
+    event["tid"] = slot + 1;
+    event["args"] = args;
+    writeEventLocked(event);
+
+    QJsonObject sortArgs;
+    sortArgs["sort_index"] = slot;
+    event["name"] = "thread_sort_index";
+    event["args"] = sortArgs;
+    writeEventLocked(event);
+}
+
+void TraceRecorder::span(Process process, int slot, const QString &name, const QString &category,
+                         qint64 startMs, qint64 endMs, const QJsonObject &args)
+{
+    if (startMs < 0 || endMs < startMs) {
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (!ensureOpenLocked()) {
+        return;
+    }
+    nameTrackLocked(process, slot);
+
+    QJsonObject event;
+    event["ph"] = "X";
+    event["name"] = name;
+    event["cat"] = category;
+    event["pid"] = int(process);
+    event["tid"] = slot + 1;
+    event["ts"] = double(startMs) * 1000.0;
+    event["dur"] = double(endMs - startMs) * 1000.0;
+    if (!args.isEmpty()) {
+        event["args"] = args;
+    }
+    writeEventLocked(event);
+}
+
+void TraceRecorder::instant(Process process, int slot, const QString &name, const QString &category,
+                            const QJsonObject &args)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!ensureOpenLocked()) {
+        return;
+    }
+    nameTrackLocked(process, slot);
+
+    QJsonObject event;
+    event["ph"] = "i";
+    event["s"] = "t";
+    event["name"] = name;
+    event["cat"] = category;
+    event["pid"] = int(process);
+    event["tid"] = slot + 1;
+    event["ts"] = double(BatchMetrics::clockMs()) * 1000.0;
+    if (!args.isEmpty()) {
+        event["args"] = args;
+    }
+    writeEventLocked(event);
+}
+
+void TraceRecorder::counter(Process process, const QString &name, const QJsonObject &values)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!ensureOpenLocked()) {
+        return;
+    }
+    QJsonObject event;
+    event["ph"] = "C";
+    event["name"] = name;
+    event["pid"] = int(process);
+    event["ts"] = double(BatchMetrics::clockMs()) * 1000.0;
+    event["args"] = values;
+    writeEventLocked(event);
+}
+
+QString TraceRecorder::finishFile()
+{
+    QMutexLocker locker(&m_mutex);
+    m_directoryResolved = false;
+    if (!m_file.isOpen()) {
+        return QString();
+    }
+    m_file.write("\n]\n");
+    m_file.close();
+    return m_file.fileName();
+}
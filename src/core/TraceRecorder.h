@@ -0,0 +1,62 @@
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <QString>
+#include <QFile>
+#include <QMutex>
+#include <QJsonObject>
+#include <QSet>
+#include <QtGlobal>
+
+// Writes Chrome trace-event JSON (viewable in Perfetto or chrome://tracing).
+//
+// Disabled unless the "trace/directory" setting or the PROMUXER_TRACE_DIR
+// environment variable names a directory (re-read after each finishFile()). The file is opened on the first event
+// and closed by finishFile() at the end of a batch, so each batch (plus the probes
+// that ran before it) ends up in its own promuxer-trace-<time>.json.
+//
+// Timestamps come from BatchMetrics::clockMs so spans line up with the batch
+// metrics. Every method is thread-safe.
+class TraceRecorder
+{
+public:
+    // Trace "processes"; each worker slot is a thread track inside one of them
+    enum Process {
+        AnalyzerProcess = 1,
+        ProcessorProcess = 2
+    };
+
+    static TraceRecorder &instance();
+
+    bool isEnabled() const;
+
+    // Complete ("X") span on a slot track; times in BatchMetrics::clockMs milliseconds
+    void span(Process process, int slot, const QString &name, const QString &category,
+              qint64 startMs, qint64 endMs, const QJsonObject &args = QJsonObject());
+    // Instant ("i") event on a slot track, e.g. an error
+    void instant(Process process, int slot, const QString &name, const QString &category,
+                 const QJsonObject &args = QJsonObject());
+    // Counter ("C") track on a process; each key in values becomes a series
+    void counter(Process process, const QString &name, const QJsonObject &values);
+
+    // Closes the current file; returns its path, or an empty string if nothing was traced
+    QString finishFile();
+
+private:
+    TraceRecorder();
+    ~TraceRecorder();
+
+    bool ensureOpenLocked();
+    void writeEventLocked(const QJsonObject &event);
+    void nameTrackLocked(Process process, int slot);
+    QString directoryLocked() const;
+
+    mutable QMutex m_mutex;
+    mutable QString m_directory;        // resolved once per trace file
+    mutable bool m_directoryResolved;
+    QFile m_file;
+    bool m_firstEvent;
+    QSet<qint64> m_namedTracks;
+};
+
+#endif // TRACERECORDER_H
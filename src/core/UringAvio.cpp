@@ -0,0 +1,131 @@
+#include "UringAvio.h"
+#include <QSettings>
+
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavformat/version.h>
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+#include <cstdio>
+
+namespace {
+
+int readPacket(void *opaque, uint8_t *buf, int bufSize)
+{
+    BlockIo *io = static_cast<BlockIo *>(opaque);
+    qint64 n = io->read(buf, bufSize);
+    if (n < 0) {
+        return AVERROR(EIO);
+    }
+    return n == 0 ? AVERROR_EOF : int(n);
+}
+
+// libavformat 61 (FFmpeg 7.0) made the write callback buffer const
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+int writePacket(void *opaque, const uint8_t *buf, int bufSize)
+#else
+int writePacket(void *opaque, uint8_t *buf, int bufSize)
+#endif
+{
+    BlockIo *io = static_cast<BlockIo *>(opaque);
+    return io->write(buf, bufSize) == bufSize ? bufSize : AVERROR(EIO);
+}
+
+int64_t seekStream(void *opaque, int64_t offset, int whence)
+{
+    BlockIo *io = static_cast<BlockIo *>(opaque);
+    whence &= ~AVSEEK_FORCE;
+
+    switch (whence) {
+    case AVSEEK_SIZE:
+        return io->size();
+    case SEEK_SET:
+        break;
+    case SEEK_CUR:
+        offset += io->position();
+        break;
+    case SEEK_END:
+        offset += io->size();
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+
+    qint64 pos = io->seek(offset);
+    return pos < 0 ? AVERROR(EIO) : pos;
+}
+
+AVIOContext *openContext(const QString &filePath, BlockIo::Mode mode, const BlockIo::Options &options, QString *error)
+{
+    BlockIo *io = new BlockIo();
+    if (!io->open(filePath, mode, options)) {
+        if (error) *error = io->errorString();
+        delete io;
+        return nullptr;
+    }
+
+    // Match the avio buffer to the BlockIo block size so each avio refill maps
+    // onto whole blocks instead of many small copies
+    const int bufferSize = options.blockSize;
+    unsigned char *buffer = static_cast<unsigned char *>(av_malloc(size_t(bufferSize)));
+    if (!buffer) {
+        if (error) *error = "Out of memory allocating the avio buffer";
+        delete io;
+        return nullptr;
+    }
+
+    const bool writing = (mode == BlockIo::Mode::Write);
+    AVIOContext *context = avio_alloc_context(buffer, bufferSize, writing ? 1 : 0, io,
+                                              writing ? nullptr : &readPacket,
+                                              writing ? &writePacket : nullptr,
+                                              &seekStream);
+    if (!context) {
+        if (error) *error = "avio_alloc_context failed";
+        av_free(buffer);
+        delete io;
+        return nullptr;
+    }
+    return context;
+}
+
+} // namespace
+
+BlockIo::Options UringAvio::optionsFromSettings()
+{
+    QSettings settings;
+    BlockIo::Options options;
+    options.queueDepth = qBound(1, settings.value("io/uringQueueDepth", 8).toInt(), 256);
+    options.blockSize = qBound(64, settings.value("io/uringBlockKB", 1024).toInt(), 65536) * 1024;
+    return options;
+}
+
+AVIOContext *UringAvio::openRead(const QString &filePath, const BlockIo::Options &options, QString *error)
+{
+    return openContext(filePath, BlockIo::Mode::Read, options, error);
+}
+
+AVIOContext *UringAvio::openWrite(const QString &filePath, const BlockIo::Options &options, QString *error)
+{
+    return openContext(filePath, BlockIo::Mode::Write, options, error);
+}
+
+bool UringAvio::close(AVIOContext **context)
+{
+    if (!context || !*context) {
+        return true;
+    }
+
+    AVIOContext *ctx = *context;
+    BlockIo *io = static_cast<BlockIo *>(ctx->opaque);
+    if (ctx->write_flag) {
+        avio_flush(ctx);
+    }
+    bool ok = (ctx->error == 0) && io->flush();
+
+    delete io;
+    av_freep(&ctx->buffer);
+    avio_context_free(context);
+    return ok;
+}
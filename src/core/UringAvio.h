@@ -0,0 +1,30 @@
+#ifndef URINGAVIO_H
+#define URINGAVIO_H
+
+#include "BlockIo.h"
+
+struct AVIOContext;
+
+// AVIOContext backend for in-process libavformat muxing and probing.
+//
+// The stock file protocol issues one small synchronous read()/write() per
+// avio buffer. This backend routes avio through BlockIo instead, which keeps
+// queueDepth large aligned blocks in flight through io_uring and falls back to
+// pread/pwrite when the kernel does not offer io_uring. Requests show up in
+// BlockIo::stats() like every other in-process I/O.
+//
+// Only built with CONFIG += promuxer_libav (defines PROMUXER_HAVE_LIBAV).
+class UringAvio
+{
+public:
+    static BlockIo::Options optionsFromSettings();   // "io/uringQueueDepth", "io/uringBlockKB"
+
+    // Caller assigns the context to AVFormatContext::pb and sets AVFMT_FLAG_CUSTOM_IO
+    static AVIOContext *openRead(const QString &filePath, const BlockIo::Options &options, QString *error = nullptr);
+    static AVIOContext *openWrite(const QString &filePath, const BlockIo::Options &options, QString *error = nullptr);
+
+    // Flushes pending writes, closes the file and frees the context; sets *context to null
+    static bool close(AVIOContext **context);
+};
+
+#endif // URINGAVIO_H
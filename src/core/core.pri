@@ -0,0 +1,77 @@
+# Processing core shared by the application and the benchmark tools.
+# Everything here depends on QtCore only.
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/FileProcessor.cpp \
+    $$PWD/MuxingTask.cpp \
+    $$PWD/MediaAnalyzer.cpp \
+    $$PWD/IoPolicy.cpp \
+    $$PWD/BlockIo.cpp \
+    $$PWD/BatchMetrics.cpp \
+    $$PWD/TraceRecorder.cpp \
+    $$PWD/ProcessPolicy.cpp \
+    $$PWD/CostModel.cpp \
+    $$PWD/ProgressEstimator.cpp \
+    $$PWD/ProgressBoard.cpp \
+    $$PWD/ContentFingerprint.cpp \
+    $$PWD/StartCodeScanner.cpp \
+    $$PWD/NalIndex.cpp \
+    $$PWD/SpsParser.cpp \
+    $$PWD/StreamJoin.cpp \
+    $$PWD/HdrMetadata.cpp \
+    $$PWD/SeiInjector.cpp \
+    $$PWD/ThreadBudget.cpp \
+    $$PWD/BatchPlan.cpp \
+    $$PWD/OutputNameRegistry.cpp \
+    $$PWD/FFprobeParser.cpp
+
+HEADERS += \
+    $$PWD/MediaInfo.h \
+    $$PWD/FileProcessor.h \
+    $$PWD/MuxingTask.h \
+    $$PWD/MediaAnalyzer.h \
+    $$PWD/IoPolicy.h \
+    $$PWD/BlockIo.h \
+    $$PWD/BatchMetrics.h \
+    $$PWD/TraceRecorder.h \
+    $$PWD/ProcessPolicy.h \
+    $$PWD/CostModel.h \
+    $$PWD/ProgressEstimator.h \
+    $$PWD/ProgressBoard.h \
+    $$PWD/ContentFingerprint.h \
+    $$PWD/StartCodeScanner.h \
+    $$PWD/NalIndex.h \
+    $$PWD/SpsParser.h \
+    $$PWD/StreamJoin.h \
+    $$PWD/HdrMetadata.h \
+    $$PWD/SeiInjector.h \
+    $$PWD/ThreadBudget.h \
+    $$PWD/BatchPlan.h \
+    $$PWD/OutputNameRegistry.h \
+    $$PWD/FFprobeParser.h
+
+# io_uring for the in-process I/O paths when liburing is installed;
+# BlockIo falls back to pread/pwrite without it.
+linux:packagesExist(liburing) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += liburing
+    DEFINES += PROMUXER_HAVE_LIBURING
+}
+
+# xxHash3 for content fingerprints when libxxhash is installed; MD5 otherwise
+packagesExist(libxxhash) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libxxhash
+    DEFINES += PROMUXER_HAVE_XXHASH
+}
+
+# Optional in-process libavformat I/O backend: qmake CONFIG+=promuxer_libav
+promuxer_libav {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libavformat libavutil
+    DEFINES += PROMUXER_HAVE_LIBAV
+    SOURCES += $$PWD/UringAvio.cpp
+    HEADERS += $$PWD/UringAvio.h
+}
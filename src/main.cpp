@@ -2,10 +2,100 @@
 #include <QStyleFactory>
 #include <QDir>
 #include <QPalette>
+#include <QCommandLineParser>
+#include <QTextStream>
 #include "ui/MainWindow.h"
+#include "core/BatchPlan.h"
+#include "core/FileProcessor.h"
+
+namespace {
+
+bool wantsHeadless(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--run-plan") == 0 || qstrncmp(argv[i], "--run-plan=", 11) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Headless replay of an exported batch plan:
+//   ProMuxer --run-plan plan.json [--parallel 4] [--dry-run | --script]
+int runHeadless(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("Pro Muxer");
+    app.setApplicationVersion("1.0.0");
+    app.setOrganizationName("ProMuxer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs a batch plan exported from ProMuxer without the window");
+    parser.addHelpOption();
+    QCommandLineOption planOption("run-plan", "Batch plan (JSON) to run.", "file");
+    QCommandLineOption parallelOption("parallel", "Parallel ffmpeg jobs (default: processing/maxParallelJobs).", "n");
+    QCommandLineOption dryRunOption("dry-run", "Print the plan instead of running it.");
+    QCommandLineOption scriptOption("script", "Print the plan as a shell script instead of running it.");
+    parser.addOptions({planOption, parallelOption, dryRunOption, scriptOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    BatchPlan loaded;
+    QString error;
+    if (!BatchPlan::load(parser.value(planOption), &loaded, &error)) {
+        err << "Cannot read plan " << parser.value(planOption) << ": " << error << "\n";
+        return 2;
+    }
+    if (parser.isSet(dryRunOption)) {
+        out << loaded.describe() << "\n";
+        return 0;
+    }
+    if (parser.isSet(scriptOption)) {
+        out << loaded.toShellScript();
+        return 0;
+    }
+
+    FileProcessor processor;
+    if (processor.ffmpegPath().isEmpty()) {
+        // runPlan() would only log this and finish as if nothing had failed
+        err << "FFmpeg executable not found. Set ffmpeg/ffmpeg_path or add ffmpeg to PATH.\n";
+        return 2;
+    }
+    if (parser.isSet(parallelOption)) {
+        processor.setMaxParallelJobs(parser.value(parallelOption).toInt());
+    }
+    int failed = 0;
+    QObject::connect(&processor, &FileProcessor::logMessage, &app, [&err](const QString &message) {
+        err << message << "\n";
+        err.flush();
+    });
+    QObject::connect(&processor, &FileProcessor::fileProcessed, &app, [&failed](const QString &, bool success) {
+        failed += success ? 0 : 1;
+    });
+    bool done = false;
+    QObject::connect(&processor, &FileProcessor::finished, &app, [&done]() {
+        done = true;
+        QCoreApplication::quit();
+    });
+    processor.runPlan(BatchPlanPtr(new BatchPlan(loaded)));
+    if (!done && !processor.isProcessing()) {
+        return 2;       // could not start
+    }
+    if (!done) {
+        app.exec();
+    }
+    return failed > 0 ? 1 : 0;
+}
+
+} // namespace
 
 int main(int argc, char *argv[])
 {
+    if (wantsHeadless(argc, argv)) {
+        return runHeadless(argc, argv);
+    }
+
     // CRITICAL PATH: Application entry point - initialize Qt framework
     QApplication app(argc, argv);
     
@@ -1,8 +1,12 @@
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
 #include "FFmpegSetupDialog.h"
+#include "StatsPanel.h"
 #include "../core/FileProcessor.h"
 #include "../core/MediaAnalyzer.h"
+#include "../core/ContentFingerprint.h"
+#include "../core/StreamJoin.h"
+#include "../core/HdrMetadata.h"
 #include <QApplication>
 #include <QDir>
 #include <QMimeData>
@@ -20,6 +24,13 @@
 #include <QDialogButtonBox>
 #include <QIntValidator>
 #include <QDesktopServices>
+#include <QDockWidget>
+#include <QToolButton>
+#include <QStyleOption>
+#include <QPainter>
+#include <QSet>
+#include <QPlainTextEdit>
+#include <QVBoxLayout>
 #ifdef Q_OS_WIN
 #include <QSettings>
 #endif
@@ -28,22 +39,75 @@
 enum TableColumn {
     COL_FILENAME = 0,
     COL_STATUS = 1,
-    COL_VIDEO_CODEC = 2,
-    COL_RESOLUTION = 3,
-    COL_FRAME_RATE = 4,
-    COL_BIT_DEPTH = 5,
-    COL_COLOR_SPACE = 6,
-    COL_DURATION = 7,
-    COL_FILE_SIZE = 8,
-    COL_OUTPUT_NAME = 9
+    COL_PROGRESS = 2,
+    COL_VIDEO_CODEC = 3,
+    COL_RESOLUTION = 4,
+    COL_FRAME_RATE = 5,
+    COL_BIT_DEPTH = 6,
+    COL_COLOR_SPACE = 7,
+    COL_DURATION = 8,
+    COL_IN_POINT = 9,
+    COL_OUT_POINT = 10,
+    COL_FILE_SIZE = 11,
+    COL_OUTPUT_NAME = 12
 };
 
+// Table refresh rate for per-file progress while a batch runs
+static const int kProgressRefreshMs = 100;
+
+// In/out cells: "1:02:03.5", "2:03" or plain seconds; empty clears the point (-1)
+static double parseTimecode(const QString &text, bool *ok)
+{
+    *ok = true;
+    const QString trimmed = text.trimmed();
+    if (trimmed.isEmpty()) {
+        return -1.0;
+    }
+    const QStringList parts = trimmed.split(':');
+    double seconds = 0.0;
+    for (const QString &part : parts) {
+        bool partOk = false;
+        const double value = part.toDouble(&partOk);
+        if (!partOk || value < 0.0 || parts.size() > 3) {
+            *ok = false;
+            return -1.0;
+        }
+        seconds = seconds * 60.0 + value;
+    }
+    return seconds;
+}
+
+static QString formatTimecode(double seconds)
+{
+    if (seconds < 0.0) {
+        return QString();
+    }
+    const qint64 ms = qint64(seconds * 1000.0 + 0.5);
+    return QString("%1:%2:%3.%4").arg(ms / 3600000).arg((ms / 60000) % 60, 2, 10, QChar('0'))
+        .arg((ms / 1000) % 60, 2, 10, QChar('0')).arg(ms % 1000, 3, 10, QChar('0'));
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , m_processor(nullptr)
     , m_analyzer(nullptr)
+    , m_processorThread(nullptr)
+    , m_analyzerThread(nullptr)
     , m_processing(false)
+    , m_stopRequested(false)
+    , m_etaLabel(nullptr)
+    , m_progressRefreshTimer(nullptr)
+    , m_statsDock(nullptr)
+    , m_statsPanel(nullptr)
+    , m_priorityCombo(nullptr)
+    , m_fingerprints(nullptr)
+    , m_dedupCombo(nullptr)
+    , m_joinCombo(nullptr)
+    , m_hdrButton(nullptr)
+    , m_dryRunButton(nullptr)
+    , m_dryRunPending(false)
+    , m_extraFormatsButton(nullptr)
 {
     ui->setupUi(this);
     setWindowIcon(QIcon(":/resources/app.ico"));
@@ -53,6 +117,11 @@ MainWindow::MainWindow(QWidget *parent)
     statusBar()->addPermanentWidget(m_ffmpegStatusLabel);
     m_ffmpegStatusLabel->setText("FFmpeg: Checking...");
     m_ffmpegStatusLabel->setStyleSheet("QLabel { color: orange; padding: 2px 8px; }");
+
+    // Batch ETA with its confidence band, shown while processing
+    m_etaLabel = new QLabel(this);
+    m_etaLabel->setStyleSheet("QLabel { padding: 2px 8px; }");
+    statusBar()->addPermanentWidget(m_etaLabel);
     m_ffmpegStatusLabel->setCursor(Qt::PointingHandCursor);
     
     // Install event filter for context menu
@@ -72,12 +141,16 @@ MainWindow::MainWindow(QWidget *parent)
     ui->fileTable->horizontalHeader()->setStretchLastSection(true);
     ui->fileTable->setColumnWidth(COL_FILENAME, 200);
     ui->fileTable->setColumnWidth(COL_STATUS, 100);
+    ui->fileTable->setColumnWidth(COL_PROGRESS, 110);
+    ui->fileTable->setItemDelegateForColumn(COL_PROGRESS, new ProgressBarDelegate(this));
     ui->fileTable->setColumnWidth(COL_VIDEO_CODEC, 100);
     ui->fileTable->setColumnWidth(COL_RESOLUTION, 120);
     ui->fileTable->setColumnWidth(COL_FRAME_RATE, 90);
     ui->fileTable->setColumnWidth(COL_BIT_DEPTH, 80);
     ui->fileTable->setColumnWidth(COL_COLOR_SPACE, 100);
     ui->fileTable->setColumnWidth(COL_DURATION, 80);
+    ui->fileTable->setColumnWidth(COL_IN_POINT, 90);
+    ui->fileTable->setColumnWidth(COL_OUT_POINT, 90);
     ui->fileTable->setColumnWidth(COL_FILE_SIZE, 80);
     
     // Apply All button is now in the UI file
@@ -85,13 +158,31 @@ MainWindow::MainWindow(QWidget *parent)
     
     setupConnections();
     
-    // Initialize processors
-    m_processor = new FileProcessor(this);
-    m_analyzer = new MediaAnalyzer(this);
+    // Initialize processors, each in a worker thread that deletes it on exit
+    m_processorThread = new QThread(this);
+    m_processorThread->setObjectName("FileProcessor");
+    m_processor = new FileProcessor();
+    m_processor->moveToThread(m_processorThread);
+    connect(m_processorThread, &QThread::finished, m_processor, &QObject::deleteLater);
+    m_analyzerThread = new QThread(this);
+    m_analyzerThread->setObjectName("MediaAnalyzer");
+    m_analyzer = new MediaAnalyzer();
+    m_analyzer->moveToThread(m_analyzerThread);
+    connect(m_analyzerThread, &QThread::finished, m_analyzer, &QObject::deleteLater);
     
     connect(m_processor, &FileProcessor::progress, this, &MainWindow::onTaskProgress);
+    connect(m_processor, &FileProcessor::overallProgress, this, &MainWindow::onOverallProgress);
+
+    // Jobs publish progress to the processor's board; the table samples it at 10 Hz
+    // from the moment the board is laid out until the batch has finished
+    m_progressRefreshTimer = new QTimer(this);
+    m_progressRefreshTimer->setInterval(kProgressRefreshMs);
+    connect(m_progressRefreshTimer, &QTimer::timeout, this, &MainWindow::refreshJobProgress);
+    connect(m_processor, &FileProcessor::batchStarted, m_progressRefreshTimer, qOverload<>(&QTimer::start));
     connect(m_processor, &FileProcessor::finished, this, &MainWindow::onTaskFinished);
     connect(m_processor, &FileProcessor::fileProcessed, this, &MainWindow::onFileProcessed);
+    connect(m_processor, &FileProcessor::fileCancelled, this, &MainWindow::onFileCancelled);
+    connect(m_processor, &FileProcessor::planCompiled, this, &MainWindow::onPlanCompiled);
     connect(m_processor, &FileProcessor::logMessage, this, [this](const QString &msg) {
         // Automatically detect log level from message prefix
         LogLevel level = LogLevel::Info;
@@ -103,8 +194,81 @@ MainWindow::MainWindow(QWidget *parent)
         onLogMessage(msg, level);
     });
     
+    connect(m_analyzer, &MediaAnalyzer::analysisPreliminary, this, &MainWindow::onMediaAnalysisPreliminary);
     connect(m_analyzer, &MediaAnalyzer::analysisFinished, this, &MainWindow::onMediaAnalysisFinished);
+    connect(m_analyzer, &MediaAnalyzer::allAnalysisFinished, this, &MainWindow::onAllAnalysisFinished);
     connect(m_analyzer, &MediaAnalyzer::analysisError, this, &MainWindow::onMediaAnalysisError);
+    connect(m_analyzer, &MediaAnalyzer::logMessage, this, [this](const QString &msg) {
+        onLogMessage(msg, msg.startsWith("[WARN]") ? LogLevel::Warning : LogLevel::Info);
+    });
+    
+    // Batch statistics dock (hidden until toggled; restoreState() in loadSettings keeps its placement)
+    m_statsPanel = new StatsPanel(this);
+    m_statsDock = new QDockWidget("Batch Statistics", this);
+    m_statsDock->setObjectName("statsDock");
+    m_statsDock->setWidget(m_statsPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, m_statsDock);
+    m_statsDock->hide();
+    m_statsDock->toggleViewAction()->setText("Stats");
+    QToolButton *statsButton = new QToolButton(this);
+    statsButton->setDefaultAction(m_statsDock->toggleViewAction());
+    ui->processButtonsLayout->addWidget(statsButton);
+    connect(m_processor, &FileProcessor::metricsUpdated, m_statsPanel, &StatsPanel::setMetrics);
+
+    m_processorThread->start();
+    m_analyzerThread->start();
+
+    // Priority presets for the ffmpeg/ffprobe children: nice level, I/O class, I/O level
+    m_priorityCombo = new QComboBox(this);
+    m_priorityCombo->setToolTip("CPU and I/O priority of FFmpeg processes; applies to running jobs immediately");
+    m_priorityCombo->addItem("Normal priority", QVariantList{0, int(ProcessPolicy::IoClassInherit), 4});
+    m_priorityCombo->addItem("Low priority", QVariantList{10, int(ProcessPolicy::IoClassBestEffort), 7});
+    m_priorityCombo->addItem("Background", QVariantList{19, int(ProcessPolicy::IoClassIdle), 7});
+    ui->processButtonsLayout->addWidget(m_priorityCombo);
+
+    // Duplicate inputs are found by sampled content fingerprint as files are added
+    m_fingerprints = new FingerprintScanner(this);
+    connect(m_fingerprints, &FingerprintScanner::duplicatesChanged, this, &MainWindow::markDuplicateRows);
+    m_dedupCombo = new QComboBox(this);
+    m_dedupCombo->setToolTip("Identical inputs under different names: process every copy, or process the first "
+                             "and hardlink/reflink the others' outputs to it");
+    m_dedupCombo->addItem("Process duplicates", "off");
+    m_dedupCombo->addItem("Hardlink duplicates", "hardlink");
+    m_dedupCombo->addItem("Reflink duplicates", "reflink");
+    ui->processButtonsLayout->addWidget(m_dedupCombo);
+
+    m_joinCombo = new QComboBox(this);
+    m_joinCombo->setToolTip("Raw stream chunks of one title (title_001.h265, title_002.h265, ...): mux each "
+                            "separately, or join them in order into one output in a single pass");
+    m_joinCombo->addItem("Separate outputs", "off");
+    m_joinCombo->addItem("Join numbered chunks", "pattern");
+    m_joinCombo->addItem("Join selected files", "selection");
+    ui->processButtonsLayout->addWidget(m_joinCombo);
+
+    m_hdrButton = new QPushButton("HDR Metadata...", this);
+    m_hdrButton->setToolTip("Write mastering display and content light level metadata into raw H.264/H.265 "
+                            "streams while remuxing, from the source or from your values");
+    m_hdrButton->setCheckable(true);
+    connect(m_hdrButton, &QPushButton::clicked, this, &MainWindow::editHdrMetadata);
+    ui->processButtonsLayout->addWidget(m_hdrButton);
+
+    m_dryRunButton = new QPushButton("Dry Run...", this);
+    m_dryRunButton->setToolTip("Show the jobs, exact FFmpeg commands and outputs of the batch without "
+                               "running it; export them as JSON or a shell script");
+    connect(m_dryRunButton, &QPushButton::clicked, this, &MainWindow::dryRun);
+    ui->processButtonsLayout->addWidget(m_dryRunButton);
+
+    // Extra containers, muxed from the same read of each input (tee muxer)
+    m_extraFormatsButton = new QToolButton(this);
+    m_extraFormatsButton->setPopupMode(QToolButton::InstantPopup);
+    m_extraFormatsButton->setToolTip("Also write these containers from the same pass over each input");
+    QMenu *extraFormatsMenu = new QMenu(m_extraFormatsButton);
+    for (const char *format : {"mp4", "mkv", "mov", "ts", "webm"}) {
+        QAction *action = extraFormatsMenu->addAction(format);
+        action->setCheckable(true);
+    }
+    m_extraFormatsButton->setMenu(extraFormatsMenu);
+    ui->formatLayout->insertWidget(ui->formatLayout->indexOf(ui->formatCombo) + 1, m_extraFormatsButton);
     
     // Load settings
     loadSettings();
@@ -117,9 +281,12 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
-    if (m_processor && m_processing) {
-        m_processor->stop();
-    }
+    // The processor and analyzer stop their children and are deleted on their own
+    // threads once the event loops exit
+    m_processorThread->quit();
+    m_analyzerThread->quit();
+    m_processorThread->wait();
+    m_analyzerThread->wait();
     
     // Save settings
     saveSettings();
@@ -284,6 +451,7 @@ void MainWindow::removeSelected()
 {
     int row = ui->fileTable->currentRow();
     if (row >= 0) {
+        m_fingerprints->forget(m_files.value(row));
         m_files.removeAt(row);
         m_mediaInfos.removeAt(row);
         ui->fileTable->removeRow(row);
@@ -296,6 +464,7 @@ void MainWindow::removeSelected()
 
 void MainWindow::clearAll()
 {
+    m_fingerprints->clear();
     m_files.clear();
     m_mediaInfos.clear();
     ui->fileTable->setRowCount(0);
@@ -314,8 +483,10 @@ void MainWindow::analyzeFiles()
     
     logMessage("Starting media analysis...", LogLevel::Info);
     
+    QMetaObject::invokeMethod(m_analyzer, [analyzer = m_analyzer, files = m_files]() {
+        analyzer->analyzeFiles(files);
+    }, Qt::QueuedConnection);
     for (int i = 0; i < m_files.size(); ++i) {
-        m_analyzer->analyzeFile(i, m_files[i]);
         updateTableRowStatus(i, "Analyzing...");
     }
 }
@@ -459,10 +630,14 @@ void MainWindow::startProcessing()
     }
     
     m_processing = true;
+    m_stopRequested = false;
     ui->startBtn->setEnabled(false);
     ui->stopBtn->setEnabled(true);
+    // Overall progress is work-weighted, in tenths of a percent
+    ui->progressBar->setMaximum(1000);
     ui->progressBar->setValue(0);
     ui->statusLabel->setText("Processing...");
+    m_etaLabel->setText("ETA: estimating...");
     
     // Determine conflict handling
     bool overwrite = (ui->conflictCombo->currentText() == "Overwrite");
@@ -479,26 +654,153 @@ void MainWindow::startProcessing()
         updateTableRowStatus(i, "Queued");
     }
     logMessage(QString("Processing mode: %1").arg(processingMode), LogLevel::Info);
-    m_processor->processFiles(m_files, outputFolder, getOutputFormat(), m_mediaInfos, overwrite, processingMode);
+
+    m_jobIndexByFile.clear();
+    for (int i = 0; i < m_files.size(); ++i) {
+        m_jobIndexByFile.insert(m_files.at(i), i);
+    }
+    m_shownProgress.fill(0, m_files.size());
+    for (int row = 0; row < ui->fileTable->rowCount(); ++row) {
+        ui->fileTable->setItem(row, COL_PROGRESS, new QTableWidgetItem());
+    }
+
+    applyProcessorOptions();
+    QMetaObject::invokeMethod(m_processor, [processor = m_processor, files = m_files, outputFolder,
+                                            format = getOutputFormat(), infos = m_mediaInfos, overwrite, processingMode]() {
+        processor->processFiles(files, outputFolder, format, infos, overwrite, processingMode);
+    }, Qt::QueuedConnection);
+}
+
+void MainWindow::applyProcessorOptions()
+{
+    const QHash<QString, QString> leaders = m_fingerprints->duplicateLeaders();
+    const QStringList extraFormats = selectedExtraFormats();
+
+    QList<QStringList> joinGroups;
+    const QString joinMode = m_joinCombo->currentData().toString();
+    if (joinMode == "pattern") {
+        joinGroups = StreamJoin::groupByName(m_files);
+    } else if (joinMode == "selection") {
+        QStringList selected;
+        for (const QModelIndex &index : ui->fileTable->selectionModel()->selectedRows()) {
+            if (index.row() < m_files.size()) {
+                selected << m_files.at(index.row());
+            }
+        }
+        if (selected.size() >= 2) {
+            joinGroups << StreamJoin::sortedByNumber(selected);
+        }
+    }
+    // Queued ahead of the processFiles()/compilePlan() call that uses them
+    QMetaObject::invokeMethod(m_processor, [processor = m_processor, leaders, extraFormats, joinGroups]() {
+        processor->setDuplicateLeaders(leaders);
+        processor->setExtraFormats(extraFormats);
+        processor->setJoinGroups(joinGroups);
+    }, Qt::QueuedConnection);
+}
+
+void MainWindow::dryRun()
+{
+    if (m_processing) {
+        return;
+    }
+    if (m_files.isEmpty()) {
+        logMessage("[WARNING] No files to process!", LogLevel::Warning);
+        return;
+    }
+    const QString outputFolder = ui->outputFolderEdit->text();
+    if (outputFolder.isEmpty()) {
+        logMessage("[ERROR] Please select an output folder!", LogLevel::Error);
+        return;
+    }
+
+    const bool overwrite = (ui->conflictCombo->currentText() == "Overwrite");
+    const QString processingMode = ui->binToYuvModeRadio->isChecked() ? "binToYuv" : "muxing";
+    saveSettings();
+    applyProcessorOptions();
+    m_dryRunPending = true;
+    logMessage("Compiling the batch plan (dry run)...", LogLevel::Info);
+    QMetaObject::invokeMethod(m_processor, [processor = m_processor, files = m_files, outputFolder,
+                                            format = getOutputFormat(), infos = m_mediaInfos, overwrite, processingMode]() {
+        processor->compilePlan(files, outputFolder, format, infos, overwrite, processingMode);
+    }, Qt::QueuedConnection);
+}
+
+void MainWindow::onPlanCompiled(const BatchPlanPtr &plan)
+{
+    if (!m_dryRunPending) {
+        return;             // the plan of a batch that is starting
+    }
+    m_dryRunPending = false;
+    showPlan(plan);
+}
+
+void MainWindow::showPlan(const BatchPlanPtr &plan)
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("Batch Plan");
+    dialog.resize(900, 600);
+    QVBoxLayout layout(&dialog);
+    QPlainTextEdit text;
+    text.setReadOnly(true);
+    text.setLineWrapMode(QPlainTextEdit::NoWrap);
+    text.setPlainText(plan->describe());
+    layout.addWidget(&text);
+
+    QDialogButtonBox buttons(QDialogButtonBox::Close);
+    QPushButton *jsonButton = buttons.addButton("Export JSON...", QDialogButtonBox::ActionRole);
+    QPushButton *scriptButton = buttons.addButton("Export Script...", QDialogButtonBox::ActionRole);
+    layout.addWidget(&buttons);
+    connect(&buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    const QString folder = ui->outputFolderEdit->text();
+    connect(jsonButton, &QPushButton::clicked, &dialog, [this, &dialog, plan, folder]() {
+        const QString path = QFileDialog::getSaveFileName(&dialog, "Export Plan", QDir(folder).filePath("plan.json"),
+                                                          "Batch plan (*.json)");
+        if (path.isEmpty()) {
+            return;
+        }
+        QString error;
+        if (plan->save(path, &error)) {
+            logMessage(QString("Plan written to %1; run it with ProMuxer --run-plan").arg(path), LogLevel::Info);
+        } else {
+            logMessage(QString("[ERROR] Could not write %1: %2").arg(path, error), LogLevel::Error);
+        }
+    });
+    connect(scriptButton, &QPushButton::clicked, &dialog, [this, &dialog, plan, folder]() {
+        const QString path = QFileDialog::getSaveFileName(&dialog, "Export Script", QDir(folder).filePath("plan.sh"),
+                                                          "Shell script (*.sh)");
+        if (path.isEmpty()) {
+            return;
+        }
+        QFile file(path);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(plan->toShellScript().toUtf8()) >= 0) {
+            file.setPermissions(file.permissions() | QFileDevice::ExeOwner | QFileDevice::ExeUser);
+            logMessage(QString("Plan script written to %1").arg(path), LogLevel::Info);
+        } else {
+            logMessage(QString("[ERROR] Could not write %1: %2").arg(path, file.errorString()), LogLevel::Error);
+        }
+    });
+    dialog.exec();
 }
 
 void MainWindow::stopProcessing()
 {
-    if (m_processor) {
-        m_processor->stop();
-        logMessage("Processing stopped by user", LogLevel::Warning);
+    if (!m_processing || m_stopRequested) {
+        return;
     }
-    
-    m_processing = false;
-    ui->startBtn->setEnabled(true);
+    // Start stays disabled until the processor reports finished()
+    m_stopRequested = true;
+    QMetaObject::invokeMethod(m_processor, &FileProcessor::stop, Qt::QueuedConnection);
+    logMessage("Processing stopped by user", LogLevel::Warning);
+
     ui->stopBtn->setEnabled(false);
-    ui->statusLabel->setText("Stopped");
+    ui->statusLabel->setText("Stopping...");
+    m_etaLabel->clear();
 }
 
 void MainWindow::onTaskProgress(int current, int total, const QString &currentFile)
 {
-    ui->progressBar->setMaximum(total);
-    ui->progressBar->setValue(current);
     ui->statusLabel->setText(QString("Processing: %1 (%2/%3)")
                            .arg(QFileInfo(currentFile).fileName())
                            .arg(current + 1)
@@ -513,13 +815,98 @@ void MainWindow::onTaskProgress(int current, int total, const QString &currentFi
     }
 }
 
+void MainWindow::onOverallProgress(double fraction, qint64 etaMs, qint64 etaLowMs, qint64 etaHighMs)
+{
+    Q_UNUSED(fraction);     // the bar follows the progress board, see refreshJobProgress()
+    if (etaMs < 0) {
+        m_etaLabel->setText("ETA: estimating...");
+        return;
+    }
+    m_etaLabel->setText(QString("ETA: %1 (%2 - %3)")
+                            .arg(ProgressEstimator::formatDuration(etaMs))
+                            .arg(ProgressEstimator::formatDuration(etaLowMs))
+                            .arg(ProgressEstimator::formatDuration(etaHighMs)));
+    m_etaLabel->setToolTip("Time left for the batch, with the range the measured throughput allows");
+}
+
+void MainWindow::markDuplicateRows()
+{
+    const QHash<QString, QString> leaders = m_fingerprints->duplicateLeaders();
+    QSet<QString> firstCopies;
+    for (const QString &leader : leaders) {
+        firstCopies.insert(leader);
+    }
+
+    for (int row = 0; row < ui->fileTable->rowCount(); ++row) {
+        QTableWidgetItem *item = ui->fileTable->item(row, COL_FILENAME);
+        if (!item) {
+            continue;
+        }
+        const QString file = item->data(Qt::UserRole).toString();
+        if (leaders.contains(file)) {
+            item->setBackground(QColor(110, 90, 20));
+            item->setToolTip(QString("Same content as %1").arg(QFileInfo(leaders.value(file)).fileName()));
+        } else if (firstCopies.contains(file)) {
+            item->setBackground(QColor(70, 60, 20));
+            item->setToolTip("Has duplicates in the list");
+        } else {
+            item->setData(Qt::BackgroundRole, QVariant());
+            item->setToolTip(QString());
+        }
+    }
+    if (!leaders.isEmpty()) {
+        logMessage(QString("%1 duplicate file(s) detected by content").arg(leaders.size()), LogLevel::Warning);
+    }
+}
+
+void MainWindow::refreshJobProgress()
+{
+    const ProgressBoard &board = m_processor->progressBoard();
+
+    // One model update per tick: hold sorting and repaints until every changed row is written
+    const bool sorting = ui->fileTable->isSortingEnabled();
+    ui->fileTable->setSortingEnabled(false);
+    ui->fileTable->setUpdatesEnabled(false);
+    for (int row = 0; row < ui->fileTable->rowCount(); ++row) {
+        QTableWidgetItem *nameItem = ui->fileTable->item(row, COL_FILENAME);
+        const int job = nameItem ? m_jobIndexByFile.value(nameItem->data(Qt::UserRole).toString(), -1) : -1;
+        if (job < 0 || job >= m_shownProgress.size()) {
+            continue;
+        }
+        const quint32 value = board.rawValue(job);
+        if (value == m_shownProgress.at(job)) {
+            continue;
+        }
+        m_shownProgress[job] = value;
+
+        const ProgressBoard::Entry entry = board.read(job);
+        QTableWidgetItem *item = ui->fileTable->item(row, COL_PROGRESS);
+        if (!item) {
+            item = new QTableWidgetItem();
+            ui->fileTable->setItem(row, COL_PROGRESS, item);
+        }
+        if (entry.state == ProgressBoard::Running || entry.state == ProgressBoard::Succeeded) {
+            item->setData(Qt::DisplayRole, entry.permille / 10);
+        } else {
+            item->setData(Qt::DisplayRole, QVariant());
+        }
+    }
+    ui->progressBar->setValue(qRound(board.overallFraction() * ui->progressBar->maximum()));
+    ui->fileTable->setSortingEnabled(sorting);
+    ui->fileTable->setUpdatesEnabled(true);
+}
+
 void MainWindow::onTaskFinished()
 {
+    m_progressRefreshTimer->stop();
+    refreshJobProgress();
     m_processing = false;
     ui->startBtn->setEnabled(true);
     ui->stopBtn->setEnabled(false);
-    ui->statusLabel->setText("Finished");
+    ui->statusLabel->setText(m_stopRequested ? "Stopped" : "Finished");
+    m_stopRequested = false;
     ui->progressBar->setValue(ui->progressBar->maximum());
+    m_etaLabel->clear();
     
     logMessage("All files processed successfully!", LogLevel::Info);
 }
@@ -534,6 +921,16 @@ void MainWindow::onFileProcessed(const QString &inputFile, bool success)
     }
 }
 
+void MainWindow::onFileCancelled(const QString &inputFile)
+{
+    for (int i = 0; i < ui->fileTable->rowCount(); ++i) {
+        if (ui->fileTable->item(i, COL_FILENAME)->data(Qt::UserRole).toString() == inputFile) {
+            updateTableRowStatus(i, "Cancelled");
+            break;
+        }
+    }
+}
+
 void MainWindow::onLogMessage(const QString &message, LogLevel level)
 {
     logMessage(message, level);
@@ -552,18 +949,23 @@ void MainWindow::onLogFilterChanged()
     m_showError = ui->errorCheck->isChecked();
 }
 
-void MainWindow::onMediaAnalysisFinished(int index, const MediaInfo &info)
+void MainWindow::onMediaAnalysisFinished(int index, const MediaInfo &analyzed)
 {
     if (index >= 0 && index < m_mediaInfos.size()) {
+        // In/out points are the user's and survive re-analysis
+        MediaInfo info = analyzed;
+        info.inPoint = m_mediaInfos[index].inPoint;
+        info.outPoint = m_mediaInfos[index].outPoint;
         m_mediaInfos[index] = info;
         updateTableRowStatus(index, info.analyzed ? "Ready" : "Analysis Failed");
 
         // HDR detection info logging
         if (info.isHdr) {
-            logMessage(QString("Detected HDR stream (EOTF: %1, primaries: %2, matrix: %3)")
+            logMessage(QString("Detected HDR stream (EOTF: %1, primaries: %2, matrix: %3, static metadata: %4)")
                        .arg(info.hdrEotf.isEmpty() ? "Unknown" : info.hdrEotf)
                        .arg(info.colorPrimariesCode.isEmpty() ? "Unknown" : info.colorPrimariesCode)
-                       .arg(info.colorSpaceCode.isEmpty() ? "Unknown" : info.colorSpaceCode), LogLevel::Info);
+                       .arg(info.colorSpaceCode.isEmpty() ? "Unknown" : info.colorSpaceCode)
+                       .arg(info.hdrMetadata.describe()), LogLevel::Info);
         } else if (info.hdrMetadataIncomplete) {
             logMessage("[WARN] HDR-like color primaries detected but transfer function missing. Please verify PQ/HLG manually.", LogLevel::Warning);
         }
@@ -590,19 +992,22 @@ void MainWindow::onMediaAnalysisFinished(int index, const MediaInfo &info)
         updateContainerFormats();
         onFormatChanged();
     }
-    
-    // Check if all analysis is complete
-    static int completedAnalysis = 0;
-    completedAnalysis++;
-    
-    if (completedAnalysis >= m_files.size()) {
-        logMessage("Media analysis completed", LogLevel::Info);
-        completedAnalysis = 0;
+}
 
-        // After all analysis is done, refresh container formats and film grain visibility immediately
-        updateContainerFormats();
-        onFormatChanged();
-    }
+void MainWindow::onMediaAnalysisPreliminary(int index, const MediaInfo &info)
+{
+    // Fast-probe values, usable right away; the deep probe replaces them later
+    onMediaAnalysisFinished(index, info);
+    updateTableRowStatus(index, "Ready (probing...)");
+}
+
+void MainWindow::onAllAnalysisFinished()
+{
+    logMessage("Media analysis completed", LogLevel::Info);
+
+    // After all analysis is done, refresh container formats and film grain visibility immediately
+    updateContainerFormats();
+    onFormatChanged();
 }
 
 void MainWindow::onMediaAnalysisError(int index, const QString &error)
@@ -724,6 +1129,8 @@ void MainWindow::onMediaAnalysisError(int index, const QString &error)
         info.fileSize = formatFileSize(fileInfo.size());
         info.isRawStream = true;
         info.analyzed = false; // Mark as not analyzed to indicate manual editing needed
+        info.inPoint = m_mediaInfos[index].inPoint;
+        info.outPoint = m_mediaInfos[index].outPoint;
         
         m_mediaInfos[index] = info;
         
@@ -754,6 +1161,11 @@ void MainWindow::onMediaAnalysisError(int index, const QString &error)
 
 void MainWindow::onTableCellChanged(int row, int column)
 {
+    if (column == COL_IN_POINT || column == COL_OUT_POINT) {
+        // Not tied to analysis results, so accepted while probes run
+        onRangeCellChanged(row, column);
+        return;
+    }
     if (m_analyzer && m_analyzer->isAnalyzing()) {
         return;
     }
@@ -794,9 +1206,39 @@ void MainWindow::onTableCellChanged(int row, int column)
     ui->applyAllBtn->setEnabled(ui->fileTable->rowCount() > 1);
 }
 
+void MainWindow::onRangeCellChanged(int row, int column)
+{
+    QTableWidgetItem *item = ui->fileTable->item(row, column);
+    if (!item || row < 0 || row >= m_mediaInfos.size()) {
+        return;
+    }
+    MediaInfo &info = m_mediaInfos[row];
+    double &point = (column == COL_IN_POINT) ? info.inPoint : info.outPoint;
+
+    bool ok = false;
+    const double seconds = parseTimecode(item->text(), &ok);
+    const double otherIn = (column == COL_OUT_POINT) ? info.inPoint : seconds;
+    const double otherOut = (column == COL_IN_POINT) ? info.outPoint : seconds;
+    if (!ok || (otherIn >= 0.0 && otherOut >= 0.0 && otherOut <= otherIn)) {
+        logMessage(QString("Invalid %1 point \"%2\": use h:mm:ss, m:ss or seconds, with out after in")
+                       .arg(column == COL_IN_POINT ? "in" : "out").arg(item->text()), LogLevel::Warning);
+    } else {
+        point = seconds;
+    }
+
+    // Show the stored value in canonical form
+    const QString canonical = formatTimecode(point);
+    if (item->text() != canonical) {
+        QSignalBlocker blocker(ui->fileTable);
+        item->setText(canonical);
+    }
+}
+
 void MainWindow::onTableItemDoubleClicked(int row, int column)
 {
-    if (column == COL_OUTPUT_NAME) {
+    if (column == COL_IN_POINT || column == COL_OUT_POINT) {
+        ui->fileTable->editItem(ui->fileTable->item(row, column));
+    } else if (column == COL_OUTPUT_NAME) {
         // Allow editing output name
         ui->fileTable->editItem(ui->fileTable->item(row, column));
     }
@@ -818,18 +1260,26 @@ void MainWindow::addFilesToTable(const QStringList &files)
             ui->fileTable->setItem(row, COL_FILENAME, nameItem);
             
             ui->fileTable->setItem(row, COL_STATUS, new QTableWidgetItem("Analyzing..."));
+            ui->fileTable->setItem(row, COL_PROGRESS, new QTableWidgetItem());
             ui->fileTable->setItem(row, COL_VIDEO_CODEC, new QTableWidgetItem("Unknown"));
             ui->fileTable->setItem(row, COL_RESOLUTION, new QTableWidgetItem("Unknown"));
             ui->fileTable->setItem(row, COL_FRAME_RATE, new QTableWidgetItem("Unknown"));
             ui->fileTable->setItem(row, COL_BIT_DEPTH, new QTableWidgetItem("Unknown"));
             ui->fileTable->setItem(row, COL_COLOR_SPACE, new QTableWidgetItem("Unknown"));
             ui->fileTable->setItem(row, COL_DURATION, new QTableWidgetItem("Unknown"));
+            QTableWidgetItem *inItem = new QTableWidgetItem();
+            inItem->setToolTip("Start of the section to extract (h:mm:ss). Stream copy starts at the keyframe before it.");
+            ui->fileTable->setItem(row, COL_IN_POINT, inItem);
+            QTableWidgetItem *outItem = new QTableWidgetItem();
+            outItem->setToolTip("End of the section to extract (h:mm:ss); empty for the end of the file");
+            ui->fileTable->setItem(row, COL_OUT_POINT, outItem);
             ui->fileTable->setItem(row, COL_FILE_SIZE, new QTableWidgetItem(formatFileSize(fileInfo.size())));
             
             QString outputName = getOutputFileName(file);
             ui->fileTable->setItem(row, COL_OUTPUT_NAME, new QTableWidgetItem(outputName));
         }
     }
+    m_fingerprints->scan(files);
     
     if (!files.isEmpty()) {
         logMessage(QString("Added %1 files to processing list").arg(files.size()), LogLevel::Info);
@@ -1066,6 +1516,53 @@ QString MainWindow::promptManualResolution()
     return QString();
 }
 
+void MainWindow::editHdrMetadata()
+{
+    QSettings settings;
+    QDialog dialog(this);
+    dialog.setWindowTitle("HDR Metadata");
+    QFormLayout form(&dialog);
+    QCheckBox writeCheck("Write into every keyframe of raw H.264/H.265 streams");
+    writeCheck.setChecked(settings.value("hdr/writeMetadata", false).toBool());
+    QLineEdit masterDisplayEdit(settings.value("hdr/masterDisplay").toString());
+    masterDisplayEdit.setPlaceholderText("From source, or G(13250,34500)B(7500,3000)R(34000,16000)WP(15635,16450)L(10000000,1)");
+    masterDisplayEdit.setMinimumWidth(460);
+    QLineEdit maxCllEdit(settings.value("hdr/maxCll").toString());
+    maxCllEdit.setPlaceholderText("From source, or MaxCLL,MaxFALL e.g. 1000,400");
+    form.addRow(&writeCheck);
+    form.addRow("Mastering display:", &masterDisplayEdit);
+    form.addRow("Content light level:", &maxCllEdit);
+    QDialogButtonBox buttons(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    form.addRow(&buttons);
+    QObject::connect(&buttons, &QDialogButtonBox::accepted, &dialog, [&]() {
+        // Empty fields keep the source's values
+        HdrMetadata check;
+        const QString masterDisplay = masterDisplayEdit.text().trimmed();
+        const QString maxCll = maxCllEdit.text().trimmed();
+        if (!masterDisplay.isEmpty() && !check.setMasterDisplay(masterDisplay)) {
+            QMessageBox::warning(&dialog, "HDR Metadata", "Mastering display must look like "
+                                 "G(x,y)B(x,y)R(x,y)WP(x,y)L(max,min) in units of 0.00002 and 0.0001 cd/m², "
+                                 "with max above min.");
+            return;
+        }
+        if (!maxCll.isEmpty() && !check.setMaxCll(maxCll)) {
+            QMessageBox::warning(&dialog, "HDR Metadata", "Content light level must be MaxCLL,MaxFALL in cd/m², e.g. 1000,400.");
+            return;
+        }
+        dialog.accept();
+    });
+    QObject::connect(&buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    if (dialog.exec() == QDialog::Accepted) {
+        settings.setValue("hdr/writeMetadata", writeCheck.isChecked());
+        settings.setValue("hdr/masterDisplay", masterDisplayEdit.text().trimmed());
+        settings.setValue("hdr/maxCll", maxCllEdit.text().trimmed());
+        logMessage(writeCheck.isChecked() ? "HDR metadata will be written into raw H.264/H.265 outputs"
+                                          : "HDR metadata rewriting is off", LogLevel::Info);
+    }
+    // The button shows whether rewriting is on
+    m_hdrButton->setChecked(settings.value("hdr/writeMetadata", false).toBool());
+}
+
 QStringList MainWindow::getVideoCodecOptions()
 {
     return {"H.264", "H.265/HEVC", "AV1", "VP9", "VP8", "MPEG-2", "MPEG-4", "ProRes", "DNxHD", "Unknown"};
@@ -1191,6 +1688,24 @@ void MainWindow::checkFFmpegEnvironment()
     }
 }
 
+void ProgressBarDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const QVariant value = index.data(Qt::DisplayRole);
+    if (!value.isValid()) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+    QStyleOptionProgressBar bar;
+    bar.rect = option.rect.adjusted(2, 3, -2, -3);
+    bar.minimum = 0;
+    bar.maximum = 100;
+    bar.progress = value.toInt();
+    bar.text = QString("%1%").arg(bar.progress);
+    bar.textVisible = true;
+    bar.state = option.state | QStyle::State_Horizontal;
+    QApplication::style()->drawControl(QStyle::CE_ProgressBar, &bar, painter);
+}
+
 // CodecComboDelegate implementation
 CodecComboDelegate::CodecComboDelegate(QObject *parent)
     : QObject(parent)
@@ -1227,6 +1742,8 @@ void MainWindow::onProcessingModeChanged()
         // In BIN->YUV mode, only show output folder settings
         ui->formatLabel->setVisible(false);
         ui->formatCombo->setVisible(false);
+        m_extraFormatsButton->setVisible(false);
+        m_hdrButton->setVisible(false);
         ui->conflictCombo->setVisible(false);
         ui->namingLabel->setVisible(false);
         ui->prefixEdit->setVisible(false);
@@ -1246,6 +1763,8 @@ void MainWindow::onProcessingModeChanged()
         // In muxing mode, show all output settings
         ui->formatLabel->setVisible(true);
         ui->formatCombo->setVisible(true);
+        m_extraFormatsButton->setVisible(true);
+        m_hdrButton->setVisible(true);
         ui->conflictCombo->setVisible(true);
         ui->namingLabel->setVisible(true);
         ui->prefixEdit->setVisible(true);
@@ -1382,6 +1901,7 @@ void MainWindow::removeFileAtRow(int row)
 {
     if (row >= 0 && row < m_files.size()) {
         QString fileName = QFileInfo(m_files[row]).fileName();
+        m_fingerprints->forget(m_files[row]);
         m_files.removeAt(row);
         m_mediaInfos.removeAt(row);
         ui->fileTable->removeRow(row);
@@ -1393,7 +1913,9 @@ void MainWindow::analyzeFileAtRow(int row)
 {
     if (row >= 0 && row < m_files.size()) {
         updateTableRowStatus(row, "Analyzing...");
-        m_analyzer->analyzeFile(row, m_files[row]);
+        QMetaObject::invokeMethod(m_analyzer, [analyzer = m_analyzer, row, file = m_files[row]]() {
+            analyzer->analyzeFile(row, file, true);     // asked for: full probe at once
+        }, Qt::QueuedConnection);
         logMessage(QString("Started analysis for file %1").arg(row + 1), LogLevel::Info);
     }
 }
@@ -1423,6 +1945,29 @@ QString MainWindow::extractVersionInfo(const QString &ffmpegOutput)
     return "Unknown";
 }
 
+void MainWindow::onPriorityChanged(int index)
+{
+    const QVariantList preset = m_priorityCombo->itemData(index).toList();
+    if (preset.size() != 3) {
+        return;
+    }
+    const int niceLevel = preset.at(0).toInt();
+    const int ioClass = preset.at(1).toInt();
+    const int ioLevel = preset.at(2).toInt();
+
+    // Saved for later batches and analysis runs, applied to the running batch now
+    QSettings settings;
+    settings.setValue("process/niceLevel", niceLevel);
+    settings.setValue("process/ioClass", ioClass);
+    settings.setValue("process/ioLevel", ioLevel);
+    if (m_processor && m_processing) {
+        QMetaObject::invokeMethod(m_processor, [processor = m_processor, niceLevel, ioClass, ioLevel]() {
+            processor->setPriority(niceLevel, ioClass, ioLevel);
+        }, Qt::QueuedConnection);
+    }
+    logMessage(QString("Process priority set to %1").arg(m_priorityCombo->itemText(index)), LogLevel::Info);
+}
+
 void MainWindow::loadSettings()
 {
     QSettings settings;
@@ -1462,6 +2007,36 @@ void MainWindow::loadSettings()
     ui->filmgrainCheck->setChecked(settings.value("filmgrainEnabled", false).toBool());
     ui->filmgrainSpin->setValue(settings.value("filmgrainValue", 25).toInt());
     ui->filmgrainSpin->setVisible(ui->filmgrainCheck->isChecked());
+
+    const int dedupIndex = m_dedupCombo->findData(settings.value("processing/dedupMode", "off").toString());
+    m_dedupCombo->setCurrentIndex(qMax(0, dedupIndex));
+    connect(m_dedupCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        QSettings().setValue("processing/dedupMode", m_dedupCombo->itemData(index).toString());
+    });
+
+    m_hdrButton->setChecked(settings.value("hdr/writeMetadata", false).toBool());
+
+    const int joinIndex = m_joinCombo->findData(settings.value("processing/joinMode", "off").toString());
+    m_joinCombo->setCurrentIndex(qMax(0, joinIndex));
+    connect(m_joinCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        QSettings().setValue("processing/joinMode", m_joinCombo->itemData(index).toString());
+    });
+
+    const QStringList extraFormats = settings.value("output/extraFormats").toStringList();
+    for (QAction *action : m_extraFormatsButton->menu()->actions()) {
+        action->setChecked(extraFormats.contains(action->text()));
+        connect(action, &QAction::toggled, this, [this]() {
+            QSettings().setValue("output/extraFormats", selectedExtraFormats());
+            updateExtraFormatsButton();
+        });
+    }
+    updateExtraFormatsButton();
+
+    // Priority preset matching the saved nice level (custom levels show the closest)
+    const int niceLevel = settings.value("process/niceLevel", 0).toInt();
+    m_priorityCombo->setCurrentIndex(niceLevel >= 19 ? 2 : (niceLevel > 0 ? 1 : 0));
+    connect(m_priorityCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onPriorityChanged);
     
     // Load log filters
     ui->infoCheck->setChecked(settings.value("logFilters/info", true).toBool());
@@ -1615,3 +2190,20 @@ void MainWindow::onApplyAllClicked()
     logMessage(QString("Applied metadata and output settings from '%1' to all files")
               .arg(ui->fileTable->item(sourceRow, COL_FILENAME)->text()), LogLevel::Info);
 }
+
+QStringList MainWindow::selectedExtraFormats() const
+{
+    QStringList formats;
+    for (const QAction *action : m_extraFormatsButton->menu()->actions()) {
+        if (action->isChecked()) {
+            formats << action->text();
+        }
+    }
+    return formats;
+}
+
+void MainWindow::updateExtraFormatsButton()
+{
+    const QStringList formats = selectedExtraFormats();
+    m_extraFormatsButton->setText(formats.isEmpty() ? QString("+ Formats") : "Also: " + formats.join(", "));
+}
@@ -18,6 +18,11 @@
 #include <QMenu>
 #include <QAction>
 #include <QPushButton>
+#include <QStyledItemDelegate>
+#include <QHash>
+#include <QThread>
+#include "../core/MediaInfo.h"
+#include "../core/BatchPlan.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -26,27 +31,10 @@ QT_END_NAMESPACE
 class FileProcessor;
 class MuxingTask;
 class MediaAnalyzer;
-
-struct MediaInfo {
-    QString videoCodec;
-    QString audioCodec;
-    QString resolution;
-    QString frameRate;
-    QString duration;
-    QString fileSize;
-    QString bitrate;
-    QString bitDepth;
-    QString colorSpace;
-    // HDR metadata (from ffprobe)
-    QString colorPrimariesCode;   // e.g., bt2020
-    QString colorTransferCode;    // e.g., smpte2084 (PQ), arib-std-b67 (HLG)
-    QString colorSpaceCode;       // e.g., bt2020nc
-    bool isHdr = false;           // true if transfer is PQ/HLG and primaries/matrix suggest HDR
-    QString hdrEotf;              // "PQ" or "HLG" when isHdr
-    bool hdrMetadataIncomplete = false; // true if HDR suspected but missing transfer or inconsistent
-    bool isRawStream = false;
-    bool analyzed = false;
-};
+class StatsPanel;
+class QDockWidget;
+class QToolButton;
+class FingerprintScanner;
 
 enum class LogLevel {
     Info,
@@ -90,9 +78,15 @@ private slots:
     // Processing
     void startProcessing();
     void stopProcessing();
+    void dryRun();
+    void onPlanCompiled(const BatchPlanPtr &plan);
     void onTaskProgress(int current, int total, const QString &currentFile);
+    void onOverallProgress(double fraction, qint64 etaMs, qint64 etaLowMs, qint64 etaHighMs);
+    void refreshJobProgress();
+    void markDuplicateRows();
     void onTaskFinished();
     void onFileProcessed(const QString &inputFile, bool success);
+    void onFileCancelled(const QString &inputFile);
     
     // Logging
     void onLogMessage(const QString &message, LogLevel level = LogLevel::Info);
@@ -101,11 +95,14 @@ private slots:
     
     // Media analysis
     void onMediaAnalysisFinished(int index, const MediaInfo &info);
+    void onMediaAnalysisPreliminary(int index, const MediaInfo &info);
+    void onAllAnalysisFinished();
     void onMediaAnalysisError(int index, const QString &error);
     
     // Table interaction
     void onTableCellChanged(int row, int column);
     void onTableItemDoubleClicked(int row, int column);
+    void onRangeCellChanged(int row, int column);
     void showTableContextMenu(const QPoint &pos);
     
     // Context menu operations
@@ -119,6 +116,9 @@ private slots:
     // Environment setup
     void checkFFmpegEnvironment();
     void onFFmpegStatusClicked();
+
+    // Child process priority, adjustable while a batch runs
+    void onPriorityChanged(int index);
     
     // Settings persistence
     void loadSettings();
@@ -140,6 +140,9 @@ private:
     void updateTableRowStatus(int row, const QString &status);
     void showCompatibilityWarning(const QString &codec, const QString &container);
     QString promptManualResolution();
+    void editHdrMetadata();
+    void applyProcessorOptions();
+    void showPlan(const BatchPlanPtr &plan);
     
     // Editable table functionality
     void setupEditableCell(int row, int column, const QString &currentValue, const QStringList &options);
@@ -154,9 +157,14 @@ private:
     // Data
     QStringList m_files;
     QVector<MediaInfo> m_mediaInfos;
+    // Both live in their own threads: the GUI thread only posts calls to them and
+    // receives their queued signals, so it never waits on a child process
     FileProcessor *m_processor;
     MediaAnalyzer *m_analyzer;
+    QThread *m_processorThread;
+    QThread *m_analyzerThread;
     bool m_processing;
+    bool m_stopRequested;           // Stop clicked; the processor has not finished yet
     
     // UI state
     bool m_showInfo = true;
@@ -165,6 +173,38 @@ private:
     
     // Status bar widgets
     QLabel *m_ffmpegStatusLabel;
+    QLabel *m_etaLabel;
+
+    // Per-file progress, sampled from the processor's progress board at a fixed rate
+    QTimer *m_progressRefreshTimer;
+    QHash<QString, int> m_jobIndexByFile;   // file path -> index in the running batch
+    QVector<quint32> m_shownProgress;       // last board value written to each row
+    
+    // Batch statistics dock
+    QDockWidget *m_statsDock;
+    StatsPanel *m_statsPanel;
+
+    // Nice/ionice preset for ffmpeg and ffprobe children
+    QComboBox *m_priorityCombo;
+
+    // Content fingerprints of the listed files, and what to do with duplicates
+    FingerprintScanner *m_fingerprints;
+    QComboBox *m_dedupCombo;
+
+    // Segmented raw streams: separate outputs, or one output per numbered group or selection
+    QComboBox *m_joinCombo;
+
+    // Opens the HDR static metadata dialog ("hdr/..." settings)
+    QPushButton *m_hdrButton;
+
+    // Compiles the batch without running it and shows the plan
+    QPushButton *m_dryRunButton;
+    bool m_dryRunPending;
+
+    // Containers written alongside the output format in the same pass
+    QToolButton *m_extraFormatsButton;
+    QStringList selectedExtraFormats() const;
+    void updateExtraFormatsButton();
     
     // UI widgets
     QPushButton *m_applyAllButton; // Now references ui->applyAllBtn
@@ -181,4 +221,13 @@ public:
     static QStringList getAudioCodecs();
 };
 
+// Draws the Progress column as a bar; cells without a value stay empty
+class ProgressBarDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    explicit ProgressBarDelegate(QObject *parent = nullptr) : QStyledItemDelegate(parent) {}
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+};
+
 #endif // MAINWINDOW_H
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "StatsPanel.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QStandardPaths>
+
+StatsPanel::StatsPanel(QWidget *parent)
+    : QWidget(parent)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    m_summaryLabel = new QLabel("No batch has run yet", this);
+    m_summaryLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    layout->addWidget(m_summaryLabel);
+
+    m_phaseTable = new QTableWidget(BatchMetrics::PhaseCount, 5, this);
+    m_phaseTable->setHorizontalHeaderLabels({"Jobs", "p50", "p90", "p99", "Max"});
+    QStringList phases;
+    phases << "Queue wait" << "Probe" << "Spawn" << "Mux" << "Faststart / post" << "Total";
+    m_phaseTable->setVerticalHeaderLabels(phases);
+    m_phaseTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_phaseTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    layout->addWidget(m_phaseTable);
+
+    m_ioLabel = new QLabel(this);
+    m_ioLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    m_ioLabel->hide();
+    layout->addWidget(m_ioLabel);
+
+    m_ioTable = new QTableWidget(0, 2, this);
+    m_ioTable->setHorizontalHeaderLabels({"Requests", "Share"});
+    m_ioTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_ioTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    m_ioTable->hide();
+    layout->addWidget(m_ioTable);
+
+    QHBoxLayout *buttons = new QHBoxLayout();
+    buttons->addStretch();
+    m_exportJsonBtn = new QPushButton("Export JSON...", this);
+    m_exportPromBtn = new QPushButton("Export Prometheus...", this);
+    buttons->addWidget(m_exportJsonBtn);
+    buttons->addWidget(m_exportPromBtn);
+    layout->addLayout(buttons);
+
+    connect(m_exportJsonBtn, &QPushButton::clicked, this, &StatsPanel::exportJson);
+    connect(m_exportPromBtn, &QPushButton::clicked, this, &StatsPanel::exportPrometheus);
+
+    refresh();
+}
+
+QString StatsPanel::formatMs(double ms)
+{
+    if (ms < 1000.0) {
+        return QString("%1 ms").arg(ms, 0, 'f', 0);
+    }
+    return QString("%1 s").arg(ms / 1000.0, 0, 'f', 2);
+}
+
+void StatsPanel::setMetrics(const BatchMetrics &metrics)
+{
+    m_metrics = metrics;
+    refresh();
+}
+
+void StatsPanel::refresh()
+{
+    const bool hasJobs = !m_metrics.jobs().isEmpty();
+    m_exportJsonBtn->setEnabled(hasJobs);
+    m_exportPromBtn->setEnabled(hasJobs);
+    if (!hasJobs) {
+        refreshBlockIo(BatchMetrics::Summary());
+        return;
+    }
+
+    const BatchMetrics::Summary s = m_metrics.summary();
+    m_summaryLabel->setText(QString("%1 jobs (%2 failed) in %3 s  |  %4 jobs/s  |  read %5 MB/s, write %6 MB/s%7")
+                                .arg(s.jobs)
+                                .arg(s.failed)
+                                .arg(s.seconds, 0, 'f', 1)
+                                .arg(s.jobsPerSecond, 0, 'f', 2)
+                                .arg(s.readMBps, 0, 'f', 1)
+                                .arg(s.writeMBps, 0, 'f', 1)
+                                .arg(m_metrics.isRunning() ? "  (running)" : ""));
+
+    for (int phase = 0; phase < BatchMetrics::PhaseCount; ++phase) {
+        const BatchMetrics::Percentiles &p = s.phases[phase];
+        const QStringList cells = {
+            QString::number(p.samples),
+            p.samples ? formatMs(p.p50) : "-",
+            p.samples ? formatMs(p.p90) : "-",
+            p.samples ? formatMs(p.p99) : "-",
+            p.samples ? formatMs(p.max) : "-"
+        };
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem *item = m_phaseTable->item(phase, column);
+            if (!item) {
+                item = new QTableWidgetItem();
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                m_phaseTable->setItem(phase, column, item);
+            }
+            item->setText(cells.at(column));
+        }
+    }
+
+    refreshBlockIo(s);
+}
+
+void StatsPanel::refreshBlockIo(const BatchMetrics::Summary &s)
+{
+    const BlockIo::Stats &io = s.blockIo;
+    const quint64 requests = io.reads + io.writes;
+    m_ioLabel->setVisible(requests > 0);
+    m_ioTable->setVisible(requests > 0);
+    if (requests == 0) {
+        return;
+    }
+
+    m_ioLabel->setText(QString("In-process I/O: %1 reads/s (%2 MB), %3 writes/s (%4 MB), %5% via io_uring  |  "
+                               "latency p50 <%6 us, p99 <%7 us")
+                           .arg(s.ioReadsPerSecond, 0, 'f', 1)
+                           .arg(io.bytesRead / (1024 * 1024))
+                           .arg(s.ioWritesPerSecond, 0, 'f', 1)
+                           .arg(io.bytesWritten / (1024 * 1024))
+                           .arg(100.0 * io.uringRequests / requests, 0, 'f', 0)
+                           .arg(s.ioLatencyP50Us)
+                           .arg(s.ioLatencyP99Us));
+
+    // One row per occupied bucket of the log2 latency histogram
+    QStringList ranges;
+    QVector<quint64> counts;
+    for (int i = 0; i < BlockIo::LatencyBuckets; ++i) {
+        if (io.latencyHistogram[i] == 0) {
+            continue;
+        }
+        ranges << QString("%1-%2 us").arg(i == 0 ? 0 : quint64(1) << i).arg(quint64(1) << (i + 1));
+        counts << io.latencyHistogram[i];
+    }
+    m_ioTable->setRowCount(counts.size());
+    m_ioTable->setVerticalHeaderLabels(ranges);
+    for (int row = 0; row < counts.size(); ++row) {
+        const QStringList cells = {
+            QString::number(counts.at(row)),
+            QString("%1%").arg(100.0 * counts.at(row) / requests, 0, 'f', 1)
+        };
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem *item = m_ioTable->item(row, column);
+            if (!item) {
+                item = new QTableWidgetItem();
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                m_ioTable->setItem(row, column, item);
+            }
+            item->setText(cells.at(column));
+        }
+    }
+}
+
+void StatsPanel::exportJson()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export Batch Metrics",
+        QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/promuxer-batch.json",
+        "JSON (*.json)");
+    if (path.isEmpty()) {
+        return;
+    }
+    QString error;
+    if (!m_metrics.writeJson(path, &error)) {
+        QMessageBox::warning(this, "Export Failed", error);
+    }
+}
+
+void StatsPanel::exportPrometheus()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export Prometheus Textfile",
+        QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/promuxer.prom",
+        "Prometheus textfile (*.prom)");
+    if (path.isEmpty()) {
+        return;
+    }
+    QString error;
+    if (!m_metrics.writePrometheusTextfile(path, &error)) {
+        QMessageBox::warning(this, "Export Failed", error);
+    }
+}
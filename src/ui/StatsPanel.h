@@ -0,0 +1,42 @@
+#ifndef STATSPANEL_H
+#define STATSPANEL_H
+
+#include <QWidget>
+#include <QLabel>
+#include <QTableWidget>
+#include <QPushButton>
+#include "../core/BatchMetrics.h"
+
+// Throughput and per-phase latency percentiles of the current or last batch,
+// plus the in-process I/O request rates and latency histogram when the batch
+// made any. Shown in the "Batch Statistics" dock; the processor hands over a
+// copy of its metrics whenever a job completes.
+class StatsPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit StatsPanel(QWidget *parent = nullptr);
+
+public slots:
+    void setMetrics(const BatchMetrics &metrics);
+    void refresh();
+
+private slots:
+    void exportJson();
+    void exportPrometheus();
+
+private:
+    static QString formatMs(double ms);
+    void refreshBlockIo(const BatchMetrics::Summary &s);
+
+    BatchMetrics m_metrics;
+    QLabel *m_summaryLabel;
+    QTableWidget *m_phaseTable;
+    QLabel *m_ioLabel;
+    QTableWidget *m_ioTable;
+    QPushButton *m_exportJsonBtn;
+    QPushButton *m_exportPromBtn;
+};
+
+#endif // STATSPANEL_H